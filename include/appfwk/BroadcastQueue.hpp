@@ -0,0 +1,195 @@
+#ifndef APPFWK_INCLUDE_APPFWK_BROADCASTQUEUE_HPP_
+#define APPFWK_INCLUDE_APPFWK_BROADCASTQUEUE_HPP_
+
+/**
+ *
+ * @file BroadcastQueue.hpp
+ *
+ * A fixed-capacity ring which delivers every element pushed by one producer
+ * to each of several consumers
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/EventCount.hpp"
+#include "appfwk/Queue.hpp"
+#include "appfwk/ReadinessNotifier.hpp"
+#include "appfwk/RingStorage.hpp"
+#include "appfwk/WaitPolicy.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace dunedaq {
+
+// Disable coverage collection LCOV_EXCL_START
+/**
+ * @brief BroadcastQueueConsumersExhausted ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,                           // namespace
+                  BroadcastQueueConsumersExhausted, // issue class name
+                  name << ": Unable to add a consumer, the queue already has the maximum of " << max_consumers,
+                  ((std::string)name)((size_t)max_consumers))
+// Re-enable coverage collection LCOV_EXCL_STOP
+
+namespace appfwk {
+
+/**
+ * @brief What a BroadcastQueue does when its slowest consumer falls a whole
+ * capacity behind the producer
+ */
+enum class SlowConsumerPolicy
+{
+  kBlock, ///< The producer waits for the consumer, as it would on any full queue
+  kDrop,  ///< The consumer skips the oldest elements it hasn't started on, and the producer carries on
+};
+
+/**
+ * @brief A Queue implementation which delivers each element to every consumer
+ * @tparam T Data Type to be stored in the ring
+ *
+ * One producer thread pushes into a ring of capacity slots. Every DAQSource
+ * made for the queue gets a consumer view with its own read position, and
+ * sees every element pushed after the DAQSource was created. An element is
+ * destroyed, and its slot reused, only once the slowest consumer has moved
+ * past it, so the payload is stored once however many consumers there are.
+ *
+ * Consumers share the stored elements: view() gives read-only access to them
+ * in place, while pop() and peek() copy the element (and are not available
+ * for move-only types).
+ *
+ * Consumers should be created before the producer starts pushing, as modules
+ * do in their init. The queue must be owned by a std::shared_ptr, as it is
+ * when made by QueueRegistry.
+ */
+template<class T>
+class BroadcastQueue final
+  : public Queue<T>
+  , public std::enable_shared_from_this<BroadcastQueue<T>>
+{
+public:
+  using value_t = T;                                ///< Type of data stored in the BroadcastQueue
+  using duration_t = typename Queue<T>::duration_t; ///< Type used for expressing timeouts
+
+  static constexpr size_t s_max_consumers = 32; ///< Maximum number of consumers over the queue's lifetime
+
+  /**
+   * @brief BroadcastQueue Constructor
+   * @param name Name of this BroadcastQueue instance
+   * @param capacity Maximum number of elements the slowest consumer may be behind the producer
+   * @param slow_consumer_policy What to do when the slowest consumer is a whole capacity behind
+   * @param wait_policy How to wait when the ring is full (push) or a consumer has caught up (pop)
+   * @param storage_options How to back the ring's storage: NUMA node, prefaulted, locked, huge pages
+   */
+  explicit BroadcastQueue(const std::string& name,
+                          size_t capacity,
+                          SlowConsumerPolicy slow_consumer_policy = SlowConsumerPolicy::kBlock,
+                          WaitPolicy wait_policy = WaitPolicy::kSpinPark,
+                          const PageAllocation::Options& storage_options = {});
+
+  ~BroadcastQueue();
+
+  /**
+   * @brief Add a consumer, which will see every element pushed from now on
+   * @return The Queue the consumer pops from
+   * @throws BroadcastQueueConsumersExhausted if s_max_consumers consumers were already added
+   */
+  std::shared_ptr<Queue<T>> add_consumer() override;
+
+  // Elements are popped through the consumer views only
+  bool can_pop() const noexcept override { return false; }
+  bool try_pop(value_t&, const duration_t&) override;
+
+  bool can_push() const noexcept override { return this->get_num_elements() < this->get_capacity(); }
+  bool try_push(value_t&&, const duration_t&) override; // Returns false if a timeout occurs
+
+  size_t get_capacity() const noexcept override { return m_capacity; }
+
+  // Number of elements the slowest consumer is behind the producer
+  size_t get_num_elements() const noexcept override;
+
+  size_t get_page_size() const noexcept override { return m_slots.page_size(); }
+  int get_numa_node() const noexcept override { return m_slots.numa_node(); }
+  void move_storage_to_numa_node(int numa_node) override
+  {
+    m_slots.bind_to_numa_node(numa_node);
+    m_slot_bytes.bind_to_numa_node(numa_node);
+  }
+
+  BroadcastQueue(const BroadcastQueue&) = delete;            ///< BroadcastQueue is not copy-constructible
+  BroadcastQueue& operator=(const BroadcastQueue&) = delete; ///< BroadcastQueue is not copy-assignable
+  BroadcastQueue(BroadcastQueue&&) = delete;                 ///< BroadcastQueue is not move-constructible
+  BroadcastQueue& operator=(BroadcastQueue&&) = delete;      ///< BroadcastQueue is not move-assignable
+
+protected:
+  void wake_waiters() override;
+
+private:
+  class Consumer;
+
+  static constexpr size_t s_cache_line_size = 64;
+
+  // Set in a consumer's read index while it uses the element there, so that
+  // the producer doesn't drop the element from under it
+  static constexpr size_t s_busy = size_t(1) << (sizeof(size_t) * CHAR_BIT - 1);
+
+  struct alignas(s_cache_line_size) Cursor
+  {
+    std::atomic<size_t> read_index{ 0 };
+    std::atomic<bool> active{ false };
+    size_t cached_write_index{ 0 }; ///< Consumer's copy of the write index
+    ReadinessNotifier readiness;
+  };
+
+  T* slot(size_t index) noexcept { return m_slots.slot(index & m_mask); }
+  size_t& slot_bytes(size_t index) noexcept { return *m_slot_bytes.slot(index & m_mask); }
+  void* raw_slot(size_t index) noexcept { return m_slots.raw_slot(index & m_mask); }
+
+  // Producer side: find the slowest consumer and destroy the elements every consumer has passed
+  size_t refresh_min_read_index();
+  // Wait until a slot is free, or make one by moving slow consumers on. Returns false on timeout.
+  bool wait_for_space(size_t write_index, const duration_t& timeout);
+  void drop_before(size_t index);
+  void notify_consumers() noexcept;
+
+  // Consumer side: get the element at the cursor, then move past it or leave it for next time
+  const T* acquire_element(Cursor& cursor, const duration_t& timeout);
+  void release_element(Cursor& cursor, bool consumed) noexcept;
+  size_t wait_for_data(Cursor& cursor, size_t read_index, const duration_t& timeout);
+
+  const size_t m_capacity;
+  const size_t m_mask;
+  const SlowConsumerPolicy m_slow_consumer_policy;
+  const WaitPolicy m_wait_policy;
+  RingStorage<T> m_slots;
+  RingStorage<size_t> m_slot_bytes; ///< payload_bytes() of each element when it was pushed, released when reclaimed
+
+  // Producer-side cache line
+  alignas(s_cache_line_size) std::atomic<size_t> m_write_index{ 0 };
+  size_t m_cached_min_read_index{ 0 };
+  size_t m_reclaimed_index{ 0 }; ///< Elements before this one have been destroyed
+
+  std::array<Cursor, s_max_consumers> m_cursors;
+  std::atomic<size_t> m_num_consumers{ 0 }; ///< Cursors handed out, active or not
+  std::mutex m_add_consumer_mutex;
+
+  alignas(s_cache_line_size) EventCount m_no_longer_empty;
+  alignas(s_cache_line_size) EventCount m_no_longer_full;
+};
+
+} // namespace appfwk
+} // namespace dunedaq
+
+#include "detail/BroadcastQueue.hxx"
+
+#endif // APPFWK_INCLUDE_APPFWK_BROADCASTQUEUE_HPP_
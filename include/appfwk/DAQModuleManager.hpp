@@ -19,6 +19,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace dunedaq {
@@ -40,6 +41,17 @@ ERS_DECLARE_ISSUE(appfwk,
                   ((std::string)modules)                                                ///< Message parameters
 )
 
+ERS_DECLARE_ISSUE(appfwk,                                                       ///< Namespace
+                  QueueTopologyUnsupported,                                     ///< Issue class name
+                  "Queue " << queue_name << " of kind " << queue_kind << " has " ///< Message
+                           << producers << " producers and " << consumers << " consumers, but allows " << allowed,
+                  ((std::string)queue_name)                                     ///< Message parameters
+                  ((std::string)queue_kind)                                     ///< Message parameters
+                  ((size_t)producers)                                           ///< Message parameters
+                  ((size_t)consumers)                                           ///< Message parameters
+                  ((std::string)allowed)                                        ///< Message parameters
+)
+
 ERS_DECLARE_ISSUE(appfwk,                                                                ///< Namespace
                   ConflictingCommandMatching,                                            ///< Issue class name
                   "Command " << cmdid << " matches multiple times modules: " << modules, ///< Message
@@ -69,20 +81,37 @@ public:
 
 protected:
   typedef std::map<std::string, std::shared_ptr<DAQModule>> DAQModuleMap_t; ///< DAQModules indexed by name
+  typedef std::vector<std::pair<std::string, const dataobj_t*>> DispatchSeq_t; ///< Modules to execute a command
+                                                                                ///< on, with their parameters
 
   void initialize(const dataobj_t& data);
-  void init_queues(const app::QueueSpecs& qspecs);
+  void read_queue_endpoints(const app::ModSpecs& mspecs);
+  void init_queues(const app::QueueSpecs& qspecs, const app::PoolSpecs& pspecs);
   void init_modules(const app::ModSpecs& mspecs);
+  void rank_modules_by_data_flow();
+  void resize_queues(const app::QueueResizes& resizes);
 
   void dispatch_one_match_only(cmdlib::cmd::CmdId id, const dataobj_t& data);
   void dispatch_after_merge(cmdlib::cmd::CmdId id, const dataobj_t& data);
+  void dispatch_serially(cmdlib::cmd::CmdId id, DispatchSeq_t& dispatch_seq);
+  void dispatch_in_parallel(cmdlib::cmd::CmdId id, const DispatchSeq_t& dispatch_seq, app::DispatchOrder order);
 
 private:
   std::vector<std::string> get_modnames_by_cmdid(cmdlib::cmd::CmdId id);
+  app::DispatchOrder get_dispatch_order(cmdlib::cmd::CmdId id) const;
 
   bool m_initialized;
 
   DAQModuleMap_t m_module_map;
+
+  std::map<std::string, std::vector<std::string>> m_module_inputs;  ///< Input queue instances of each module
+  std::map<std::string, std::vector<std::string>> m_module_outputs; ///< Output queue instances of each module
+  std::map<std::string, size_t> m_module_rank; ///< Position of each module in the data flow, sources first
+  std::map<std::string, size_t> m_module_wave; ///< Wave of each module when dispatching in data flow order: one
+                                               ///< more than the latest wave of the modules feeding it
+
+  size_t m_dispatch_threads{ 0 }; ///< Threads which execute a command on the modules in parallel, 0 for none
+  std::map<std::string, app::DispatchOrder> m_dispatch_orders; ///< Orders declared for commands
 };
 
 } // namespace appfwk
@@ -14,10 +14,16 @@
 
 #include "logging/Logging.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <functional>
 #include <memory>
+#include <new>
+#include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace dunedaq {
 // Disable coverage collection LCOV_EXCL_START
@@ -29,21 +35,130 @@ ERS_DECLARE_ISSUE(appfwk,                                           // namespace
                   DAQSinkConstructionFailed,                        // issue class name
                   "Failed to construct DAQSink \"" << name << "\"", // no message
                   ((std::string)name))
+
+/**
+ * @brief Define an ERS Issue for when a DAQSink is given watermarks it can't use
+ */
+ERS_DECLARE_ISSUE(appfwk,                   // namespace
+                  DAQSinkWatermarksInvalid, // issue class name
+                  "DAQSink \"" << name << "\" can't use a high watermark of " << high << " with a low watermark of "
+                                << low << ": they must satisfy 0 <= low < high <= 1",
+                  ((std::string)name)((double)high)((double)low))
 // Re-enable coverage collection LCOV_EXCL_STOP
 
 namespace appfwk {
 
-template<typename T>
+/**
+ * @brief Handle through which a module pushes to a Queue
+ * @tparam T Type of the elements
+ * @tparam QueueType Queue class the handle is bound to
+ *
+ * With the default, Queue, the handle works whatever the kind of the queue,
+ * and each operation is a virtual call. A module which knows the kind its
+ * queue is configured with can name the class instead, e.g.
+ * DAQSink<T, SPSCRingQueue>: the kind is checked when the handle is
+ * constructed, and since the queue classes are final, operations compile to
+ * direct calls which can be inlined into the module's loop.
+ *
+ * Producers can be told that the queue is filling up before they have to
+ * wait on it: once given watermarks with set_watermarks(), the DAQSink
+ * reports high pressure() when the queue fills past the high watermark,
+ * and low again only once it has drained down to the low one, and calls
+ * the callbacks added with on_pressure_change() on each change. The module
+ * can then throttle, batch harder or shed load itself.
+ *
+ * When the queue is configured with credits (see QueueBase::enable_credits()),
+ * every element pushed spends one, and the DAQSink waits for consumers to
+ * grant more (see DAQSource::grant_credits()) as it would for space.
+ */
+template<typename T, template<typename> class QueueType = Queue>
 class DAQSink : public Named
 {
 public:
   using value_t = T;
   using duration_t = std::chrono::milliseconds;
 
+  enum class Pressure
+  {
+    kLow,
+    kHigh
+  };
+  using pressure_callback_t = std::function<void(Pressure)>;
+
+  /**
+   * @brief A reservation for the next element to be pushed, obtained from reserve()
+   *
+   * The Slot holds a default-constructed element which the producer fills in
+   * and then pushes with commit(). When the Queue supports it, the element is
+   * constructed directly in the Queue's storage, so committing it costs no copy
+   * or move at all; otherwise it is built inside the Slot and moved into the
+   * Queue on commit(). Destroying a Slot without committing it discards the
+   * element.
+   */
+  class Slot
+  {
+  public:
+    T& operator*() noexcept { return *m_element; }
+    T* operator->() noexcept { return m_element; }
+
+    void commit(); // Throws QueueTimeoutExpired if the element couldn't be pushed in time
+
+    ~Slot();
+
+    Slot(Slot const&) = delete;
+    Slot(Slot&&) = delete;
+    Slot& operator=(Slot const&) = delete;
+    Slot& operator=(Slot&&) = delete;
+
+  private:
+    friend class DAQSink;
+    Slot(DAQSink& sink, const duration_t& timeout);
+
+    DAQSink& m_sink;
+    QueueType<T>& m_queue;
+    duration_t m_timeout;
+    T* m_element{ nullptr };
+    std::optional<T> m_local; ///< Storage for the element if the Queue doesn't support slots
+    bool m_credit{ false };   ///< Whether the Slot holds a credit, given back if it isn't committed
+  };
+
   explicit DAQSink(const std::string& name);
   void push(T&& element, const duration_t& timeout = duration_t::zero());
   void push(const T& element, const duration_t& timeout = duration_t::zero());
+  void push(T&& element, size_t priority, const duration_t& timeout = duration_t::zero());
+  template<typename... Args>
+  void emplace(const duration_t& timeout, Args&&... args);
+  Slot reserve(const duration_t& timeout = duration_t::zero());
+  size_t push_n(T* elements, size_t count, const duration_t& timeout = duration_t::zero());
+  bool try_push(T&& element, const duration_t& timeout = duration_t::zero());
+  bool try_push(const T& element, const duration_t& timeout = duration_t::zero());
+  bool try_push(T&& element, size_t priority, const duration_t& timeout = duration_t::zero());
   bool can_push() const noexcept;
+
+  /**
+   * @brief Report high pressure from when the queue is high full, until it is back down to low
+   * @param high Occupancy, as a fraction of the capacity, at which the pressure becomes high
+   * @param low Occupancy at or below which it becomes low again
+   * @throws DAQSinkWatermarksInvalid unless 0 <= low < high <= 1
+   */
+  void set_watermarks(double high, double low);
+  /**
+   * @brief Add a callback to be called, in the thread pushing, each time the pressure changes
+   *
+   * Callbacks must be added before the DAQSink is used to push.
+   */
+  void on_pressure_change(pressure_callback_t callback) { m_pressure_callbacks.push_back(std::move(callback)); }
+  /**
+   * @brief How full the queue is, as a fraction of its capacity or, if it has one and is fuller by that
+   * measure, of its capacity in bytes
+   */
+  double get_occupancy() const noexcept;
+  /**
+   * @brief Get the pressure on the queue, re-evaluated now; always kLow without watermarks
+   */
+  Pressure pressure();
+  // True once the queue is closed; pushes then fail straight away (see QueueBase::close())
+  bool is_closed() const noexcept { return m_queue->is_closed(); }
   const std::string& get_name() const final { return m_queue->get_name(); }
 
   DAQSink(DAQSink const&) = delete;
@@ -52,41 +167,326 @@ public:
   DAQSink& operator=(DAQSink&&) = delete;
 
 private:
-  std::shared_ptr<Queue<T>> m_queue;
+  // Spend a credit, if the queue uses them, and push with what is left of the timeout; give the credit back if the
+  // push fails
+  template<typename Push>
+  bool push_with_credit(const duration_t& timeout, Push&& push);
+  // Take a credit, returning what is left of the timeout, or nullopt if none came in time
+  std::optional<duration_t> take_credit(const duration_t& timeout);
+  void update_pressure();
+
+  std::shared_ptr<QueueType<T>> m_queue;
+
+  double m_high_watermark{ 0 }; ///< 0 until set_watermarks() is called
+  double m_low_watermark{ 0 };
+  std::atomic<Pressure> m_pressure{ Pressure::kLow };
+  std::vector<pressure_callback_t> m_pressure_callbacks;
 };
 
-template<typename T>
-DAQSink<T>::DAQSink(const std::string& name)
+namespace detail {
+inline std::chrono::milliseconds
+time_left(std::chrono::steady_clock::time_point deadline)
+{
+  const auto left = deadline - std::chrono::steady_clock::now();
+  return std::max(std::chrono::duration_cast<std::chrono::milliseconds>(left), std::chrono::milliseconds::zero());
+}
+} // namespace detail
+
+template<typename T, template<typename> class QueueType>
+DAQSink<T, QueueType>::DAQSink(const std::string& name)
 {
   try {
-    m_queue = QueueRegistry::get().get_queue<T>(name);
+    m_queue = QueueRegistry::get().get_queue<T, QueueType>(name);
     TLOG_DEBUG(1, "DAQSink") << "Queue " << name << " is at " << m_queue.get();
   } catch (const QueueTypeMismatch& ex) {
     throw DAQSinkConstructionFailed(ERS_HERE, name, ex);
+  } catch (const QueueKindMismatch& ex) {
+    throw DAQSinkConstructionFailed(ERS_HERE, name, ex);
+  }
+}
+
+template<typename T, template<typename> class QueueType>
+void
+DAQSink<T, QueueType>::push(T&& element, const duration_t& timeout)
+{
+  if (!try_push(std::move(element), timeout)) {
+    m_queue->throw_failed("push", timeout);
   }
 }
 
-template<typename T>
+template<typename T, template<typename> class QueueType>
 void
-DAQSink<T>::push(T&& element, const duration_t& timeout)
+DAQSink<T, QueueType>::push(const T& element, const duration_t& timeout)
+{
+  emplace(timeout, element);
+}
+
+template<typename T, template<typename> class QueueType>
+void
+DAQSink<T, QueueType>::push(T&& element, size_t priority, const duration_t& timeout)
+{
+  if (!try_push(std::move(element), priority, timeout)) {
+    m_queue->throw_failed("push", timeout);
+  }
+}
+
+template<typename T, template<typename> class QueueType>
+template<typename... Args>
+void
+DAQSink<T, QueueType>::emplace(const duration_t& timeout, Args&&... args)
+{
+  const bool pushed = push_with_credit(timeout, [&](const duration_t& left) {
+    if (!m_queue->supports_slots()) {
+      return m_queue->try_push(T(std::forward<Args>(args)...), left);
+    }
+
+    void* slot = m_queue->try_reserve_slot(left);
+    if (slot == nullptr) {
+      return false;
+    }
+    try {
+      new (slot) T(std::forward<Args>(args)...);
+    } catch (...) {
+      m_queue->cancel_slot();
+      throw;
+    }
+    m_queue->commit_slot();
+    return true;
+  });
+  if (!pushed) {
+    m_queue->throw_failed("push", timeout);
+  }
+}
+
+template<typename T, template<typename> class QueueType>
+typename DAQSink<T, QueueType>::Slot
+DAQSink<T, QueueType>::reserve(const duration_t& timeout)
 {
-  m_queue->push(std::move(element), timeout);
+  return Slot(*this, timeout);
 }
 
-template<typename T>
+template<typename T, template<typename> class QueueType>
+DAQSink<T, QueueType>::Slot::Slot(DAQSink& sink, const duration_t& timeout)
+  : m_sink(sink)
+  , m_queue(*sink.m_queue)
+  , m_timeout(timeout)
+{
+  duration_t left = timeout;
+  if (m_queue.uses_credits()) {
+    auto credit_left = m_sink.take_credit(timeout);
+    if (!credit_left) {
+      m_queue.throw_failed("reserve", timeout);
+    }
+    left = *credit_left;
+    m_credit = true;
+  }
+
+  try {
+    if (!m_queue.supports_slots()) {
+      m_element = &m_local.emplace();
+      return;
+    }
+
+    void* slot = m_queue.try_reserve_slot(left);
+    if (slot == nullptr) {
+      m_queue.throw_failed("reserve", timeout);
+    }
+    try {
+      m_element = new (slot) T();
+    } catch (...) {
+      m_queue.cancel_slot();
+      throw;
+    }
+  } catch (...) {
+    if (m_credit) {
+      m_queue.grant_credits(1);
+    }
+    throw;
+  }
+}
+
+template<typename T, template<typename> class QueueType>
 void
-DAQSink<T>::push(const T& element, const duration_t& timeout)
+DAQSink<T, QueueType>::Slot::commit()
+{
+  if (m_local) {
+    if (!m_queue.try_push(std::move(*m_local), m_timeout)) {
+      m_queue.throw_failed("push", m_timeout);
+    }
+    m_local.reset();
+  } else {
+    m_queue.commit_slot();
+  }
+  m_element = nullptr;
+  m_credit = false;
+  if (m_sink.m_high_watermark > 0) {
+    m_sink.update_pressure();
+  }
+}
+
+template<typename T, template<typename> class QueueType>
+DAQSink<T, QueueType>::Slot::~Slot()
+{
+  if (m_element != nullptr && !m_local) {
+    m_element->~T();
+    m_queue.cancel_slot();
+  }
+  if (m_credit) {
+    m_queue.grant_credits(1);
+  }
+}
+
+template<typename T, template<typename> class QueueType>
+size_t
+DAQSink<T, QueueType>::push_n(T* elements, size_t count, const duration_t& timeout)
+{
+  size_t pushed = 0;
+  if (!m_queue->uses_credits()) {
+    pushed = m_queue->push_n(elements, count, timeout);
+  } else {
+    // Take as many credits as there are, up to what is left to push, and push that many, until done or out of time
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (pushed < count) {
+      const size_t credits = m_queue->take_credits(count - pushed, deadline);
+      if (credits == 0) {
+        break;
+      }
+      const size_t batch = m_queue->push_n(elements + pushed, credits, detail::time_left(deadline));
+      pushed += batch;
+      if (batch < credits) {
+        m_queue->grant_credits(credits - batch);
+        break;
+      }
+    }
+  }
+
+  if (m_high_watermark > 0) {
+    update_pressure();
+  }
+  return pushed;
+}
+
+template<typename T, template<typename> class QueueType>
+bool
+DAQSink<T, QueueType>::try_push(T&& element, const duration_t& timeout)
+{
+  return push_with_credit(timeout, [&](const duration_t& left) { return m_queue->try_push(std::move(element), left); });
+}
+
+template<typename T, template<typename> class QueueType>
+bool
+DAQSink<T, QueueType>::try_push(const T& element, const duration_t& timeout)
+{
+  return push_with_credit(timeout, [&](const duration_t& left) { return m_queue->try_push(T(element), left); });
+}
+
+template<typename T, template<typename> class QueueType>
+bool
+DAQSink<T, QueueType>::try_push(T&& element, size_t priority, const duration_t& timeout)
+{
+  return push_with_credit(timeout, [&](const duration_t& left) {
+    return m_queue->try_push_with_priority(std::move(element), priority, left);
+  });
+}
+
+template<typename T, template<typename> class QueueType>
+template<typename Push>
+bool
+DAQSink<T, QueueType>::push_with_credit(const duration_t& timeout, Push&& push)
 {
-  m_queue->push(T(element), timeout);
+  bool pushed = false;
+  if (!m_queue->uses_credits()) {
+    pushed = push(timeout);
+  } else if (auto left = take_credit(timeout)) {
+    try {
+      pushed = push(*left);
+    } catch (...) {
+      m_queue->grant_credits(1);
+      throw;
+    }
+    if (!pushed) {
+      m_queue->grant_credits(1);
+    }
+  }
+
+  if (m_high_watermark > 0) {
+    update_pressure();
+  }
+  return pushed;
+}
+
+template<typename T, template<typename> class QueueType>
+std::optional<typename DAQSink<T, QueueType>::duration_t>
+DAQSink<T, QueueType>::take_credit(const duration_t& timeout)
+{
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  if (m_queue->take_credits(1, deadline) == 0) {
+    return std::nullopt;
+  }
+  return detail::time_left(deadline);
 }
 
-template<typename T>
+template<typename T, template<typename> class QueueType>
 bool
-DAQSink<T>::can_push() const noexcept
+DAQSink<T, QueueType>::can_push() const noexcept
 {
   return m_queue->can_push();
 }
 
+template<typename T, template<typename> class QueueType>
+void
+DAQSink<T, QueueType>::set_watermarks(double high, double low)
+{
+  if (!(low >= 0 && low < high && high <= 1)) {
+    throw DAQSinkWatermarksInvalid(ERS_HERE, get_name(), high, low);
+  }
+  m_high_watermark = high;
+  m_low_watermark = low;
+  update_pressure();
+}
+
+template<typename T, template<typename> class QueueType>
+double
+DAQSink<T, QueueType>::get_occupancy() const noexcept
+{
+  const size_t capacity = m_queue->get_capacity();
+  double occupancy = capacity > 0 ? static_cast<double>(m_queue->get_num_elements()) / capacity : 0;
+  const size_t capacity_bytes = m_queue->get_capacity_bytes();
+  if (capacity_bytes > 0) {
+    occupancy = std::max(occupancy, static_cast<double>(m_queue->get_bytes()) / capacity_bytes);
+  }
+  return occupancy;
+}
+
+template<typename T, template<typename> class QueueType>
+typename DAQSink<T, QueueType>::Pressure
+DAQSink<T, QueueType>::pressure()
+{
+  if (m_high_watermark > 0) {
+    update_pressure();
+  }
+  return m_pressure.load(std::memory_order_relaxed);
+}
+
+template<typename T, template<typename> class QueueType>
+void
+DAQSink<T, QueueType>::update_pressure()
+{
+  Pressure current = m_pressure.load(std::memory_order_relaxed);
+  const double occupancy = get_occupancy();
+  const Pressure next = current == Pressure::kLow ? (occupancy >= m_high_watermark ? Pressure::kHigh : Pressure::kLow)
+                                                  : (occupancy <= m_low_watermark ? Pressure::kLow : Pressure::kHigh);
+
+  // Only the thread which makes the change calls the callbacks
+  if (next != current && m_pressure.compare_exchange_strong(current, next, std::memory_order_relaxed)) {
+    TLOG_DEBUG(1, "DAQSink") << "Pressure on queue " << get_name() << " is now "
+                             << (next == Pressure::kHigh ? "high" : "low") << " at occupancy " << occupancy;
+    for (auto& callback : m_pressure_callbacks) {
+      callback(next);
+    }
+  }
+}
+
 } // namespace appfwk
 } // namespace dunedaq
 
@@ -16,7 +16,9 @@
 
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <string>
+#include <type_traits>
 #include <typeinfo>
 
 namespace dunedaq {
@@ -33,16 +35,81 @@ ERS_DECLARE_ISSUE(appfwk,                                             // namespa
 
 namespace appfwk {
 
-template<typename T>
+class DAQSourceSet;
+
+/**
+ * @brief Handle through which a module pops from a Queue
+ * @tparam T Type of the elements
+ * @tparam QueueType Queue class the handle is bound to (see DAQSink)
+ *
+ * A BroadcastQueue gives each DAQSource its own view to pop from, so a
+ * DAQSource for one can only be bound to the default, Queue.
+ */
+template<typename T, template<typename> class QueueType = Queue>
 class DAQSource : public Named
 {
 public:
   using value_t = T;
   using duration_t = std::chrono::milliseconds;
 
+  /**
+   * @brief Access to the first element of the Queue, obtained from peek() or view()
+   * @tparam Element T, or const T for the read-only access given by view()
+   *
+   * When the Queue supports it, the element is used in place, inside the
+   * Queue's storage, and its slot is only freed by release() (or when the
+   * Slot is destroyed). Otherwise the element is popped into the Slot.
+   */
+  template<typename Element>
+  class BasicSlot
+  {
+  public:
+    Element& operator*() noexcept { return *m_element; }
+    Element* operator->() noexcept { return m_element; }
+
+    void release();
+
+    ~BasicSlot() { release(); }
+
+    BasicSlot(BasicSlot const&) = delete;
+    BasicSlot(BasicSlot&&) = delete;
+    BasicSlot& operator=(BasicSlot const&) = delete;
+    BasicSlot& operator=(BasicSlot&&) = delete;
+
+  private:
+    friend class DAQSource;
+    BasicSlot(QueueType<T>& queue, const duration_t& timeout);
+
+    QueueType<T>& m_queue;
+    Element* m_element{ nullptr };
+    std::optional<T> m_local; ///< Storage for the element if the Queue doesn't support slots
+  };
+
+  using Slot = BasicSlot<T>;            ///< The element, which the consumer may modify or move from
+  using ConstSlot = BasicSlot<const T>; ///< The element, read-only; shared with other consumers of a BroadcastQueue
+
   explicit DAQSource(const std::string& name);
   void pop(T&, const duration_t& timeout = duration_t::zero());
+  Slot peek(const duration_t& timeout = duration_t::zero());
+  ConstSlot view(const duration_t& timeout = duration_t::zero());
+  size_t pop_n(T* elements, size_t max_count, const duration_t& timeout = duration_t::zero());
+  bool try_pop(T&, const duration_t& timeout = duration_t::zero());
   bool can_pop() const noexcept;
+  // True once the queue is closed; pops then fail as soon as it is empty (see QueueBase::close())
+  bool is_closed() const noexcept { return m_queue->is_closed(); }
+
+  // Give producers credits to push more, once done with what was popped (see QueueBase::enable_credits()); does
+  // nothing if the queue doesn't use credits
+  void grant_credits(size_t credits = 1) noexcept
+  {
+    if (m_queue->uses_credits()) {
+      m_queue->grant_credits(credits);
+    }
+  }
+
+  // See QueueBase::get_readiness_fd() for how to wait on a DAQSource with poll or epoll
+  int get_readiness_fd() { return m_queue->get_readiness_fd(); }
+  void clear_readiness() noexcept { m_queue->clear_readiness(); }
   const std::string& get_name() const final { return m_queue->get_name(); }
 
   DAQSource(DAQSource const&) = delete;
@@ -51,30 +118,104 @@ public:
   DAQSource& operator=(DAQSource&&) = delete;
 
 private:
-  std::shared_ptr<Queue<T>> m_queue;
+  friend class DAQSourceSet;
+
+  std::shared_ptr<QueueType<T>> m_queue;
 };
 
-template<typename T>
-DAQSource<T>::DAQSource(const std::string& name)
+template<typename T, template<typename> class QueueType>
+DAQSource<T, QueueType>::DAQSource(const std::string& name)
 {
   try {
-    m_queue = QueueRegistry::get().get_queue<T>(name);
+    m_queue = QueueRegistry::get().get_queue<T, QueueType>(name);
+    if (auto consumer = m_queue->add_consumer()) {
+      // A consumer pops from its own view, which is only ever bound to the Queue interface
+      m_queue = QueueRegistry::as_queue_type<QueueType>(name, consumer);
+    }
     TLOG_DEBUG(1, "DAQSource") << "Queue " << name << " is at " << m_queue.get();
   } catch (QueueTypeMismatch& ex) {
     throw DAQSourceConstructionFailed(ERS_HERE, name, ex);
+  } catch (QueueKindMismatch& ex) {
+    throw DAQSourceConstructionFailed(ERS_HERE, name, ex);
+  }
+}
+
+template<typename T, template<typename> class QueueType>
+void
+DAQSource<T, QueueType>::pop(T& val, const duration_t& timeout)
+{
+  if (!m_queue->try_pop(val, timeout)) {
+    m_queue->throw_failed("pop", timeout);
   }
 }
 
-template<typename T>
+template<typename T, template<typename> class QueueType>
+size_t
+DAQSource<T, QueueType>::pop_n(T* elements, size_t max_count, const duration_t& timeout)
+{
+  return m_queue->pop_n(elements, max_count, timeout);
+}
+
+template<typename T, template<typename> class QueueType>
+bool
+DAQSource<T, QueueType>::try_pop(T& val, const duration_t& timeout)
+{
+  return m_queue->try_pop(val, timeout);
+}
+
+template<typename T, template<typename> class QueueType>
+typename DAQSource<T, QueueType>::Slot
+DAQSource<T, QueueType>::peek(const duration_t& timeout)
+{
+  return Slot(*m_queue, timeout);
+}
+
+template<typename T, template<typename> class QueueType>
+typename DAQSource<T, QueueType>::ConstSlot
+DAQSource<T, QueueType>::view(const duration_t& timeout)
+{
+  return ConstSlot(*m_queue, timeout);
+}
+
+template<typename T, template<typename> class QueueType>
+template<typename Element>
+DAQSource<T, QueueType>::BasicSlot<Element>::BasicSlot(QueueType<T>& queue, const duration_t& timeout)
+  : m_queue(queue)
+{
+  constexpr bool read_only = std::is_const_v<Element>;
+  if (!(read_only ? m_queue.supports_read_only_slots() : m_queue.supports_slots())) {
+    if (!m_queue.try_pop(m_local.emplace(), timeout)) {
+      m_queue.throw_failed("pop", timeout);
+    }
+    m_element = &*m_local;
+    return;
+  }
+
+  if constexpr (read_only) {
+    m_element = m_queue.try_view(timeout);
+  } else {
+    m_element = m_queue.try_peek(timeout);
+  }
+  if (m_element == nullptr) {
+    m_queue.throw_failed("peek", timeout);
+  }
+}
+
+template<typename T, template<typename> class QueueType>
+template<typename Element>
 void
-DAQSource<T>::pop(T& val, const duration_t& timeout)
+DAQSource<T, QueueType>::BasicSlot<Element>::release()
 {
-  m_queue->pop(val, timeout);
+  if (m_element != nullptr && !m_local) {
+    m_queue.release_peeked();
+  }
+  m_element = nullptr;
+  m_local.reset();
 }
 
-template<typename T>
+template<typename T, template<typename> class QueueType>
 bool
-DAQSource<T>::can_pop() const noexcept
+DAQSource<T, QueueType>::can_pop() const noexcept
 {
   return m_queue->can_pop();
 }
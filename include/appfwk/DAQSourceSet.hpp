@@ -0,0 +1,119 @@
+/**
+ * @file DAQSourceSet.hpp DAQSourceSet class interface
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_DAQSOURCESET_HPP_
+#define APPFWK_INCLUDE_APPFWK_DAQSOURCESET_HPP_
+
+#include "appfwk/DAQSource.hpp"
+#include "appfwk/EventCount.hpp"
+#include "appfwk/QueueBase.hpp"
+#include "appfwk/WaitPolicy.hpp"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace dunedaq::appfwk {
+
+/**
+ * @brief A set of DAQSources which a thread can wait on all at once
+ *
+ * A module which merges several inputs adds its DAQSources to a set, and
+ * then calls wait_any() instead of polling each source in turn. wait_any()
+ * returns the index of a source which has data, which the module then pops
+ * from as usual. The sources may carry different types.
+ *
+ * Every queue in the set notifies the set when it is pushed to, so waiting
+ * costs nothing beyond a short spin, and a push wakes the waiting thread
+ * straight away. A set is meant to be used by one consumer thread.
+ */
+class DAQSourceSet
+{
+public:
+  using duration_t = std::chrono::milliseconds;
+
+  /**
+   * @brief DAQSourceSet Constructor
+   * @param wait_policy How wait_any() waits for data
+   */
+  explicit DAQSourceSet(WaitPolicy wait_policy = WaitPolicy::kSpinPark)
+    : m_wait_policy(wait_policy)
+  {}
+
+  ~DAQSourceSet()
+  {
+    for (auto& queue : m_queues) {
+      queue->remove_listener(&m_data_available);
+    }
+  }
+
+  /**
+   * @brief Add a DAQSource to the set
+   * @return Index of the source, as returned by wait_any()
+   * @throws QueueListenersExhausted if the source's queue is in too many sets already
+   */
+  template<typename T, template<typename> class QueueType>
+  size_t add(DAQSource<T, QueueType>& source)
+  {
+    source.m_queue->add_listener(&m_data_available);
+    m_queues.push_back(source.m_queue);
+    return m_queues.size() - 1;
+  }
+
+  size_t size() const noexcept { return m_queues.size(); }
+
+  /**
+   * @brief Wait until one of the sources has data, or is closed
+   * @param timeout How long to wait
+   * @return Index of a source which has data, or no value if the timeout expired
+   *
+   * Sources are checked starting after the one returned last, so that a busy
+   * source can't starve the others. A source which is closed and empty is
+   * returned too, so that waiting ends at once at stop; popping from it
+   * throws QueueClosed (see DAQSource::is_closed()).
+   */
+  std::optional<size_t> wait_any(const duration_t& timeout = duration_t::zero())
+  {
+    if (auto ready = find_ready(); ready || timeout.count() <= 0) {
+      return ready;
+    }
+
+    std::optional<size_t> ready;
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    wait_until(m_wait_policy, m_data_available, [&]() { return (ready = find_ready()).has_value(); }, deadline);
+    return ready;
+  }
+
+  DAQSourceSet(DAQSourceSet const&) = delete;
+  DAQSourceSet(DAQSourceSet&&) = delete;
+  DAQSourceSet& operator=(DAQSourceSet const&) = delete;
+  DAQSourceSet& operator=(DAQSourceSet&&) = delete;
+
+private:
+  std::optional<size_t> find_ready()
+  {
+    for (size_t i = 0; i < m_queues.size(); ++i) {
+      size_t index = m_next + i < m_queues.size() ? m_next + i : m_next + i - m_queues.size();
+      if (m_queues[index]->get_num_elements() > 0 || m_queues[index]->is_closed()) {
+        m_next = index + 1 < m_queues.size() ? index + 1 : 0;
+        return index;
+      }
+    }
+    return std::nullopt;
+  }
+
+  WaitPolicy m_wait_policy;
+  std::vector<std::shared_ptr<QueueBase>> m_queues;
+  size_t m_next{ 0 }; ///< Index of the source to check first
+  EventCount m_data_available;
+};
+
+} // namespace dunedaq::appfwk
+
+#endif // APPFWK_INCLUDE_APPFWK_DAQSOURCESET_HPP_
@@ -0,0 +1,224 @@
+/**
+ * @file DwellTimeRecorder.hpp
+ *
+ * Measurement of the time elements spend inside a Queue, for operational
+ * monitoring. A DwellTimeRecorder is attached to a QueueBase when dwell time
+ * monitoring is enabled for that Queue in its configuration.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_DWELLTIMERECORDER_HPP_
+#define APPFWK_INCLUDE_APPFWK_DWELLTIMERECORDER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace dunedaq::appfwk {
+
+/**
+ * @brief A lock-free, log-linear histogram of durations in nanoseconds
+ *
+ * Each power of two is split into s_sub_buckets linear buckets, so that a
+ * value is known to within 1/s_sub_buckets of itself whatever its magnitude.
+ * Recording is a single relaxed increment (plus a compare-exchange when a new
+ * maximum is seen), so any number of threads may record concurrently.
+ */
+class LatencyHistogram
+{
+public:
+  /**
+   * @brief Summary of the values recorded between two calls to take_summary()
+   */
+  struct Summary
+  {
+    uint64_t samples = 0; // NOLINT(build/unsigned)
+    uint64_t p50 = 0;     // NOLINT(build/unsigned)
+    uint64_t p99 = 0;     // NOLINT(build/unsigned)
+    uint64_t p999 = 0;    // NOLINT(build/unsigned)
+    uint64_t max = 0;     // NOLINT(build/unsigned)
+  };
+
+  void record(uint64_t value) noexcept // NOLINT(build/unsigned)
+  {
+    m_buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t current_max = m_max.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+    while (value > current_max && !m_max.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  /**
+   * @brief Summarize the recorded values and start over with an empty histogram
+   *
+   * Percentiles are reported as the upper edge of the bucket they fall in,
+   * but never more than the maximum recorded value.
+   */
+  Summary take_summary() noexcept
+  {
+    std::array<uint64_t, s_num_buckets> counts; // NOLINT(build/unsigned)
+    Summary summary;
+    for (size_t i = 0; i < s_num_buckets; ++i) {
+      counts[i] = m_buckets[i].exchange(0, std::memory_order_relaxed);
+      summary.samples += counts[i];
+    }
+    summary.max = m_max.exchange(0, std::memory_order_relaxed);
+    if (summary.samples == 0) {
+      return summary;
+    }
+
+    auto percentile = [&](uint64_t per_mille) { // NOLINT(build/unsigned)
+      const uint64_t rank = (summary.samples * per_mille + 999) / 1000; // NOLINT(build/unsigned)
+      uint64_t seen = 0;                                               // NOLINT(build/unsigned)
+      for (size_t i = 0; i < s_num_buckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+          return std::min(bucket_upper_edge(i), summary.max);
+        }
+      }
+      return summary.max;
+    };
+    summary.p50 = percentile(500);
+    summary.p99 = percentile(990);
+    summary.p999 = percentile(999);
+    return summary;
+  }
+
+  static constexpr size_t bucket_index(uint64_t value) noexcept // NOLINT(build/unsigned)
+  {
+    if (value < s_sub_buckets) {
+      return static_cast<size_t>(value);
+    }
+    const int msb = 63 - __builtin_clzll(value);
+    const uint64_t sub = (value >> (msb - s_sub_bucket_bits)) & (s_sub_buckets - 1); // NOLINT(build/unsigned)
+    return (msb - s_sub_bucket_bits + 1) * s_sub_buckets + sub;
+  }
+
+  static constexpr uint64_t bucket_upper_edge(size_t index) noexcept // NOLINT(build/unsigned)
+  {
+    if (index < s_sub_buckets) {
+      return index;
+    }
+    const int shift = static_cast<int>(index / s_sub_buckets) - 1;
+    const uint64_t sub = index % s_sub_buckets; // NOLINT(build/unsigned)
+    return ((s_sub_buckets + sub + 1) << shift) - 1;
+  }
+
+private:
+  static constexpr int s_sub_bucket_bits = 3;
+  static constexpr size_t s_sub_buckets = size_t(1) << s_sub_bucket_bits;
+  static constexpr size_t s_num_buckets = (64 - s_sub_bucket_bits + 1) * s_sub_buckets;
+
+  std::array<std::atomic<uint64_t>, s_num_buckets> m_buckets{}; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_max{ 0 };                             // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief Records how long elements stay in a FIFO Queue
+ *
+ * Elements are not touched: on_push() stamps the enqueue time into a side
+ * array indexed by the element's position in the push sequence, and on_pop()
+ * looks the stamp up by the position in the pop sequence, which is the same
+ * for a FIFO. Each call reads the clock once, however many elements it covers.
+ * The side array is at least as large as the Queue, so a stamp is never
+ * overwritten before it has been read.
+ *
+ * Queues should call on_push() before making the elements visible to
+ * consumers. Where that isn't possible (with several producers, the push
+ * order is only known after the fact), a consumer can occasionally get to an
+ * element before its stamp, and the stamp then lands in the slot after the
+ * pop has passed it. Each stamp is therefore tagged with the lap of the side
+ * array it belongs to, in the bits above a 48-bit timestamp, and a pop only
+ * records a stamp of its own lap: a stamp which is late, or left over from an
+ * earlier lap, is skipped rather than recorded with a bogus value. Dwell
+ * times are computed modulo 2^48 ns, about three days.
+ */
+class DwellTimeRecorder
+{
+public:
+  explicit DwellTimeRecorder(size_t capacity)
+    : m_lap_shift(side_array_bits(capacity))
+    , m_mask((size_t(1) << m_lap_shift) - 1)
+    , m_stamps(new std::atomic<uint64_t>[m_mask + 1]) // NOLINT(build/unsigned)
+  {
+    for (size_t i = 0; i <= m_mask; ++i) {
+      m_stamps[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void on_push(size_t count) noexcept
+  {
+    const uint64_t now = clock_ns(); // NOLINT(build/unsigned)
+    size_t sequence = m_push_sequence.fetch_add(count, std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i, ++sequence) {
+      m_stamps[sequence & m_mask].store(lap_tag(sequence) | (now & s_stamp_mask), std::memory_order_relaxed);
+    }
+  }
+
+  void on_pop(size_t count) noexcept
+  {
+    const uint64_t now = clock_ns(); // NOLINT(build/unsigned)
+    size_t sequence = m_pop_sequence.fetch_add(count, std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i, ++sequence) {
+      const uint64_t stamp = m_stamps[sequence & m_mask].load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+      if ((stamp & ~s_stamp_mask) == lap_tag(sequence)) {
+        m_histogram.record((now - stamp) & s_stamp_mask);
+      }
+    }
+  }
+
+  LatencyHistogram::Summary take_summary() noexcept { return m_histogram.take_summary(); }
+
+  DwellTimeRecorder(const DwellTimeRecorder&) = delete;            ///< DwellTimeRecorder is not copy-constructible
+  DwellTimeRecorder& operator=(const DwellTimeRecorder&) = delete; ///< DwellTimeRecorder is not copy-assignable
+  DwellTimeRecorder(DwellTimeRecorder&&) = delete;                 ///< DwellTimeRecorder is not move-constructible
+  DwellTimeRecorder& operator=(DwellTimeRecorder&&) = delete;      ///< DwellTimeRecorder is not move-assignable
+
+private:
+  static constexpr size_t s_cache_line_size = 64;
+
+  static constexpr int s_stamp_bits = 48;
+  static constexpr uint64_t s_stamp_mask = (uint64_t(1) << s_stamp_bits) - 1; // NOLINT(build/unsigned)
+
+  // log2 of the side array size, which is a power of two larger than the capacity
+  static int side_array_bits(size_t capacity) noexcept
+  {
+    int bits = 0;
+    while ((size_t(1) << bits) <= capacity) {
+      ++bits;
+    }
+    return bits;
+  }
+
+  // The lap of the side array a sequence number is on, counted from one so
+  // that no lap matches the zeroed slots until they have all been written
+  uint64_t lap_tag(size_t sequence) const noexcept // NOLINT(build/unsigned)
+  {
+    return static_cast<uint64_t>((sequence >> m_lap_shift) + 1) << s_stamp_bits; // NOLINT(build/unsigned)
+  }
+
+  static uint64_t clock_ns() noexcept // NOLINT(build/unsigned)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+  }
+
+  const int m_lap_shift;
+  const size_t m_mask;
+  std::unique_ptr<std::atomic<uint64_t>[]> m_stamps; // NOLINT(build/unsigned) Lap tag and timestamp
+
+  alignas(s_cache_line_size) std::atomic<size_t> m_push_sequence{ 0 };
+  alignas(s_cache_line_size) std::atomic<size_t> m_pop_sequence{ 0 };
+  alignas(s_cache_line_size) LatencyHistogram m_histogram;
+};
+
+} // namespace dunedaq::appfwk
+
+#endif // APPFWK_INCLUDE_APPFWK_DWELLTIMERECORDER_HPP_
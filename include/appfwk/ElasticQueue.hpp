@@ -0,0 +1,177 @@
+#ifndef APPFWK_INCLUDE_APPFWK_ELASTICQUEUE_HPP_
+#define APPFWK_INCLUDE_APPFWK_ELASTICQUEUE_HPP_
+
+/**
+ *
+ * @file ElasticQueue.hpp
+ *
+ * A Queue implementation whose capacity grows, in chunks of storage, under
+ * backpressure, and shrinks back when the queue idles
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/Queue.hpp"
+#include "appfwk/RingStorage.hpp"
+#include "appfwk/TimedMutexCondition.hpp"
+#include "appfwk/WaitPolicy.hpp"
+
+#include "opmonlib/InfoCollector.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dunedaq::appfwk {
+
+/**
+ * @brief A Queue implementation protected by a mutex, like StdDeQueue, whose
+ * storage follows the load
+ * @tparam T Data Type to be stored in the ElasticQueue
+ *
+ * The elements live in a chain of chunks of chunk_capacity slots each. The
+ * queue starts with a capacity of one chunk. When a push leaves it at least
+ * s_grow_watermark_percent full, the pushing thread allocates another chunk,
+ * after releasing the mutex, and the capacity grows by a chunk, for as long
+ * as the chunks fit in max_bytes. Once the queue has stayed at most
+ * s_shrink_watermark_percent full for idle_time, it frees a chunk, and so
+ * on back down to one chunk; this is checked by pops, including ones which
+ * find the queue empty, and by get_info(). Chunks emptied by consumers are
+ * reused by producers, and one chunk more than the capacity is kept for the
+ * chunk consumers are part-way through, so pushing and popping only allocate
+ * or free memory when the capacity changes.
+ */
+template<class T>
+class ElasticQueue final : public Queue<T>
+{
+public:
+  using value_t = T;                                ///< Type of data stored in the ElasticQueue
+  using duration_t = typename Queue<T>::duration_t; ///< Type used for expressing timeouts
+
+  static constexpr size_t s_grow_watermark_percent = 75;   ///< Occupancy at which the queue grows
+  static constexpr size_t s_shrink_watermark_percent = 25; ///< Occupancy under which the queue is idle
+
+  /**
+   * @brief ElasticQueue Constructor
+   * @param name Name of this ElasticQueue instance
+   * @param chunk_capacity Number of elements per chunk, which is also the initial and minimum capacity
+   * @param max_bytes Ceiling on the bytes of storage taken by the chunks, the spare one included; the capacity stays
+   * at one chunk below two chunks' worth
+   * @param idle_time How long the queue has to stay under the shrink watermark before it gives back a chunk
+   * @param wait_policy How to wait for the mutex, and for space (push) or data (pop)
+   * @param storage_options How to back the chunks: NUMA node, prefaulted, locked, huge pages
+   */
+  explicit ElasticQueue(const std::string& name,
+                        size_t chunk_capacity,
+                        size_t max_bytes,
+                        std::chrono::milliseconds idle_time = std::chrono::seconds(1),
+                        WaitPolicy wait_policy = WaitPolicy::kSpinPark,
+                        const PageAllocation::Options& storage_options = {});
+
+  ~ElasticQueue();
+
+  bool can_pop() const noexcept override { return this->get_num_elements() > 0; }
+  bool try_pop(value_t& val, const duration_t&) override; // Returns false if a timeout occurs
+
+  bool can_push() const noexcept override
+  {
+    return this->get_num_elements() < this->get_capacity() && this->within_capacity_bytes();
+  }
+  bool try_push(value_t&&, const duration_t&) override; // Returns false if a timeout occurs
+
+  size_t get_capacity() const noexcept override { return m_capacity.load(std::memory_order_relaxed); }
+
+  size_t get_num_elements() const noexcept override { return m_size.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Capacity the queue may grow to
+   */
+  size_t get_max_capacity() const noexcept override { return m_max_chunks * m_chunk_capacity; }
+
+  /**
+   * @brief Bytes of element storage currently allocated, including the spare chunk
+   */
+  size_t get_footprint() const noexcept;
+
+  size_t get_page_size() const override;
+  int get_numa_node() const override;
+  void move_storage_to_numa_node(int numa_node) override;
+
+  ElasticQueue(const ElasticQueue&) = delete;            ///< ElasticQueue is not copy-constructible
+  ElasticQueue& operator=(const ElasticQueue&) = delete; ///< ElasticQueue is not copy-assignable
+  ElasticQueue(ElasticQueue&&) = delete;                 ///< ElasticQueue is not move-constructible
+  ElasticQueue& operator=(ElasticQueue&&) = delete;      ///< ElasticQueue is not move-assignable
+
+protected:
+  void get_kind_info(opmonlib::InfoCollector& ci) override;
+  void wake_waiters() override;
+
+private:
+  using Chunk = RingStorage<value_t>;
+
+  bool lock_until(std::unique_lock<std::timed_mutex>&, std::chrono::steady_clock::time_point);
+  template<typename Condition>
+  bool wait_until(std::unique_lock<std::timed_mutex>&,
+                  TimedMutexCondition&,
+                  Condition,
+                  std::chrono::steady_clock::time_point);
+
+  // Slot of the element position places after the start of the first chunk in use. Called with the mutex held.
+  void* raw_slot(size_t position) noexcept
+  {
+    Chunk* chunk = m_chunk_chain[(m_first_chunk + position / m_chunk_capacity) % m_chunk_chain.size()];
+    return chunk->raw_slot(position % m_chunk_capacity);
+  }
+  T* slot(size_t position) noexcept { return std::launder(reinterpret_cast<T*>(raw_slot(position))); }
+
+  // Called with the mutex held after a push; returns whether the caller should grow the queue once it has released
+  // the mutex
+  bool should_grow() noexcept;
+  void grow();
+
+  // Called with the mutex held after a pop, or an attempt to pop; returns a chunk for the caller to free once it has
+  // released the mutex, if the queue has idled long enough to shrink
+  std::unique_ptr<Chunk> shrink_if_idle();
+
+  const size_t m_chunk_capacity;
+  const size_t m_max_chunks;
+  const std::chrono::steady_clock::duration m_idle_time;
+  const WaitPolicy m_wait_policy;
+  PageAllocation::Options m_storage_options;
+
+  std::atomic<size_t> m_capacity; ///< Read without the mutex by the spinning wait conditions
+  std::atomic<size_t> m_size{ 0 };
+
+  // Guarded by the mutex
+  std::vector<std::unique_ptr<Chunk>> m_chunks; ///< All of the chunks; one more than the capacity needs
+  std::vector<Chunk*> m_chunk_chain;            ///< Ring of the chunks in use, in element order
+  std::vector<Chunk*> m_spare_chunks;           ///< Chunks not in use
+  size_t m_first_chunk{ 0 };                    ///< Index in m_chunk_chain of the chunk holding the first element
+  size_t m_chunks_in_use{ 0 };
+  size_t m_read_offset{ 0 }; ///< Slot of the first element in the first chunk
+  bool m_growing{ false };   ///< Whether a producer is allocating a chunk
+  bool m_migrating{ false }; ///< Whether move_storage_to_numa_node() is binding the chunks
+  std::chrono::steady_clock::time_point m_idle_since; ///< When the queue went under the shrink watermark
+
+  std::atomic<uint64_t> m_growths{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_shrinks{ 0 }; // NOLINT(build/unsigned)
+  uint64_t m_reported_growths{ 0 };     // NOLINT(build/unsigned)
+  uint64_t m_reported_shrinks{ 0 };     // NOLINT(build/unsigned)
+
+  mutable std::timed_mutex m_mutex; ///< Timed, so that waiting for it gives up at the deadline
+  TimedMutexCondition m_no_longer_full;
+  TimedMutexCondition m_no_longer_empty;
+};
+
+} // namespace dunedaq::appfwk
+
+#include "detail/ElasticQueue.hxx"
+
+#endif // APPFWK_INCLUDE_APPFWK_ELASTICQUEUE_HPP_
@@ -0,0 +1,146 @@
+/**
+ * @file EventCount.hpp
+ *
+ * A futex-based event count, used by the lock-free Queue implementations to
+ * park threads which are waiting for the Queue to change state without
+ * requiring a mutex on the data path.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_EVENTCOUNT_HPP_
+#define APPFWK_INCLUDE_APPFWK_EVENTCOUNT_HPP_
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+
+namespace dunedaq::appfwk {
+
+/**
+ * @brief Hint to the CPU that the calling thread is busy-waiting
+ */
+inline void
+cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * @brief EventCount lets a thread sleep until a condition, which it checks
+ * itself, may have become true
+ *
+ * The waiting side follows the pattern
+ *
+ * @code
+ * while (true) {
+ *   auto key = ec.prepare_wait();
+ *   if (condition()) {
+ *     ec.cancel_wait();
+ *     break;
+ *   }
+ *   ec.wait_until(key, deadline);
+ * }
+ * @endcode
+ *
+ * while the notifying side makes the condition true and then calls
+ * notify_all(). notify_all() costs a fence and a load when nobody is
+ * waiting, and only makes a system call when there are waiters.
+ */
+class EventCount
+{
+public:
+  using key_t = uint32_t; // NOLINT(build/unsigned)
+
+  EventCount() = default;
+
+  /**
+   * @brief Construct an EventCount which threads of several processes may use
+   * @param process_shared Whether the EventCount lives in memory shared between processes
+   *
+   * Waking a process-shared EventCount costs the kernel a little more, as it
+   * can't assume that all waiters share the notifier's address space.
+   */
+  explicit EventCount(bool process_shared) noexcept
+    : m_private_flag(process_shared ? 0 : FUTEX_PRIVATE_FLAG)
+  {}
+
+  /**
+   * @brief Announce the intention to wait
+   * @return Key to pass to wait_until()
+   */
+  key_t prepare_wait() noexcept
+  {
+    m_waiters.fetch_add(1, std::memory_order_seq_cst);
+    return m_epoch.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Withdraw from a prepare_wait() without waiting
+   */
+  void cancel_wait() noexcept { m_waiters.fetch_sub(1, std::memory_order_seq_cst); }
+
+  /**
+   * @brief Sleep until notified after prepare_wait() returned key, or until the deadline
+   * @return False if the deadline passed without a notification
+   */
+  bool wait_until(key_t key, std::chrono::steady_clock::time_point deadline) noexcept
+  {
+    while (m_epoch.load(std::memory_order_acquire) == key) {
+      auto remaining = deadline - std::chrono::steady_clock::now();
+      if (remaining.count() <= 0) {
+        cancel_wait();
+        return false;
+      }
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+      timespec ts;
+      ts.tv_sec = ns / 1000000000;
+      ts.tv_nsec = ns % 1000000000;
+      syscall(SYS_futex, &m_epoch, FUTEX_WAIT | m_private_flag, key, &ts, nullptr, 0);
+    }
+    cancel_wait();
+    return true;
+  }
+
+  /**
+   * @brief Wake all threads waiting on this EventCount
+   */
+  void notify_all() noexcept
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_waiters.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+    m_epoch.fetch_add(1, std::memory_order_acq_rel);
+    syscall(SYS_futex, &m_epoch, FUTEX_WAKE | m_private_flag, INT_MAX, nullptr, nullptr, 0);
+  }
+
+  EventCount(const EventCount&) = delete;            ///< EventCount is not copy-constructible
+  EventCount& operator=(const EventCount&) = delete; ///< EventCount is not copy-assignable
+  EventCount(EventCount&&) = delete;                 ///< EventCount is not move-constructible
+  EventCount& operator=(EventCount&&) = delete;      ///< EventCount is not move-assignable
+
+private:
+  // The futex syscall operates on a 32-bit word
+  static_assert(sizeof(std::atomic<key_t>) == sizeof(key_t), "futex word must be 32 bits");
+
+  std::atomic<key_t> m_epoch{ 0 };
+  std::atomic<key_t> m_waiters{ 0 };
+  int m_private_flag{ FUTEX_PRIVATE_FLAG }; ///< Zero when other processes may wait on m_epoch
+};
+
+} // namespace dunedaq::appfwk
+
+#endif // APPFWK_INCLUDE_APPFWK_EVENTCOUNT_HPP_
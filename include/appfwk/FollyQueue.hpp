@@ -16,49 +16,177 @@
  */
 
 #include "appfwk/Queue.hpp"
+#include "appfwk/WaitPolicy.hpp"
 
 #include "folly/concurrency/DynamicBoundedQueue.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <type_traits>
 #include <utility> // For std::move
 
 namespace dunedaq::appfwk {
 
 template<class T, template<typename, bool> class FollyQueueType>
-class FollyQueue : public Queue<T>
+class FollyQueue final : public Queue<T>
 {
 public:
   using value_t = T;
   using duration_t = typename Queue<T>::duration_t;
 
-  explicit FollyQueue(const std::string& name, size_t capacity)
+  explicit FollyQueue(const std::string& name, size_t capacity, WaitPolicy wait_policy = WaitPolicy::kSpinPark)
     : Queue<T>(name)
     , m_queue(capacity)
     , m_capacity(capacity)
-  {}
+    , m_wait_policy(wait_policy)
+  {
+    if constexpr (std::is_same_v<FollyQueueType<T, true>, folly::DSPSCQueue<T, true>>) {
+      this->use_single_writer_counters();
+    }
+  }
 
-  size_t get_capacity() const noexcept override { return m_capacity; }
+  size_t get_capacity() const noexcept override { return m_capacity.load(std::memory_order_relaxed); }
 
   size_t get_num_elements() const noexcept override { return m_queue.size(); }
 
+  // The Folly queues allocate as they go, so a new capacity is just a new limit. Producers waiting for space
+  // re-check it at least every s_close_check_interval.
+  bool resize(size_t capacity) override
+  {
+    if (capacity == 0 || m_queue.size() > capacity) {
+      return false;
+    }
+    m_queue.reset_capacity(capacity);
+    m_capacity.store(capacity, std::memory_order_relaxed);
+    return true;
+  }
+
   bool can_pop() const noexcept override { return !m_queue.empty(); }
 
-  void pop(value_t& val, const duration_t& dur) override
+  bool try_pop(value_t& val, const duration_t& dur) override
   {
-    if (!m_queue.try_dequeue_for(val, dur)) {
-      throw QueueTimeoutExpired(
-        ERS_HERE, this->get_name(), "pop", std::chrono::duration_cast<std::chrono::milliseconds>(dur).count());
+    if (!m_queue.try_dequeue(val) &&
+        (dur.count() <= 0 || !retry_until(
+                               std::chrono::steady_clock::now() + dur,
+                               [&]() { return m_queue.try_dequeue(val); },
+                               [&](auto remaining) { return m_queue.try_dequeue_for(val, remaining); }))) {
+      this->on_pop_timeout();
+      return false;
     }
+    this->on_popped(1, payload_bytes(val));
+    return true;
   }
 
   bool can_push() const noexcept override { return m_queue.size() < this->get_capacity(); }
 
-  void push(value_t&& t, const duration_t& dur) override
+  bool try_push(value_t&& t, const duration_t& dur) override
+  {
+    if (this->closed()) {
+      return false;
+    }
+    // The element is moved into the queue, and may be popped before it is counted
+    const size_t bytes = payload_bytes(t);
+    // Try without waiting first, so that the time spent blocked is only measured when the queue is full
+    if (!m_queue.try_enqueue(std::move(t))) {
+      if (dur.count() <= 0) {
+        this->on_push_timeout();
+        return false;
+      }
+      auto start_time = std::chrono::steady_clock::now();
+      bool pushed = retry_until(
+        start_time + dur,
+        [&]() { return m_queue.try_enqueue(std::move(t)); },
+        [&](auto remaining) { return m_queue.try_enqueue_for(std::move(t), remaining); });
+      this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
+      if (!pushed) {
+        this->on_push_timeout();
+        return false;
+      }
+    }
+    this->on_pushed(1, bytes);
+    notify_readable();
+    return true;
+  }
+
+  // folly::DynamicBoundedQueue has no bulk operations, so the batch versions go straight to the
+  // non-blocking enqueue/dequeue and only fall back to the timed versions (and hence only
+  // compute a deadline) when the queue is full or empty
+  size_t push_n(value_t* vals, size_t count, const duration_t& dur) override
+  {
+    if (count > 0 && this->closed()) {
+      this->throw_failed("push", dur);
+    }
+    size_t pushed = 0;
+    size_t bytes = 0;
+    auto try_enqueue = [&]() {
+      const size_t value_bytes = payload_bytes(vals[pushed]);
+      if (!m_queue.try_enqueue(std::move(vals[pushed]))) {
+        return false;
+      }
+      bytes += value_bytes;
+      return true;
+    };
+    while (pushed < count && try_enqueue()) {
+      ++pushed;
+    }
+    if (pushed == count) {
+      this->on_pushed(pushed, bytes);
+      notify_readable();
+      return pushed;
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    auto deadline = start_time + dur;
+    while (pushed < count) {
+      const size_t value_bytes = payload_bytes(vals[pushed]);
+      if (!retry_until(
+            deadline,
+            [&]() { return m_queue.try_enqueue(std::move(vals[pushed])); },
+            [&](auto remaining) { return m_queue.try_enqueue_for(std::move(vals[pushed]), remaining); })) {
+        break;
+      }
+      bytes += value_bytes;
+      ++pushed;
+      while (pushed < count && try_enqueue()) {
+        ++pushed;
+      }
+    }
+    this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
+
+    if (pushed < count) {
+      this->on_push_timeout();
+    }
+    if (pushed == 0) {
+      this->throw_failed("push", dur);
+    }
+    this->on_pushed(pushed, bytes);
+    notify_readable();
+    return pushed;
+  }
+
+  size_t pop_n(value_t* vals, size_t max_count, const duration_t& dur) override
   {
-    if (!m_queue.try_enqueue_for(std::move(t), dur)) {
-      throw QueueTimeoutExpired(
-        ERS_HERE, this->get_name(), "push", std::chrono::duration_cast<std::chrono::milliseconds>(dur).count());
+    if (max_count == 0) {
+      return 0;
     }
+    if (!m_queue.try_dequeue(vals[0]) &&
+        !retry_until(
+          std::chrono::steady_clock::now() + dur,
+          [&]() { return m_queue.try_dequeue(vals[0]); },
+          [&](auto remaining) { return m_queue.try_dequeue_for(vals[0], remaining); })) {
+      this->on_pop_timeout();
+      this->throw_failed("pop", dur);
+    }
+    size_t popped = 1;
+    size_t bytes = payload_bytes(vals[0]);
+    while (popped < max_count && m_queue.try_dequeue(vals[popped])) {
+      bytes += payload_bytes(vals[popped]);
+      ++popped;
+    }
+    this->on_popped(popped, bytes);
+    return popped;
   }
 
   // Delete the copy and move operations
@@ -68,11 +196,55 @@ public:
   FollyQueue& operator=(FollyQueue&&) = delete;
 
 private:
+  // How long a thread sleeping inside folly may take to notice that the queue was closed
+  static constexpr auto s_close_check_interval = std::chrono::milliseconds(10);
+
+  // Retry the non-blocking operation while busy-waiting as the WaitPolicy
+  // allows and then, if the policy parks, hand over to the timed operation,
+  // which sleeps inside folly. Nothing can wake a thread sleeping there, so
+  // it sleeps at most s_close_check_interval at a time, and gives up once
+  // the queue is closed. A pop only gets here when the queue is empty, so
+  // giving up doesn't leave elements behind.
+  template<typename Operation, typename TimedOperation>
+  bool retry_until(std::chrono::steady_clock::time_point deadline, Operation&& op, TimedOperation&& timed_op)
+  {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return op();
+    }
+    bool done = false;
+    if (spin_until(m_wait_policy, [&]() { return (done = op()) || this->closed(); }, deadline)) {
+      return done;
+    }
+    if (!parks(m_wait_policy)) {
+      return false;
+    }
+    while (!this->closed()) {
+      auto remaining = deadline - std::chrono::steady_clock::now();
+      if (remaining.count() <= 0) {
+        return false;
+      }
+      if (timed_op(std::min<std::chrono::steady_clock::duration>(remaining, s_close_check_interval))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // folly wakes its own waiters without a fence we could rely on, so pay for
+  // the one which on_readable() needs here
+  void notify_readable() noexcept
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    this->on_readable();
+  }
+
   // The boolean argument is `MayBlock`, where "block" appears to mean
   // "make a system call". With `MayBlock` set to false, the queue
-  // just spin-waits, so we want true
+  // just spin-waits, so we want true; the spinning policies are
+  // implemented above it, with the non-blocking operations
   FollyQueueType<T, true> m_queue;
-  size_t m_capacity;
+  std::atomic<size_t> m_capacity;
+  WaitPolicy m_wait_policy;
 };
 
 template<typename T>
@@ -0,0 +1,220 @@
+/**
+ * @file ObjectPool.hpp
+ *
+ * Pools of preallocated payload objects, which producers take elements from
+ * instead of allocating them, and to which consumers return them when done.
+ * Pools are configured in, and handed out by, the QueueRegistry.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_OBJECTPOOL_HPP_
+#define APPFWK_INCLUDE_APPFWK_OBJECTPOOL_HPP_
+
+#include "appfwk/NamedObject.hpp"
+#include "appfwk/PageAllocation.hpp"
+#include "appfwk/queueinfo/InfoNljs.hpp"
+
+#include "opmonlib/InfoCollector.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace dunedaq {
+
+// Disable coverage collection LCOV_EXCL_START
+/**
+ * @brief PoolExhausted ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,        // namespace
+                  PoolExhausted, // issue class name
+                  name << ": All " << capacity << " objects of the pool are in use",
+                  ((std::string)name)((size_t)capacity))
+// Re-enable coverage collection LCOV_EXCL_STOP
+
+namespace appfwk {
+
+/**
+ * @brief The PoolBase class allows to address generic behavior of any ObjectPool
+ */
+class PoolBase : public NamedObject
+{
+public:
+  explicit PoolBase(const std::string& name)
+    : NamedObject(name)
+  {}
+
+  /**
+   * @brief Method to retrieve information (occupancy, exhaustion) from pools
+   */
+  void get_info(opmonlib::InfoCollector& ci, int /*level*/)
+  {
+    const uint64_t acquisitions = m_acquisitions.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+    const uint64_t exhaustions = m_exhaustions.load(std::memory_order_relaxed);   // NOLINT(build/unsigned)
+
+    queueinfo::PoolInfo info;
+    info.capacity = this->get_capacity();
+    info.number_allocated = this->get_num_allocated();
+    info.page_size = this->get_page_size();
+    info.numa_node = this->get_numa_node();
+    info.acquisitions = acquisitions - m_last_reported_acquisitions;
+    info.exhaustions = exhaustions - m_last_reported_exhaustions;
+    m_last_reported_acquisitions = acquisitions;
+    m_last_reported_exhaustions = exhaustions;
+    ci.add(info);
+  }
+
+  /**
+   * @brief Get the number of objects in the pool
+   */
+  virtual size_t get_capacity() const noexcept = 0;
+
+  /**
+   * @brief Get the size of the pages backing the pool
+   */
+  virtual size_t get_page_size() const noexcept = 0;
+
+  /**
+   * @brief Get the NUMA node the pool is bound to, or -1 if its placement is left to the kernel
+   */
+  virtual int get_numa_node() const noexcept = 0;
+
+  /**
+   * @brief Get the number of objects currently handed out
+   */
+  size_t get_num_allocated() const noexcept
+  {
+    // Load the releases first, so that the difference can't be negative
+    const uint64_t releases = m_releases.load(std::memory_order_acquire); // NOLINT(build/unsigned)
+    return m_acquisitions.load(std::memory_order_acquire) - releases;
+  }
+
+protected:
+  void on_acquired() noexcept { m_acquisitions.fetch_add(1, std::memory_order_relaxed); }
+  void on_released() noexcept { m_releases.fetch_add(1, std::memory_order_relaxed); }
+  void on_exhausted() noexcept { m_exhaustions.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+  static constexpr size_t s_cache_line_size = 64;
+
+  // Objects are typically acquired by a producer and released by a consumer
+  alignas(s_cache_line_size) std::atomic<uint64_t> m_acquisitions{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_exhaustions{ 0 };                             // NOLINT(build/unsigned)
+  alignas(s_cache_line_size) std::atomic<uint64_t> m_releases{ 0 };     // NOLINT(build/unsigned)
+
+  uint64_t m_last_reported_acquisitions{ 0 }; // NOLINT(build/unsigned)
+  uint64_t m_last_reported_exhaustions{ 0 };  // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief A fixed-size pool of T
+ * @tparam T Type of the pooled objects
+ *
+ * All of the memory for the objects is mapped at construction, optionally on
+ * a given NUMA node, prefaulted, locked or backed by huge pages. acquire() constructs an object in a free slot and
+ * returns it in a std::unique_ptr whose deleter destroys the object and
+ * returns its slot to the pool, so the pointer can be pushed through Queues
+ * like any other, and whichever thread drops it gives the memory back.
+ * Taking and returning slots is lock-free: the free slots form a stack of
+ * indices whose head carries a version tag against the ABA problem.
+ *
+ * The pool must outlive every object acquired from it. Pools handed out by
+ * the QueueRegistry live as long as the registry.
+ */
+template<class T>
+class ObjectPool : public PoolBase
+{
+public:
+  /**
+   * @brief Deleter which returns an object to its ObjectPool
+   */
+  class Deleter
+  {
+  public:
+    Deleter() = default;
+    explicit Deleter(ObjectPool* pool) noexcept
+      : m_pool(pool)
+    {}
+
+    void operator()(T* object) const noexcept { m_pool->release(object); }
+
+  private:
+    ObjectPool* m_pool{ nullptr };
+  };
+
+  using pointer_t = std::unique_ptr<T, Deleter>; ///< Handle to an object of the pool
+
+  /**
+   * @brief ObjectPool Constructor
+   * @param name Name of this ObjectPool instance
+   * @param count Number of objects in the pool
+   * @param slab_size Bytes reserved for each object, e.g. to keep objects on
+   * separate cache lines; sizes smaller than a T are rounded up
+   * @param options How to back the pool's memory
+   */
+  ObjectPool(const std::string& name,
+             size_t count,
+             size_t slab_size = 0,
+             const PageAllocation::Options& options = {});
+
+  ~ObjectPool() = default;
+
+  /**
+   * @brief Construct an object in a free slot of the pool
+   * @return Handle to the object, or an empty handle if the pool is exhausted
+   */
+  template<typename... Args>
+  pointer_t try_acquire(Args&&... args);
+
+  /**
+   * @brief Construct an object in a free slot of the pool
+   * @return Handle to the object
+   * @throws PoolExhausted if all of the objects are in use
+   */
+  template<typename... Args>
+  pointer_t acquire(Args&&... args);
+
+  size_t get_capacity() const noexcept override { return m_count; }
+
+  size_t get_page_size() const noexcept override { return m_memory.page_size(); }
+  int get_numa_node() const noexcept override { return m_memory.numa_node(); }
+
+  ObjectPool(const ObjectPool&) = delete;            ///< ObjectPool is not copy-constructible
+  ObjectPool& operator=(const ObjectPool&) = delete; ///< ObjectPool is not copy-assignable
+  ObjectPool(ObjectPool&&) = delete;                 ///< ObjectPool is not move-constructible
+  ObjectPool& operator=(ObjectPool&&) = delete;      ///< ObjectPool is not move-assignable
+
+private:
+  using index_t = uint32_t; // NOLINT(build/unsigned)
+  static constexpr index_t s_no_index = ~index_t(0);
+  static constexpr size_t s_cache_line_size = 64;
+
+  void release(T* object) noexcept;
+
+  index_t pop_free_slot() noexcept;
+  void push_free_slot(index_t index) noexcept;
+
+  void* slot(index_t index) const noexcept { return static_cast<char*>(m_memory.data()) + index * m_stride; }
+
+  const size_t m_count;
+  const size_t m_stride;
+  PageAllocation m_memory;
+  std::unique_ptr<std::atomic<index_t>[]> m_next_free; ///< Links of the free slot stack
+
+  // Version tag in the upper half, index of the top free slot in the lower half
+  alignas(s_cache_line_size) std::atomic<uint64_t> m_free_head; // NOLINT(build/unsigned)
+};
+
+} // namespace appfwk
+} // namespace dunedaq
+
+#include "detail/ObjectPool.hxx"
+
+#endif // APPFWK_INCLUDE_APPFWK_OBJECTPOOL_HPP_
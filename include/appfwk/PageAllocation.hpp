@@ -0,0 +1,159 @@
+/**
+ * @file PageAllocation.hpp
+ *
+ * PageAllocation owns a block of memory obtained directly from the kernel,
+ * so that the framework can control where and how its long-lived buffers
+ * (object pools, queue storage) are placed
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_PAGEALLOCATION_HPP_
+#define APPFWK_INCLUDE_APPFWK_PAGEALLOCATION_HPP_
+
+#include "ers/Issue.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace dunedaq {
+
+// Disable coverage collection LCOV_EXCL_START
+/**
+ * @brief PageAllocationFailed ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,               // namespace
+                  PageAllocationFailed, // issue class name
+                  "Unable to allocate " << bytes << " bytes: " << reason,
+                  ((size_t)bytes)((std::string)reason))
+
+/**
+ * @brief NUMABindingFailed ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,            // namespace
+                  NUMABindingFailed, // issue class name
+                  "Unable to bind " << bytes << " bytes of memory to NUMA node " << numa_node << ": " << reason,
+                  ((size_t)bytes)((int)numa_node)((std::string)reason))
+
+/**
+ * @brief HugePagesUnavailable ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,               // namespace
+                  HugePagesUnavailable, // issue class name
+                  "Unable to back " << bytes << " bytes of memory with huge pages, using regular pages: " << reason,
+                  ((size_t)bytes)((std::string)reason))
+
+/**
+ * @brief MemoryLockFailed ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,           // namespace
+                  MemoryLockFailed, // issue class name
+                  "Unable to lock " << bytes << " bytes of memory in RAM: " << reason,
+                  ((size_t)bytes)((std::string)reason))
+// Re-enable coverage collection LCOV_EXCL_STOP
+
+namespace appfwk {
+
+/**
+ * @brief A page-aligned, zero-initialized block of anonymous memory
+ *
+ * The memory is mapped at construction and unmapped at destruction. It is
+ * not touched, and hence not physically allocated, until it is first used,
+ * unless prefaulting or locking is requested.
+ */
+class PageAllocation
+{
+public:
+  /**
+   * @brief Kinds of huge page backing
+   */
+  enum class HugePages
+  {
+    kNone,        ///< Regular pages
+    kExplicit,    ///< Pages from the kernel's pool of 2 MB huge pages (MAP_HUGETLB)
+    kTransparent, ///< Regular mapping, aligned to 2 MB and advised for transparent huge pages
+  };
+
+  /**
+   * @brief How the memory should be placed
+   */
+  struct Options
+  {
+    int numa_node = -1;                      ///< NUMA node to bind the memory to, or -1 to leave it to the kernel
+    bool prefault = false;                   ///< Whether to touch every page at construction
+    HugePages huge_pages = HugePages::kNone; ///< Whether to back the memory with huge pages
+    bool lock = false;                       ///< Whether to lock the memory in RAM (which also prefaults it)
+  };
+
+  /**
+   * @brief Map at least bytes of memory
+   * @throws PageAllocationFailed if the memory can't be mapped
+   *
+   * Failing to bind to the requested NUMA node, to get huge pages or to lock
+   * the memory is reported as a warning, and the memory is used as the
+   * kernel provides it.
+   */
+  PageAllocation(size_t bytes, const Options& options);
+  ~PageAllocation();
+
+  void* data() const noexcept { return m_data; }
+  size_t size() const noexcept { return m_size; }
+
+  /**
+   * @brief Size of the pages backing the memory. Transparent huge pages are
+   * only reported once the memory, prefaulted or locked, is seen to be backed
+   * by them; otherwise this is the base page size
+   */
+  size_t page_size() const noexcept { return m_page_size; }
+
+  /**
+   * @brief Whether the memory was advised for transparent huge pages, which
+   * the kernel may or may not have used (see page_size())
+   */
+  bool huge_pages_requested() const noexcept { return m_huge_pages_requested; }
+
+  /**
+   * @brief NUMA node the memory is bound to, or -1 if it is left to the kernel
+   */
+  int numa_node() const noexcept { return m_numa_node; }
+
+  /**
+   * @brief Bind the memory to a NUMA node, migrating any pages already touched
+   *
+   * Failure is reported as a warning, and leaves the memory where it is.
+   */
+  void bind_to_numa_node(int numa_node);
+
+  /**
+   * @brief Bind memory mapped elsewhere, e.g. a shared memory segment, to a
+   * NUMA node, migrating any pages already touched
+   * @return false, after reporting a warning, if the memory couldn't be bound
+   */
+  static bool bind_to_numa_node(void* data, size_t bytes, int numa_node);
+
+  /**
+   * @brief NUMA node of the CPU the calling thread runs on, or -1 if unknown
+   */
+  static int current_numa_node() noexcept;
+
+  static constexpr size_t s_huge_page_size = 2 * 1024 * 1024; ///< Size of the huge pages used
+
+  PageAllocation(const PageAllocation&) = delete;            ///< PageAllocation is not copy-constructible
+  PageAllocation& operator=(const PageAllocation&) = delete; ///< PageAllocation is not copy-assignable
+  PageAllocation(PageAllocation&&) = delete;                 ///< PageAllocation is not move-constructible
+  PageAllocation& operator=(PageAllocation&&) = delete;      ///< PageAllocation is not move-assignable
+
+private:
+  void* m_data{ nullptr };
+  size_t m_size{ 0 };
+  size_t m_page_size;
+  bool m_huge_pages_requested{ false }; ///< Whether madvise(MADV_HUGEPAGE) was accepted for the memory
+  int m_numa_node{ -1 };
+};
+
+} // namespace appfwk
+} // namespace dunedaq
+
+#endif // APPFWK_INCLUDE_APPFWK_PAGEALLOCATION_HPP_
@@ -0,0 +1,77 @@
+/**
+ * @file PayloadSize.hpp
+ *
+ * How many bytes of memory a value pushed to a Queue holds on to, used by
+ * the Queues to account for the memory they hold
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_PAYLOADSIZE_HPP_
+#define APPFWK_INCLUDE_APPFWK_PAYLOADSIZE_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace dunedaq::appfwk {
+
+/**
+ * @brief How many bytes of memory a value of T holds on to
+ *
+ * By default this is sizeof(T) or, if T has a member function
+ * `size_t payload_size() const`, what that returns. Payload types whose
+ * size varies and which can't have such a member can specialise this
+ * instead, with a `static size_t bytes(const T&) noexcept`. A
+ * std::unique_ptr or std::shared_ptr counts the object it points to as well,
+ * so a shared object is counted once by every Queue which holds it.
+ *
+ * Queues call this on every push and pop, from within their noexcept paths:
+ * it should be cheap and must not throw.
+ */
+template<typename T, typename = void>
+struct payload_size
+{
+  static constexpr size_t bytes(const T&) noexcept { return sizeof(T); }
+};
+
+template<typename T>
+struct payload_size<T, std::void_t<decltype(std::declval<const T&>().payload_size())>>
+{
+  static size_t bytes(const T& value) noexcept { return value.payload_size(); }
+};
+
+/**
+ * @brief Get the bytes of memory value holds on to, see payload_size
+ */
+template<typename T>
+size_t
+payload_bytes(const T& value) noexcept
+{
+  return payload_size<T>::bytes(value);
+}
+
+template<typename T, typename Deleter>
+struct payload_size<std::unique_ptr<T, Deleter>>
+{
+  static size_t bytes(const std::unique_ptr<T, Deleter>& value) noexcept
+  {
+    return sizeof(value) + (value ? payload_bytes(*value) : 0);
+  }
+};
+
+template<typename T>
+struct payload_size<std::shared_ptr<T>>
+{
+  static size_t bytes(const std::shared_ptr<T>& value) noexcept
+  {
+    return sizeof(value) + (value ? payload_bytes(*value) : 0);
+  }
+};
+
+} // namespace dunedaq::appfwk
+
+#endif // APPFWK_INCLUDE_APPFWK_PAYLOADSIZE_HPP_
@@ -0,0 +1,160 @@
+#ifndef APPFWK_INCLUDE_APPFWK_PRIORITYQUEUE_HPP_
+#define APPFWK_INCLUDE_APPFWK_PRIORITYQUEUE_HPP_
+
+/**
+ *
+ * @file PriorityQueue.hpp
+ *
+ * A Queue implementation with a few priority lanes, each of them a lock-free
+ * ring, which pops the most urgent elements first
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/EventCount.hpp"
+#include "appfwk/Queue.hpp"
+#include "appfwk/RingStorage.hpp"
+#include "appfwk/WaitPolicy.hpp"
+
+#include "opmonlib/InfoCollector.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <type_traits>
+
+namespace dunedaq::appfwk {
+
+/**
+ * @brief Works out the priority of an element pushed to a PriorityQueue
+ * @tparam T Type of the elements
+ *
+ * Specialize this for a type whose elements carry their own priority, e.g.
+ * a request which knows whether it was triggered or is background work.
+ * Priority 0 is the most urgent. The default puts everything in lane 0.
+ */
+template<class T>
+struct QueuePriority
+{
+  static size_t of(const T& /*element*/) noexcept { return 0; }
+};
+
+/**
+ * @brief A Queue implementation whose pops return the most urgent element first
+ * @tparam T Data Type to be stored in the queue
+ *
+ * Elements go to one of a small, fixed number of lanes according to their
+ * priority, which QueuePriority<T> extracts from the element unless the
+ * producer gives it with push (see DAQSink::push(T&&, size_t, ...)).
+ * Priorities past the last lane go to the last lane. A pop takes the oldest
+ * element of the most urgent lane which isn't empty, so elements of the same
+ * priority stay in order.
+ *
+ * Each lane is a bounded lock-free ring for any number of producers and
+ * consumers, with capacity slots rounded up to a power of two, so a backlog of
+ * bulk elements never stops an urgent one from being pushed. A push or pop
+ * which has to wait does so according to the WaitPolicy.
+ */
+template<class T>
+class PriorityQueue final : public Queue<T>
+{
+public:
+  using value_t = T;                                ///< Type of data stored in the PriorityQueue
+  using duration_t = typename Queue<T>::duration_t; ///< Type used for expressing timeouts
+
+  static constexpr size_t s_max_lanes = 8; ///< Maximum number of priority lanes
+
+  /**
+   * @brief PriorityQueue Constructor
+   * @param name Name of this PriorityQueue instance
+   * @param capacity Maximum number of elements in each lane
+   * @param num_lanes Number of priority lanes, between 1 and s_max_lanes
+   * @param wait_policy How to wait when a lane is full (push) or all lanes are empty (pop)
+   * @param storage_options How to back the lanes' storage: NUMA node, prefaulted, locked, huge pages
+   */
+  explicit PriorityQueue(const std::string& name,
+                         size_t capacity,
+                         size_t num_lanes = 2,
+                         WaitPolicy wait_policy = WaitPolicy::kSpinPark,
+                         const PageAllocation::Options& storage_options = {});
+
+  ~PriorityQueue();
+
+  bool can_pop() const noexcept override { return this->get_num_elements() > 0; }
+  bool try_pop(value_t& val, const duration_t&) override; // Returns false if a timeout occurs
+
+  bool try_push(value_t&& val, const duration_t& timeout) override
+  {
+    const size_t priority = QueuePriority<T>::of(val);
+    return try_push_with_priority(std::move(val), priority, timeout);
+  }
+  bool try_push_with_priority(value_t&&, size_t priority, const duration_t&) override;
+
+  size_t get_capacity() const noexcept override { return m_lane_size * m_num_lanes; }
+
+  size_t get_num_elements() const noexcept override;
+
+  size_t get_num_lanes() const noexcept { return m_num_lanes; }
+  size_t get_lane_num_elements(size_t lane) const noexcept;
+
+  size_t get_page_size() const noexcept override { return m_cells.page_size(); }
+  int get_numa_node() const noexcept override { return m_cells.numa_node(); }
+  void move_storage_to_numa_node(int numa_node) override { m_cells.bind_to_numa_node(numa_node); }
+
+  PriorityQueue(const PriorityQueue&) = delete;            ///< PriorityQueue is not copy-constructible
+  PriorityQueue& operator=(const PriorityQueue&) = delete; ///< PriorityQueue is not copy-assignable
+  PriorityQueue(PriorityQueue&&) = delete;                 ///< PriorityQueue is not move-constructible
+  PriorityQueue& operator=(PriorityQueue&&) = delete;      ///< PriorityQueue is not move-assignable
+
+protected:
+  void get_kind_info(opmonlib::InfoCollector& ci) override;
+  void wake_waiters() override;
+
+private:
+  static constexpr size_t s_cache_line_size = 64;
+
+  // A slot of a lane. Its sequence number says whether the slot is free for
+  // the push at a given position, or holds the element for the pop there.
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+
+    T* element() noexcept { return std::launder(reinterpret_cast<T*>(&storage)); }
+  };
+
+  struct Lane
+  {
+    alignas(s_cache_line_size) std::atomic<size_t> push_index{ 0 };
+    alignas(s_cache_line_size) std::atomic<size_t> pop_index{ 0 };
+  };
+
+  Cell& cell(size_t lane, size_t index) noexcept { return *m_cells.slot(lane * m_lane_size + (index & m_mask)); }
+
+  // Push to / pop from one lane without waiting
+  bool try_enqueue(size_t lane, value_t& val);
+  bool try_dequeue(size_t lane, value_t& val);
+  bool try_dequeue_any(value_t& val);
+
+  const size_t m_num_lanes;
+  const size_t m_lane_size;
+  const size_t m_mask;
+  const WaitPolicy m_wait_policy;
+  RingStorage<Cell> m_cells;
+
+  std::array<Lane, s_max_lanes> m_lanes;
+
+  alignas(s_cache_line_size) EventCount m_no_longer_empty;
+  alignas(s_cache_line_size) EventCount m_no_longer_full;
+};
+
+} // namespace dunedaq::appfwk
+
+#include "detail/PriorityQueue.hxx"
+
+#endif // APPFWK_INCLUDE_APPFWK_PRIORITYQUEUE_HPP_
@@ -14,6 +14,7 @@
 #ifndef APPFWK_INCLUDE_APPFWK_QUEUE_HPP_
 #define APPFWK_INCLUDE_APPFWK_QUEUE_HPP_
 
+#include "appfwk/PayloadSize.hpp"
 #include "appfwk/QueueBase.hpp"
 
 #include "opmonlib/InfoCollector.hpp"
@@ -24,9 +25,42 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace dunedaq {
+// Disable coverage collection LCOV_EXCL_START
+/**
+ * @brief QueueTimeoutExpired ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,              // namespace
+                  QueueTimeoutExpired, // issue class name
+                  name << ": Unable to " << func_name << " within timeout period (timeout period was " << timeout
+                       << " milliseconds)",                                  // message
+                  ((std::string)name)((std::string)func_name)((int)timeout)) // NOLINT(readability/casting)
+
+/**
+ * @brief QueueClosed ERS Issue
+ *
+ * Derives from QueueTimeoutExpired, so that code which already treats a
+ * timeout as "nothing more for now" handles a closed queue the same way.
+ */
+ERS_DECLARE_ISSUE_BASE(appfwk,                                                     // namespace
+                       QueueClosed,                                                // issue class name
+                       appfwk::QueueTimeoutExpired,                                // base class of the issue
+                       name << ": Unable to " << func_name << " as the queue is closed", // message
+                       ((std::string)name)((std::string)func_name)((int)timeout), // NOLINT(readability/casting)
+                       ERS_EMPTY)                                                  // attributes of this class
+
+/**
+ * @brief QueueOperationUnsupported ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,                    // namespace
+                  QueueOperationUnsupported, // issue class name
+                  name << ": Queue does not support " << func_name,
+                  ((std::string)name)((std::string)func_name))
+// Re-enable coverage collection LCOV_EXCL_STOP
+
 namespace appfwk {
 
 /**
@@ -66,26 +100,221 @@ public:
   virtual bool can_pop() const { return this->get_num_elements() > 0; }
 
   /**
-   * @brief Push a value onto the Queue.
+   * @brief Try to push a value onto the Queue.
+   * @param val Value to push (rvalue)
+   * @param timeout Timeout for the push operation.
+   * @return True if the value was pushed, false if the timeout expired
+   *
+   * This is a pure virtual function.
+   * Implementations must not throw or allocate on the failure path, so that
+   * polling producers can call this with a zero timeout as often as they like.
+   * On failure val is left untouched.
+   */
+  virtual bool try_push(value_t&& val, const duration_t& timeout) = 0;
+
+  /**
+   * @brief Try to push a value onto the Queue with the given priority
    * @param val Value to push (rvalue)
+   * @param priority Priority of the value, 0 being the most urgent
    * @param timeout Timeout for the push operation.
+   * @return True if the value was pushed, false if the timeout expired
+   *
+   * Queues which keep elements in priority order (see PriorityQueue) use the
+   * priority instead of the one they would work out from the value; all
+   * others ignore it.
+   */
+  virtual bool try_push_with_priority(value_t&& val, size_t /*priority*/, const duration_t& timeout)
+  {
+    return try_push(std::move(val), timeout);
+  }
+
+  /**
+   * @brief Try to pop the first value off of the queue
+   * @param val Reference to the value that is popped from the queue
+   * @param timeout Timeout for the pop operation
+   * @return True if a value was popped, false if the timeout expired
    *
    * This is a pure virtual function.
-   * If push takes longer than the timeout, implementations should throw an
-   * exception.
+   * Implementations must not throw or allocate on the failure path, so that
+   * polling consumers can call this with a zero timeout as often as they like.
    */
-  virtual void push(value_t&& val, const duration_t& timeout) = 0;
+  virtual bool try_pop(value_t& val, const duration_t& timeout) = 0;
+
+  /**
+   * @brief Push a value onto the Queue.
+   * @param val Value to push (rvalue)
+   * @param timeout Timeout for the push operation.
+   * @throws QueueTimeoutExpired if the push takes longer than the timeout
+   * @throws QueueClosed if the queue is closed
+   */
+  void push(value_t&& val, const duration_t& timeout)
+  {
+    if (!try_push(std::move(val), timeout)) {
+      throw_failed("push", timeout);
+    }
+  }
 
   /**
    * @brief Pop the first value off of the queue
    * @param val Reference to the value that is popped from the queue
    * @param timeout Timeout for the pop operation
+   * @throws QueueTimeoutExpired if the pop takes longer than the timeout
+   * @throws QueueClosed if the queue is closed and empty
+   */
+  void pop(value_t& val, const duration_t& timeout)
+  {
+    if (!try_pop(val, timeout)) {
+      throw_failed("pop", timeout);
+    }
+  }
+
+  /**
+   * @brief Throw the issue for a failed operation: QueueClosed if the queue
+   * is closed, QueueTimeoutExpired otherwise
+   */
+  [[noreturn]] void throw_failed(const std::string& func_name, const duration_t& timeout) const
+  {
+    const auto timeout_ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count();
+    if (this->is_closed()) {
+      throw QueueClosed(ERS_HERE, this->get_name(), func_name, timeout_ms);
+    }
+    throw QueueTimeoutExpired(ERS_HERE, this->get_name(), func_name, timeout_ms);
+  }
+
+  /**
+   * @brief Push a batch of values onto the Queue
+   * @param vals Pointer to the first of the values to push (moved from)
+   * @param count Number of values to push
+   * @param timeout Timeout for the whole batch
+   * @return The number of values pushed, which is less than count only if the timeout expired
    *
-   * This is a pure virtual function
-   * If pop takes longer than the timeout, implementations should throw an
-   * exception
+   * Values are pushed in order, so on a partial push the first N values have been moved from.
+   * If no value could be pushed within the timeout, implementations should throw an exception.
+   * The default implementation pushes the values one by one; implementations should override
+   * it to amortize locking and index updates over the batch.
    */
-  virtual void pop(value_t& val, const duration_t& timeout) = 0;
+  virtual size_t push_n(value_t* vals, size_t count, const duration_t& timeout)
+  {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t pushed = 0;
+    for (; pushed < count; ++pushed) {
+      auto remaining = std::chrono::duration_cast<duration_t>(deadline - std::chrono::steady_clock::now());
+      if (!try_push(std::move(vals[pushed]), remaining.count() > 0 ? remaining : duration_t::zero())) {
+        break;
+      }
+    }
+    if (pushed == 0 && count > 0) {
+      throw_failed("push", timeout);
+    }
+    return pushed;
+  }
+
+  /**
+   * @brief Pop a batch of values off of the Queue
+   * @param vals Pointer to storage for at least max_count values
+   * @param max_count Maximum number of values to pop
+   * @param timeout Timeout to wait for the first value
+   * @return The number of values popped (at least one)
+   *
+   * Waits up to the timeout for the Queue to become non-empty, then pops as many values as are
+   * available, up to max_count, without waiting any further. If no value could be popped within
+   * the timeout, implementations should throw an exception. The default implementation pops the
+   * values one by one; implementations should override it to amortize locking and index updates
+   * over the batch.
+   */
+  virtual size_t pop_n(value_t* vals, size_t max_count, const duration_t& timeout)
+  {
+    if (max_count == 0) {
+      return 0;
+    }
+    pop(vals[0], timeout);
+    size_t popped = 1;
+    while (popped < max_count && try_pop(vals[popped], duration_t::zero())) {
+      ++popped;
+    }
+    return popped;
+  }
+
+  /**
+   * @brief Determine whether the Queue gives direct access to its storage
+   * @return True if the slot functions below are implemented
+   *
+   * Queues whose elements live in fixed storage slots can let a producer
+   * construct an element in place and a consumer use it in place, which saves
+   * moving large elements into and out of the Queue. DAQSink and DAQSource
+   * fall back to an ordinary push/pop when this returns false.
+   */
+  virtual bool supports_slots() const noexcept { return false; }
+
+  /**
+   * @brief Determine whether a consumer can read elements in place, through try_view()
+   *
+   * Queues whose consumers share their elements (see BroadcastQueue) only
+   * give read-only access to them, so they support this but not the slots.
+   */
+  virtual bool supports_read_only_slots() const noexcept { return supports_slots(); }
+
+  /**
+   * @brief Reserve storage for the next element to be pushed
+   * @param timeout Timeout to wait for a free slot
+   * @return Pointer to uninitialized storage for one value_t, or nullptr if the timeout expired
+   *
+   * The producer constructs a value_t in the returned storage and then calls
+   * commit_slot() to make it visible to consumers, or calls cancel_slot()
+   * (without having constructed anything) to give the storage back. Only one
+   * reservation may be outstanding at a time.
+   */
+  virtual void* try_reserve_slot(const duration_t& /*timeout*/)
+  {
+    throw QueueOperationUnsupported(ERS_HERE, this->get_name(), "try_reserve_slot");
+  }
+
+  /**
+   * @brief Publish the element constructed in the slot returned by try_reserve_slot()
+   */
+  virtual void commit_slot() { throw QueueOperationUnsupported(ERS_HERE, this->get_name(), "commit_slot"); }
+
+  /**
+   * @brief Give back the slot returned by try_reserve_slot(), which must not hold a constructed element
+   */
+  virtual void cancel_slot() { throw QueueOperationUnsupported(ERS_HERE, this->get_name(), "cancel_slot"); }
+
+  /**
+   * @brief Get access to the first element of the Queue without popping it
+   * @param timeout Timeout to wait for an element
+   * @return Pointer to the element inside the Queue's storage, or nullptr if the timeout expired
+   *
+   * The element stays in the Queue, and its slot stays occupied, until
+   * release_peeked() is called. Only one peek may be outstanding at a time.
+   */
+  virtual value_t* try_peek(const duration_t& /*timeout*/)
+  {
+    throw QueueOperationUnsupported(ERS_HERE, this->get_name(), "try_peek");
+  }
+
+  /**
+   * @brief Get read-only access to the first element of the Queue without popping it
+   * @param timeout Timeout to wait for an element
+   * @return Pointer to the element inside the Queue's storage, or nullptr if the timeout expired
+   *
+   * As try_peek(), for consumers which don't modify the element; release it with release_peeked().
+   */
+  virtual const value_t* try_view(const duration_t& timeout) { return try_peek(timeout); }
+
+  /**
+   * @brief Destroy the element returned by try_peek() or try_view() and free its slot
+   */
+  virtual void release_peeked() { throw QueueOperationUnsupported(ERS_HERE, this->get_name(), "release_peeked"); }
+
+  /**
+   * @brief Get the view of the Queue which a new consumer pops from
+   * @return The Queue to pop from, or nullptr if consumers pop from this Queue directly
+   *
+   * Queues which deliver every element to every consumer (see BroadcastQueue)
+   * keep a read position for each consumer, and return a view which pops from
+   * it. DAQSource calls this once, when it is constructed.
+   */
+  virtual std::shared_ptr<Queue<T>> add_consumer() { return nullptr; }
 
 private:
   Queue(const Queue&) = delete;
@@ -95,16 +324,6 @@ private:
 };
 
 } // namespace appfwk
-// Disable coverage collection LCOV_EXCL_START
-/**
- * @brief QueueTimeoutExpired ERS Issue
- */
-ERS_DECLARE_ISSUE(appfwk,              // namespace
-                  QueueTimeoutExpired, // issue class name
-                  name << ": Unable to " << func_name << " within timeout period (timeout period was " << timeout
-                       << " milliseconds)",                                  // message
-                  ((std::string)name)((std::string)func_name)((int)timeout)) // NOLINT(readability/casting)
-// Re-enable coverage collection LCOV_EXCL_STOP
 } // namespace dunedaq
 
 #endif // APPFWK_INCLUDE_APPFWK_QUEUE_HPP_
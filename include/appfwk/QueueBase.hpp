@@ -15,16 +15,22 @@
 #ifndef APPFWK_INCLUDE_APPFWK_QUEUEBASE_HPP_
 #define APPFWK_INCLUDE_APPFWK_QUEUEBASE_HPP_
 
+#include "appfwk/DwellTimeRecorder.hpp"
+#include "appfwk/EventCount.hpp"
 #include "appfwk/NamedObject.hpp"
+#include "appfwk/PageAllocation.hpp"
+#include "appfwk/ReadinessNotifier.hpp"
 #include "appfwk/queueinfo/InfoNljs.hpp"
 
 #include "opmonlib/InfoCollector.hpp"
 
 #include "ers/Issue.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -53,21 +59,444 @@ public:
    */
   void get_info(opmonlib::InfoCollector& ci, int /*level*/)
   {
+    // The consumer only notes its NUMA node; the storage is moved here, off the data path
+    const int consumer_numa_node = m_consumer_numa_node.exchange(-1, std::memory_order_acquire);
+    if (consumer_numa_node >= 0) {
+      move_storage_to_numa_node(consumer_numa_node);
+    }
+
     queueinfo::Info info;
     info.capacity = this->get_capacity();
     info.number_of_elements = this->get_num_elements();
+    info.page_size = this->get_page_size();
+    info.numa_node = this->get_numa_node();
+    info.capacity_bytes = m_capacity_bytes;
+    info.credits = m_uses_credits ? static_cast<int64_t>(get_credits()) : -1;
+
+    // The high-water mark starts again from the bytes in the queue now
+    const size_t bytes = this->get_bytes();
+    const size_t high_water = m_producer_counters.bytes_high_water.exchange(bytes, std::memory_order_relaxed);
+    info.bytes = bytes;
+    info.bytes_high_water = std::max(high_water, bytes);
+
+    // The counters only ever increase; report how much they moved since the
+    // previous call, i.e. over one monitoring interval
+    Counters current{ m_producer_counters.pushes.load(std::memory_order_relaxed),
+                      m_consumer_counters.pops.load(std::memory_order_relaxed),
+                      m_producer_counters.push_timeouts.load(std::memory_order_relaxed),
+                      m_consumer_counters.pop_timeouts.load(std::memory_order_relaxed),
+                      m_producer_counters.push_blocked_ns.load(std::memory_order_relaxed),
+                      m_producer_counters.drops.load(std::memory_order_relaxed) };
+    info.pushes = current.pushes - m_last_reported.pushes;
+    info.pops = current.pops - m_last_reported.pops;
+    info.push_timeouts = current.push_timeouts - m_last_reported.push_timeouts;
+    info.pop_timeouts = current.pop_timeouts - m_last_reported.pop_timeouts;
+    info.push_blocked_ns = current.push_blocked_ns - m_last_reported.push_blocked_ns;
+    info.drops = current.drops - m_last_reported.drops;
+    m_last_reported = current;
+
     ci.add(info);
+
+    get_kind_info(ci);
+
+    if (m_dwell_time) {
+      auto summary = m_dwell_time->take_summary();
+      queueinfo::DwellTime dwell_time;
+      dwell_time.samples = summary.samples;
+      dwell_time.p50_ns = summary.p50;
+      dwell_time.p99_ns = summary.p99;
+      dwell_time.p999_ns = summary.p999;
+      dwell_time.max_ns = summary.max;
+      ci.add(dwell_time);
+    }
   }
 
+  /**
+   * @brief Start measuring how long elements stay in the queue
+   *
+   * Must be called before the queue is used, as it is by QueueRegistry when
+   * the queue is configured with dwell time monitoring.
+   */
+  void enable_dwell_time_monitoring() { m_dwell_time = std::make_unique<DwellTimeRecorder>(this->get_max_capacity()); }
+
   /**
    * @brief Get the capacity (max size) of the queue
    * @return size_t capacity
    */
   virtual size_t get_capacity() const = 0;
 
+  /**
+   * @brief Get the capacity the queue may grow to, which is its capacity unless it resizes itself
+   */
+  virtual size_t get_max_capacity() const { return this->get_capacity(); }
+
   virtual size_t get_num_elements() const = 0;
 
+  /**
+   * @brief Get the bytes of memory held by the elements in the queue, as told by payload_size
+   *
+   * Each element is counted from when it is pushed until it is popped, or
+   * for a BroadcastQueue until every consumer is done with it.
+   */
+  virtual size_t get_bytes() const noexcept
+  {
+    // Some queues count an element's bytes only after it may already have been popped, so clamp at zero
+    const size_t popped = m_consumer_counters.bytes_popped.load(std::memory_order_relaxed);
+    const size_t pushed = m_producer_counters.bytes_pushed.load(std::memory_order_relaxed);
+    return pushed > popped ? pushed - popped : 0;
+  }
+
+  /**
+   * @brief Get the most bytes the queue has held since the last get_info()
+   */
+  size_t get_bytes_high_water() const noexcept
+  {
+    return std::max<size_t>(m_producer_counters.bytes_high_water.load(std::memory_order_relaxed), get_bytes());
+  }
+
+  /**
+   * @brief Limit the bytes of memory the elements in the queue may hold, on top of its capacity in elements
+   * @param capacity_bytes Bytes the queue may hold, 0 for no limit
+   *
+   * A push is let through as long as the queue holds fewer bytes than this,
+   * so a push, or a batch, may take the queue over the limit, and an element
+   * larger than the limit still gets through an empty queue. Only queues
+   * which test for space themselves (StdDeQueue, SPSCRingQueue, ElasticQueue)
+   * enforce this. Must be called before the queue is used, as it is by
+   * QueueRegistry when the queue is configured with a capacity in bytes.
+   */
+  void set_capacity_bytes(size_t capacity_bytes) noexcept { m_capacity_bytes = capacity_bytes; }
+
+  /**
+   * @brief Get the limit on the bytes held by the queue, 0 if there is none
+   */
+  size_t get_capacity_bytes() const noexcept { return m_capacity_bytes; }
+
+  /**
+   * @brief Change the capacity of the queue, keeping the elements in it
+   * @param capacity New maximum number of elements, at least 1
+   * @return false if this kind of queue can't be resized, or it holds more than capacity elements
+   *
+   * May be called while producers and consumers use the queue, from any
+   * other thread. Storage which has to grow is allocated by the calling
+   * thread, not by a push or pop. A queue monitoring dwell time keeps the
+   * side array sized for its initial capacity, so after growing past it some
+   * dwell times may be under-reported.
+   */
+  virtual bool resize(size_t /*capacity*/) { return false; }
+
+  /**
+   * @brief Get the size of the pages backing the queue's storage
+   * @return size_t page size in bytes, or 0 if the storage isn't allocated by the framework
+   */
+  virtual size_t get_page_size() const { return 0; }
+
+  /**
+   * @brief Get the NUMA node the queue's storage is bound to
+   * @return int NUMA node, or -1 if the placement is left to the kernel
+   */
+  virtual int get_numa_node() const { return -1; }
+
+  /**
+   * @brief Bind the queue's storage to a NUMA node, migrating it if needed.
+   * Does nothing for queues whose storage isn't allocated by the framework
+   *
+   * May be called while the queue is in use, from a thread which neither
+   * pushes nor pops; implementations don't hold up producers and consumers
+   * while the pages move.
+   */
+  virtual void move_storage_to_numa_node(int /*numa_node*/) {}
+
+  /**
+   * @brief Move the queue's storage to the NUMA node of the first thread to
+   * pop from it, i.e. next to the consumer, which reads every element
+   *
+   * The first pop only notes the consumer's node; the storage is moved by
+   * the next get_info(), on the monitoring thread, so that the consumer isn't
+   * held up while the pages migrate. Must be called before the queue is used,
+   * as it is by QueueRegistry when the queue is configured to follow its
+   * consumer.
+   */
+  void follow_consumer() noexcept { m_consumer_counters.follow_consumer.store(true, std::memory_order_relaxed); }
+
+  /**
+   * @brief Have listener notified whenever elements are pushed to the queue
+   *
+   * This lets a thread wait on several queues at once (see DAQSourceSet). A
+   * queue without listeners pays a flag test per push for this.
+   * @throws QueueListenersExhausted if ReadinessNotifier::s_max_listeners listeners are already registered
+   */
+  virtual void add_listener(EventCount* listener) { m_readiness.add_listener(listener, this->get_name()); }
+
+  /**
+   * @brief Stop notifying listener. Once this returns, the queue no longer uses it
+   */
+  virtual void remove_listener(EventCount* listener) { m_readiness.remove_listener(listener); }
+
+  /**
+   * @brief Get a file descriptor which becomes readable when the queue has data
+   * @throws QueueReadinessFDFailed if the eventfd can't be created
+   *
+   * The descriptor, a non-blocking eventfd created on the first call, can be
+   * waited on with poll or epoll alongside sockets and timers. It is raised
+   * at most once between calls to clear_readiness(), so the consumer should
+   * call clear_readiness() and then pop until the queue is empty before it
+   * waits again. Queues which are never asked for a descriptor don't pay for
+   * one.
+   */
+  virtual int get_readiness_fd() { return m_readiness.get_fd(this->get_name(), this->get_num_elements() > 0); }
+
+  /**
+   * @brief Reset the readiness file descriptor, so that the next push raises it again
+   */
+  virtual void clear_readiness() noexcept { m_readiness.clear_fd(); }
+
+  /**
+   * @brief Close the queue, so that nobody waits on it any longer
+   *
+   * Once the queue is closed, pushes fail straight away, and pops return the
+   * elements still in the queue and then fail straight away instead of
+   * waiting for their timeout. Queue::push() and Queue::pop() then throw
+   * QueueClosed, and is_closed() tells a failed try_push() or try_pop() from
+   * a timeout. Threads blocked in the queue, and listeners, are woken.
+   * DAQModuleManager closes a module's input queues when it stops the module.
+   */
+  void close()
+  {
+    m_closed.store(true, std::memory_order_seq_cst);
+    wake_waiters();
+    m_credits_granted.notify_all();
+    on_readable();
+  }
+
+  /**
+   * @brief Let the queue be used again after close(), e.g. at the next start
+   */
+  void reopen() noexcept { m_closed.store(false, std::memory_order_seq_cst); }
+
+  /**
+   * @brief Determine whether the queue has been closed
+   */
+  virtual bool is_closed() const noexcept { return closed(); }
+
+  /**
+   * @brief Have producers spend a credit for each element they push through a DAQSink
+   * @param credits Credits the producers start with
+   *
+   * Consumers grant credits back with grant_credits(), typically once they
+   * are done with an element rather than when they pop it, so producers
+   * can't get further ahead than the consumers allow, however large the
+   * queue. A DAQSink without credits waits for some as it would for space.
+   * Must be called before the queue is used, as it is by QueueRegistry when
+   * the queue is configured with credits.
+   */
+  void enable_credits(size_t credits) noexcept
+  {
+    m_credits.store(credits, std::memory_order_relaxed);
+    m_uses_credits = true;
+  }
+
+  /**
+   * @brief Determine whether producers spend credits to push (see enable_credits())
+   */
+  bool uses_credits() const noexcept { return m_uses_credits; }
+
+  /**
+   * @brief Get the credits producers have left to spend
+   */
+  size_t get_credits() const noexcept { return m_credits.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Give producers credits to spend, and wake those waiting for some
+   */
+  void grant_credits(size_t credits) noexcept
+  {
+    m_credits.fetch_add(credits, std::memory_order_release);
+    m_credits_granted.notify_all();
+  }
+
+  /**
+   * @brief Take up to max_credits credits, waiting until the deadline for at least one
+   * @return The number of credits taken, 0 if the deadline passed or the queue was closed first
+   */
+  size_t take_credits(size_t max_credits, std::chrono::steady_clock::time_point deadline) noexcept
+  {
+    size_t available = m_credits.load(std::memory_order_relaxed);
+    while (true) {
+      while (available > 0) {
+        const size_t taken = std::min(available, max_credits);
+        if (m_credits.compare_exchange_weak(
+              available, available - taken, std::memory_order_acquire, std::memory_order_relaxed)) {
+          return taken;
+        }
+      }
+      if (closed() || std::chrono::steady_clock::now() >= deadline) {
+        return 0;
+      }
+
+      auto key = m_credits_granted.prepare_wait();
+      available = m_credits.load(std::memory_order_relaxed);
+      if (available > 0 || closed()) {
+        m_credits_granted.cancel_wait();
+        continue;
+      }
+      m_credits_granted.wait_until(key, deadline);
+      available = m_credits.load(std::memory_order_relaxed);
+    }
+  }
+
+protected:
+  // Implementations override this to publish monitoring information specific to their kind
+  virtual void get_kind_info(opmonlib::InfoCollector& /*ci*/) {}
+
+  // Implementations test this before pushing and whenever they would wait,
+  // and override wake_waiters() to wake every thread waiting inside them.
+  // close() sets the flag before it calls wake_waiters(), so a waiter which
+  // tests the flag after announcing that it is about to sleep can't miss it.
+  bool closed() const noexcept { return m_closed.load(std::memory_order_acquire); }
+  virtual void wake_waiters() {}
+
+  // Implementations call this once pushed elements are visible to consumers,
+  // after a sequentially consistent fence (or read-modify-write) which orders
+  // the elements' publication before the listener check, pairing with the
+  // check of the queue a listener makes before it sleeps. The fence in
+  // EventCount::notify_all(), when they wake their own waiters first, does.
+  void on_readable() noexcept { m_readiness.notify(); }
+
+  // Implementations test this wherever they test for space, when they
+  // enforce a capacity in bytes. Without one it costs a single test.
+  bool within_capacity_bytes() const noexcept { return m_capacity_bytes == 0 || get_bytes() < m_capacity_bytes; }
+
+  // Implementations whose pushes are never concurrent with each other, nor
+  // their pops with each other, because there is a single producer and a
+  // single consumer or because they push and pop with a mutex held, call this
+  // from their constructor. on_pushed(), on_popped() and on_released() then
+  // update the counters with a relaxed load and store each, which is cheaper
+  // than an atomic read-modify-write.
+  void use_single_writer_counters() noexcept { m_single_writer_counters = true; }
+
+  // Implementations call these when elements enter or leave the queue, with
+  // the payload_bytes() of the elements. Apart from relaxed increments, they
+  // cost a few tests unless dwell time monitoring is enabled.
+  void on_pushed(size_t count, size_t bytes) noexcept
+  {
+    add_to(m_producer_counters.pushes, count);
+    const size_t bytes_pushed = add_to(m_producer_counters.bytes_pushed, bytes);
+    // Only the consumers' counter, on their cache line, can tell whether the queue holds more bytes than ever, so
+    // look at it only when our stale copy of it says that it may
+    if (bytes_pushed - m_producer_counters.cached_bytes_popped.load(std::memory_order_relaxed) >
+        m_producer_counters.bytes_high_water.load(std::memory_order_relaxed)) {
+      update_bytes_high_water(bytes_pushed);
+    }
+    if (m_dwell_time) {
+      m_dwell_time->on_push(count);
+    }
+  }
+  void on_popped(size_t count, size_t bytes) noexcept
+  {
+    add_to(m_consumer_counters.pops, count);
+    add_to(m_consumer_counters.bytes_popped, bytes);
+    if (m_dwell_time) {
+      m_dwell_time->on_pop(count);
+    }
+    if (m_consumer_counters.follow_consumer.load(std::memory_order_relaxed) &&
+        m_consumer_counters.follow_consumer.exchange(false, std::memory_order_relaxed)) {
+      m_consumer_numa_node.store(PageAllocation::current_numa_node(), std::memory_order_release);
+    }
+  }
+
+  // Implementations call these when a push or pop gives up (including a
+  // failed attempt with zero timeout), and when a push had to wait for space
+  // or for a lock before it could complete or give up
+  void on_push_timeout() noexcept { m_producer_counters.push_timeouts.fetch_add(1, std::memory_order_relaxed); }
+  void on_pop_timeout() noexcept { m_consumer_counters.pop_timeouts.fetch_add(1, std::memory_order_relaxed); }
+  void on_push_blocked(std::chrono::steady_clock::duration blocked) noexcept
+  {
+    m_producer_counters.push_blocked_ns.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(blocked).count(), std::memory_order_relaxed);
+  }
+
+  // Implementations which discard elements to make room for new ones call this
+  void on_dropped(size_t count) noexcept { m_producer_counters.drops.fetch_add(count, std::memory_order_relaxed); }
+
+  // Implementations whose elements leave the queue other than by being popped call this with their bytes
+  void on_released(size_t bytes) noexcept { add_to(m_consumer_counters.bytes_popped, bytes); }
+
 private:
+  static constexpr size_t s_cache_line_size = 64;
+
+  // Add to a counter and return its new value
+  uint64_t add_to(std::atomic<uint64_t>& counter, uint64_t value) noexcept // NOLINT(build/unsigned)
+  {
+    if (m_single_writer_counters) {
+      const uint64_t sum = counter.load(std::memory_order_relaxed) + value; // NOLINT(build/unsigned)
+      counter.store(sum, std::memory_order_relaxed);
+      return sum;
+    }
+    return counter.fetch_add(value, std::memory_order_relaxed) + value;
+  }
+
+  // With several producers, others may have pushed, and consumers popped, more than bytes_pushed by now
+  void update_bytes_high_water(size_t bytes_pushed) noexcept
+  {
+    const size_t bytes_popped = m_consumer_counters.bytes_popped.load(std::memory_order_relaxed);
+    m_producer_counters.cached_bytes_popped.store(bytes_popped, std::memory_order_relaxed);
+    if (bytes_popped >= bytes_pushed) {
+      return;
+    }
+    const uint64_t bytes = bytes_pushed - bytes_popped;                                         // NOLINT
+    uint64_t high_water = m_producer_counters.bytes_high_water.load(std::memory_order_relaxed); // NOLINT
+    while (bytes > high_water &&
+           !m_producer_counters.bytes_high_water.compare_exchange_weak(high_water, bytes, std::memory_order_relaxed)) {
+    }
+  }
+
+  struct Counters
+  {
+    uint64_t pushes = 0;          // NOLINT(build/unsigned)
+    uint64_t pops = 0;            // NOLINT(build/unsigned)
+    uint64_t push_timeouts = 0;   // NOLINT(build/unsigned)
+    uint64_t pop_timeouts = 0;    // NOLINT(build/unsigned)
+    uint64_t push_blocked_ns = 0; // NOLINT(build/unsigned)
+    uint64_t drops = 0;           // NOLINT(build/unsigned)
+  };
+
+  // Producers and consumers update their counters on separate cache lines, so
+  // that counting doesn't make a producer and a consumer contend
+  struct alignas(s_cache_line_size) ProducerCounters
+  {
+    std::atomic<uint64_t> pushes{ 0 };              // NOLINT(build/unsigned)
+    std::atomic<uint64_t> push_timeouts{ 0 };       // NOLINT(build/unsigned)
+    std::atomic<uint64_t> push_blocked_ns{ 0 };     // NOLINT(build/unsigned)
+    std::atomic<uint64_t> drops{ 0 };               // NOLINT(build/unsigned)
+    std::atomic<uint64_t> bytes_pushed{ 0 };        // NOLINT(build/unsigned)
+    std::atomic<uint64_t> bytes_high_water{ 0 };    // NOLINT(build/unsigned)
+    std::atomic<uint64_t> cached_bytes_popped{ 0 }; // NOLINT(build/unsigned) Producers' copy of bytes_popped
+  };
+  struct alignas(s_cache_line_size) ConsumerCounters
+  {
+    std::atomic<uint64_t> pops{ 0 };         // NOLINT(build/unsigned)
+    std::atomic<uint64_t> pop_timeouts{ 0 }; // NOLINT(build/unsigned)
+    std::atomic<uint64_t> bytes_popped{ 0 }; // NOLINT(build/unsigned)
+    std::atomic<bool> follow_consumer{ false }; ///< Consumer's NUMA node still to be noted
+  };
+
+  ProducerCounters m_producer_counters;
+  ConsumerCounters m_consumer_counters;
+  Counters m_last_reported; ///< Counter values at the previous get_info()
+  size_t m_capacity_bytes{ 0 };
+  bool m_single_writer_counters{ false }; ///< See use_single_writer_counters()
+  std::atomic<int> m_consumer_numa_node{ -1 }; ///< Noted by the consumer, for get_info() to move the storage to
+
+  std::unique_ptr<DwellTimeRecorder> m_dwell_time;
+
+  ReadinessNotifier m_readiness;
+  std::atomic<bool> m_closed{ false };
+
+  bool m_uses_credits{ false };
+  alignas(s_cache_line_size) std::atomic<size_t> m_credits{ 0 }; ///< Spent by producers, granted by consumers
+  EventCount m_credits_granted;
+
   QueueBase(const QueueBase&) = delete;
   QueueBase& operator=(const QueueBase&) = delete;
   QueueBase(QueueBase&&) = default;
@@ -11,14 +11,21 @@
 #ifndef APPFWK_INCLUDE_APPFWK_QUEUEREGISTRY_HPP_
 #define APPFWK_INCLUDE_APPFWK_QUEUEREGISTRY_HPP_
 
+#include "appfwk/BroadcastQueue.hpp"
+#include "appfwk/ObjectPool.hpp"
 #include "appfwk/Queue.hpp"
+#include "appfwk/WaitPolicy.hpp"
 
 #include "ers/Issue.hpp"
 #include "opmonlib/InfoCollector.hpp"
 
 #include <map>
 #include <memory>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <typeinfo>
+#include <unordered_map>
 
 namespace dunedaq {
 namespace appfwk {
@@ -38,6 +45,11 @@ struct QueueConfig
     kStdDeQueue = 1, ///< The StdDeQueue
     kFollySPSCQueue = 2,
     kFollyMPMCQueue = 3,
+    kSPSCRingQueue = 4, ///< The lock-free SPSCRingQueue
+    kBroadcastQueue = 5, ///< The fan-out BroadcastQueue
+    kPriorityQueue = 6,  ///< The PriorityQueue, with one lock-free lane per priority
+    kSharedMemoryQueue = 7, ///< The SharedMemoryQueue, between processes on the same host
+    kElasticQueue = 8,      ///< The ElasticQueue, whose capacity follows the load
   };
 
   /**
@@ -47,14 +59,88 @@ struct QueueConfig
    */
   static queue_kind stoqk(const std::string& name);
 
+  /**
+   * @brief  Transform a queue_kind to its name, the inverse of stoqk
+   */
+  static std::string qktos(queue_kind kind);
+
+  /**
+   * @brief  Choose the cheapest kind of Queue which is correct for the endpoints it has
+   * @param producers Number of endpoints which push to the Queue, 0 if not known
+   * @param consumers Number of endpoints which pop from the Queue, 0 if not known
+   * @param config Configuration of the Queue, for the options which not every kind supports
+   * @return kSPSCRingQueue for one producer and one consumer, otherwise a kind which allows any number of each
+   */
+  static queue_kind select_kind(size_t producers, size_t consumers, const QueueConfig& config);
+
+  /**
+   * @brief  Transform a string to a WaitPolicy
+   * @param name Name of the WaitPolicy, e.g. "SpinPark"
+   * @return WaitPolicy corresponding to the name
+   */
+  static WaitPolicy stowp(const std::string& name);
+
+  /**
+   * @brief The WaitPolicy a Queue of the given kind is made with when the configuration doesn't set one
+   * @return kBlock for a StdDeQueue, which has always slept straight away, kSpinPark for the other kinds
+   */
+  static WaitPolicy default_wait_policy(queue_kind kind);
+
   QueueConfig::queue_kind kind = queue_kind::kUnknown; ///< The kind of Queue represented by this
                                                        ///< QueueConfig
   size_t capacity = 0;                                 ///< The maximum size of the queue
+  bool dwell_time = false;                             ///< Whether to monitor how long elements stay in the queue
+  std::optional<WaitPolicy> wait_policy;               ///< How threads wait on a full or empty queue, if not
+                                                       ///< default_wait_policy(kind)
+  bool prefault = false;                               ///< Whether to touch preallocated storage at construction
+  PageAllocation::HugePages huge_pages = PageAllocation::HugePages::kNone; ///< Whether to back preallocated
+                                                                           ///< storage with huge pages
+  bool lock_memory = false;     ///< Whether to lock preallocated storage in RAM
+  int numa_node = -1;           ///< The NUMA node to place preallocated storage on, -1 for no preference
+  bool follow_consumer = false; ///< Whether to move preallocated storage to the NUMA node of the consumer
+  SlowConsumerPolicy slow_consumer_policy = SlowConsumerPolicy::kBlock; ///< What a BroadcastQueue does when a
+                                                                        ///< consumer falls a capacity behind
+  size_t priority_lanes = 2; ///< The number of priority lanes of a PriorityQueue
+  size_t max_bytes = 0;      ///< The storage an ElasticQueue may grow to, in bytes
+  size_t idle_ms = 1000;     ///< How long an ElasticQueue idles before it shrinks, in milliseconds
+  size_t capacity_bytes = 0; ///< The memory the elements may hold, in bytes, 0 for no limit (see
+                             ///< QueueBase::set_capacity_bytes())
+  size_t credits = 0;        ///< The credits producers start with, 0 not to use credits (see
+                             ///< QueueBase::enable_credits())
+};
+
+/**
+ * @brief The PoolConfig class encapsulates the configuration of an ObjectPool
+ */
+struct PoolConfig
+{
+  size_t count = 0;     ///< The number of objects in the pool
+  size_t slab_size = 0; ///< The bytes reserved for each object, 0 for the size of the pooled type
+  int numa_node = -1;   ///< The NUMA node to place the objects on, -1 for no preference
+  bool prefault = false; ///< Whether to touch the pool's memory at construction
+  PageAllocation::HugePages huge_pages = PageAllocation::HugePages::kNone; ///< Whether to back the pool with huge
+                                                                           ///< pages
+  bool lock_memory = false; ///< Whether to lock the pool's memory in RAM
+};
+
+/**
+ * @brief The memory held by the Queues of an application, see QueueRegistry::get_memory_usage()
+ */
+struct MemoryUsage
+{
+  size_t queue_bytes = 0;            ///< Bytes held by the elements in the Queues
+  size_t queue_bytes_high_water = 0; ///< Sum of the Queues' high-water marks since their last report
+  size_t queue_capacity_bytes = 0;   ///< Sum of the Queues' capacities in bytes, for those which have one
+  size_t unlimited_queues = 0;       ///< Number of Queues without a capacity in bytes
 };
 
 /**
  * @brief The QueueRegistry class manages all Queue instances and gives out
  * handles to the Queues upon request
+ *
+ * Queues and pools may be requested from several threads at once, e.g. by
+ * modules initialised in parallel: lookups share a reader lock, and the
+ * first request for a name creates its Queue under the writer lock.
  */
 class QueueRegistry
 {
@@ -73,42 +159,117 @@ public:
   /**
    * @brief Get a handle to a Queue
    * @tparam T Type of the data stored in the Queue
+   * @tparam QueueType Queue class to return the Queue as, e.g. SPSCRingQueue
    * @param name Name of the Queue
-   * @return std::shared_ptr to generic queue pointer
+   * @return std::shared_ptr to generic queue pointer, or to the given class
+   * @throws QueueKindMismatch if the Queue is configured as another kind than QueueType
+   */
+  template<typename T, template<typename> class QueueType = Queue>
+  std::shared_ptr<QueueType<T>> get_queue(const std::string& name);
+
+  /**
+   * @brief Return a Queue as an instance of QueueType
+   * @throws QueueKindMismatch if it isn't one
+   */
+  template<template<typename> class QueueType, typename T>
+  static std::shared_ptr<QueueType<T>> as_queue_type(const std::string& name, std::shared_ptr<Queue<T>> queue);
+
+  /**
+   * @brief Get a handle to an ObjectPool
+   * @tparam T Type of the objects in the pool
+   * @param name Name of the ObjectPool
+   * @return std::shared_ptr to the pool
+   *
+   * The pool is created on first request, and lives as long as the
+   * QueueRegistry, so objects acquired from it may be passed between modules.
    */
   template<typename T>
-  std::shared_ptr<Queue<T>> get_queue(const std::string& name);
+  std::shared_ptr<ObjectPool<T>> get_pool(const std::string& name);
 
   /**
    * @brief Configure the QueueRegistry
    * @param configmap Map relating Queue names to their configurations
+   * @param pool_config_map Map relating ObjectPool names to their configurations
    */
-  void configure(const std::map<std::string, QueueConfig>& config_map);
+  void configure(const std::map<std::string, QueueConfig>& config_map,
+                 const std::map<std::string, PoolConfig>& pool_config_map = {});
 
-  // Gather statistics from queues
+  /**
+   * @brief Close a Queue, so that nobody waits on it any longer (see QueueBase::close())
+   * @param name Name of the Queue
+   *
+   * Does nothing if the Queue hasn't been created yet, i.e. no DAQSink or
+   * DAQSource has asked for it.
+   */
+  void close_queue(const std::string& name);
+
+  /**
+   * @brief Change the capacity of a Queue, keeping its contents (see QueueBase::resize())
+   * @param name Name of the Queue
+   * @param capacity New capacity of the Queue
+   * @throws QueueResizeFailed if no such Queue is configured, or it can't be resized
+   *
+   * Handles to the Queue stay valid. A Queue which hasn't been created yet
+   * will be created with the new capacity.
+   */
+  void resize_queue(const std::string& name, size_t capacity);
+
+  /**
+   * @brief Let a Queue closed with close_queue() be used again
+   * @param name Name of the Queue
+   */
+  void reopen_queue(const std::string& name);
+
+  // Gather statistics from queues and pools
   void gather_stats(opmonlib::InfoCollector& ic, int level);
 
-  // ONLY TO BE USED FOR TESTING!
-  static void reset() { s_instance.reset(nullptr); }
+  /**
+   * @brief Add up the memory held by the Queues created so far
+   *
+   * The high-water marks are reset when the Queues report, so call this
+   * before gather_stats(). As each Queue peaks at its own time, their sum is
+   * an upper bound on the peak of the application.
+   */
+  MemoryUsage get_memory_usage() const;
+
+  // ONLY TO BE USED FOR TESTING! Not safe against concurrent calls to get()
+  static void reset() { instance().reset(new QueueRegistry()); }
 
 private:
   struct QueueEntry
   {
-    const std::type_info* m_type;
+    const std::type_info* m_type; ///< Element type the Queue was created with, compared on each lookup
     std::shared_ptr<QueueBase> m_instance;
   };
 
+  struct PoolEntry
+  {
+    const std::type_info* m_type; ///< Object type the pool was created with, compared on each lookup
+    std::shared_ptr<PoolBase> m_instance;
+  };
+
   QueueRegistry() = default;
 
   template<typename T>
   std::shared_ptr<QueueBase> create_queue(const std::string& name, const QueueConfig& config);
 
-  std::map<std::string, QueueEntry> m_queue_registry;
-  std::map<std::string, QueueConfig> m_queue_config_map;
+  template<typename T>
+  static std::shared_ptr<Queue<T>> queue_of_type(const std::string& name, const QueueEntry& entry);
+
+  template<typename T>
+  static std::shared_ptr<ObjectPool<T>> pool_of_type(const std::string& name, const PoolEntry& entry);
+
+  mutable std::shared_mutex m_mutex; ///< Guards all of the maps below
+
+  std::unordered_map<std::string, QueueEntry> m_queue_registry;
+  std::unordered_map<std::string, QueueConfig> m_queue_config_map;
+  std::unordered_map<std::string, PoolEntry> m_pool_registry;
+  std::unordered_map<std::string, PoolConfig> m_pool_config_map;
 
   bool m_configured{ false };
 
-  static std::unique_ptr<QueueRegistry> s_instance;
+  // The instance is made on first use, so it is never used before its own static initialisation
+  static std::unique_ptr<QueueRegistry>& instance();
 
   QueueRegistry(const QueueRegistry&) = delete;
   QueueRegistry& operator=(const QueueRegistry&) = delete;
@@ -128,6 +289,23 @@ ERS_DECLARE_ISSUE(appfwk,            // namespace
                                        << source_type << "'", // message
                   ((std::string)queue_name)((std::string)source_type)((std::string)target_type))
 
+/**
+ * @brief QueueKindMismatch ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,            // namespace
+                  QueueKindMismatch, // issue class name
+                  "Requested queue \"" << queue_name << "\" as class '" << target_class << "' but it is a '"
+                                       << source_class << "'", // message
+                  ((std::string)queue_name)((std::string)source_class)((std::string)target_class))
+
+/**
+ * @brief QueueResizeFailed ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,            // namespace
+                  QueueResizeFailed, // issue class name
+                  "Queue \"" << queue_name << "\" could not be resized to " << capacity << " elements: " << reason,
+                  ((std::string)queue_name)((size_t)capacity)((std::string)reason))
+
 /**
  * @brief QueueKindUnknown ERS Issue
  */
@@ -136,6 +314,39 @@ ERS_DECLARE_ISSUE(appfwk,           // namespace
                   "Queue kind \"" << queue_kind << "\" is unknown ",
                   ((std::string)queue_kind))
 
+/**
+ * @brief QueueTypeUnsupported ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,               // namespace
+                  QueueTypeUnsupported, // issue class name
+                  "Queue \"" << queue_name << "\" of kind " << queue_kind << " can't hold elements of type '"
+                             << target_type << "'",
+                  ((std::string)queue_name)((std::string)queue_kind)((std::string)target_type))
+
+/**
+ * @brief QueueCapacityBytesUnsupported ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,                        // namespace
+                  QueueCapacityBytesUnsupported, // issue class name
+                  "Queue \"" << queue_name << "\" of kind " << queue_kind << " can't limit its capacity in bytes",
+                  ((std::string)queue_name)((std::string)queue_kind))
+
+/**
+ * @brief QueueCreditsUnsupported ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,                  // namespace
+                  QueueCreditsUnsupported, // issue class name
+                  "Queue \"" << queue_name << "\" of kind " << queue_kind << " can't use credits",
+                  ((std::string)queue_name)((std::string)queue_kind))
+
+/**
+ * @brief WaitPolicyUnknown ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,            // namespace
+                  WaitPolicyUnknown, // issue class name
+                  "Wait policy \"" << wait_policy << "\" is unknown ",
+                  ((std::string)wait_policy))
+
 /**
  * @brief QueueNotFound ERS Issue
  */
@@ -145,6 +356,24 @@ ERS_DECLARE_ISSUE(appfwk,        // namespace
                                        << "' could not be found.", // message
                   ((std::string)queue_name)((std::string)target_type))
 
+/**
+ * @brief PoolTypeMismatch ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,           // namespace
+                  PoolTypeMismatch, // issue class name
+                  "Requested pool \"" << pool_name << "\" of type '" << target_type << "' already declared as type '"
+                                       << source_type << "'", // message
+                  ((std::string)pool_name)((std::string)source_type)((std::string)target_type))
+
+/**
+ * @brief PoolNotFound ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,       // namespace
+                  PoolNotFound, // issue class name
+                  "Requested pool \"" << pool_name << "\" of type '" << target_type
+                                       << "' could not be found.", // message
+                  ((std::string)pool_name)((std::string)target_type))
+
 /**
  * @brief QueueRegistryConfigured ERS Issue
  */
@@ -0,0 +1,218 @@
+/**
+ * @file ReadinessNotifier.hpp
+ *
+ * ReadinessNotifier tells the parties waiting on a Queue from outside of it
+ * (DAQSourceSets, epoll loops) that the Queue has data
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_READINESSNOTIFIER_HPP_
+#define APPFWK_INCLUDE_APPFWK_READINESSNOTIFIER_HPP_
+
+#include "appfwk/EventCount.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+namespace dunedaq {
+
+// Disable coverage collection LCOV_EXCL_START
+/**
+ * @brief QueueReadinessFDFailed ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,                 // namespace
+                  QueueReadinessFDFailed, // issue class name
+                  name << ": Unable to create the readiness file descriptor: " << reason,
+                  ((std::string)name)((std::string)reason))
+
+/**
+ * @brief QueueListenersExhausted ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,                  // namespace
+                  QueueListenersExhausted, // issue class name
+                  name << ": Unable to add a listener, all " << max_listeners << " are in use",
+                  ((std::string)name)((size_t)max_listeners))
+// Re-enable coverage collection LCOV_EXCL_STOP
+
+namespace appfwk {
+
+/**
+ * @brief Notifies EventCount listeners, and raises an eventfd, when a Queue
+ * (or one consumer's view of a Queue) gets data
+ *
+ * notify() costs a flag test until somebody registers a listener or asks for
+ * the file descriptor. Listeners are kept in a fixed array of slots, so that
+ * notify() doesn't take a lock: it announces itself on a slot before it uses
+ * the listener there, and remove_listener() empties the slot and waits for
+ * the notifiers which may have seen the listener to be done with it.
+ */
+class ReadinessNotifier
+{
+public:
+  static constexpr size_t s_max_listeners = 8; ///< Maximum number of listeners at any one time
+
+  ReadinessNotifier() = default;
+
+  ~ReadinessNotifier()
+  {
+    if (m_fd.load(std::memory_order_relaxed) >= 0) {
+      close(m_fd.load(std::memory_order_relaxed));
+    }
+  }
+
+  /**
+   * @brief Have listener notified whenever notify() is called
+   * @param name Name of the Queue, for error reporting
+   * @throws QueueListenersExhausted if s_max_listeners listeners are already registered
+   */
+  void add_listener(EventCount* listener, const std::string& name)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto slot = std::find_if(m_slots.begin(), m_slots.end(), [](const ListenerSlot& candidate) {
+      return candidate.listener.load(std::memory_order_relaxed) == nullptr;
+    });
+    if (slot == m_slots.end()) {
+      throw QueueListenersExhausted(ERS_HERE, name, s_max_listeners);
+    }
+    slot->listener.store(listener, std::memory_order_seq_cst);
+    const size_t num_slots = static_cast<size_t>(slot - m_slots.begin()) + 1;
+    if (num_slots > m_num_slots.load(std::memory_order_relaxed)) {
+      m_num_slots.store(num_slots, std::memory_order_release);
+    }
+    m_active.store(true, std::memory_order_seq_cst);
+  }
+
+  /**
+   * @brief Stop notifying listener. Once this returns, notify() no longer uses it
+   */
+  void remove_listener(EventCount* listener)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    bool any_left = false;
+    for (ListenerSlot& slot : m_slots) {
+      if (slot.listener.load(std::memory_order_relaxed) == listener) {
+        slot.listener.store(nullptr, std::memory_order_seq_cst);
+        while (slot.notifiers.load(std::memory_order_seq_cst) != 0) {
+          cpu_relax();
+        }
+      } else if (slot.listener.load(std::memory_order_relaxed) != nullptr) {
+        any_left = true;
+      }
+    }
+    m_active.store(any_left || m_fd.load(std::memory_order_relaxed) >= 0, std::memory_order_seq_cst);
+  }
+
+  /**
+   * @brief Get the eventfd, creating it on the first call
+   * @param name Name of the Queue, for error reporting
+   * @param has_data Whether the Queue already has data, in which case the eventfd starts out raised
+   * @throws QueueReadinessFDFailed if the eventfd can't be created
+   */
+  int get_fd(const std::string& name, bool has_data)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_fd.load(std::memory_order_relaxed) < 0) {
+      int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (fd < 0) {
+        throw QueueReadinessFDFailed(ERS_HERE, name, std::strerror(errno));
+      }
+      m_fd.store(fd, std::memory_order_relaxed);
+      m_active.store(true, std::memory_order_seq_cst);
+      if (has_data) {
+        raise_fd();
+      }
+    }
+    return m_fd.load(std::memory_order_relaxed);
+  }
+
+  void clear_fd() noexcept
+  {
+    const int fd = m_fd.load(std::memory_order_relaxed);
+    if (fd >= 0) {
+      // Rearm only after draining the eventfd, so that a push in between
+      // leaves it raised rather than unraised and disarmed
+      uint64_t value; // NOLINT(build/unsigned)
+      [[maybe_unused]] auto bytes = read(fd, &value, sizeof(value));
+      m_fd_raised.store(false, std::memory_order_seq_cst);
+    }
+  }
+
+  /**
+   * @brief Notify that data was published
+   *
+   * Must follow a sequentially consistent fence, or read-modify-write, after
+   * the publication, which pairs with the check of the Queue a listener makes
+   * after it registers. The sequentially consistent load of the flag is a
+   * plain load on x86 and an ldar on ARMv8.
+   */
+  void notify() noexcept
+  {
+    if (m_active.load(std::memory_order_seq_cst)) {
+      if (m_fd.load(std::memory_order_relaxed) >= 0) {
+        raise_fd();
+      }
+      const size_t num_slots = m_num_slots.load(std::memory_order_acquire);
+      for (size_t i = 0; i < num_slots; ++i) {
+        ListenerSlot& slot = m_slots[i];
+        if (slot.listener.load(std::memory_order_relaxed) == nullptr) {
+          continue;
+        }
+        // Announced before the listener is loaded again, so that remove_listener() either waits for us or
+        // has already emptied the slot
+        slot.notifiers.fetch_add(1, std::memory_order_seq_cst);
+        if (EventCount* listener = slot.listener.load(std::memory_order_seq_cst)) {
+          listener->notify_all();
+        }
+        slot.notifiers.fetch_sub(1, std::memory_order_release);
+      }
+    }
+  }
+
+  ReadinessNotifier(const ReadinessNotifier&) = delete;            ///< ReadinessNotifier is not copy-constructible
+  ReadinessNotifier& operator=(const ReadinessNotifier&) = delete; ///< ReadinessNotifier is not copy-assignable
+  ReadinessNotifier(ReadinessNotifier&&) = delete;                 ///< ReadinessNotifier is not move-constructible
+  ReadinessNotifier& operator=(ReadinessNotifier&&) = delete;      ///< ReadinessNotifier is not move-assignable
+
+private:
+  // Only the first notification after clear_fd() writes to the eventfd
+  void raise_fd() noexcept
+  {
+    if (!m_fd_raised.exchange(true, std::memory_order_seq_cst)) {
+      const uint64_t one = 1; // NOLINT(build/unsigned)
+      [[maybe_unused]] auto bytes = write(m_fd.load(std::memory_order_relaxed), &one, sizeof(one));
+    }
+  }
+
+  struct ListenerSlot
+  {
+    std::atomic<EventCount*> listener{ nullptr };
+    std::atomic<uint32_t> notifiers{ 0 }; // NOLINT(build/unsigned) notify() calls using the listener
+  };
+
+  std::atomic<bool> m_active{ false }; ///< Whether there are listeners or an eventfd
+  std::mutex m_mutex;                  ///< Serialises registration; notify() doesn't take it
+  std::array<ListenerSlot, s_max_listeners> m_slots;
+  std::atomic<size_t> m_num_slots{ 0 }; ///< One past the last slot ever used
+  std::atomic<int> m_fd{ -1 };
+  std::atomic<bool> m_fd_raised{ false };
+};
+
+} // namespace appfwk
+} // namespace dunedaq
+
+#endif // APPFWK_INCLUDE_APPFWK_READINESSNOTIFIER_HPP_
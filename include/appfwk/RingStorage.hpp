@@ -0,0 +1,92 @@
+/**
+ * @file RingStorage.hpp
+ *
+ * Fixed, preallocated storage for the Queue implementations which keep
+ * their elements in a ring of slots
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_RINGSTORAGE_HPP_
+#define APPFWK_INCLUDE_APPFWK_RINGSTORAGE_HPP_
+
+#include "appfwk/PageAllocation.hpp"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace dunedaq::appfwk {
+
+namespace detail {
+/**
+ * @brief Smallest power of two not less than n, for rings indexed with a mask
+ */
+inline size_t
+next_power_of_two(size_t n)
+{
+  size_t result = 1;
+  while (result < n) {
+    result <<= 1;
+  }
+  return result;
+}
+} // namespace detail
+
+/**
+ * @brief Uninitialized storage for a fixed number of T, allocated once
+ * @tparam T Type of the elements which will be constructed in the slots
+ *
+ * RingStorage does not track which slots hold a live element: the owning
+ * Queue constructs elements in the slots with placement new and destroys
+ * them explicitly. After construction no operation allocates. The slots are
+ * mapped directly from the kernel, so the Queue can choose how its storage
+ * is backed.
+ */
+template<class T>
+class RingStorage
+{
+public:
+  /**
+   * @brief RingStorage Constructor
+   * @param num_slots Number of slots to allocate
+   * @param options How to back the storage. Prefaulting, or locking, it
+   * means the first pass of the Queue through its storage doesn't take page
+   * faults
+   */
+  RingStorage(size_t num_slots, const PageAllocation::Options& options)
+    : m_num_slots(num_slots)
+    , m_memory(num_slots * sizeof(slot_t), options)
+    , m_slots(static_cast<slot_t*>(m_memory.data()))
+  {}
+
+  size_t size() const noexcept { return m_num_slots; }
+
+  size_t page_size() const noexcept { return m_memory.page_size(); }
+
+  int numa_node() const noexcept { return m_memory.numa_node(); }
+
+  void bind_to_numa_node(int numa_node) { m_memory.bind_to_numa_node(numa_node); }
+
+  void* raw_slot(size_t index) noexcept { return &m_slots[index]; }
+
+  T* slot(size_t index) noexcept { return std::launder(reinterpret_cast<T*>(&m_slots[index])); }
+
+  RingStorage(const RingStorage&) = delete;            ///< RingStorage is not copy-constructible
+  RingStorage& operator=(const RingStorage&) = delete; ///< RingStorage is not copy-assignable
+  RingStorage(RingStorage&&) = delete;                 ///< RingStorage is not move-constructible
+  RingStorage& operator=(RingStorage&&) = delete;      ///< RingStorage is not move-assignable
+
+private:
+  using slot_t = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+  size_t m_num_slots;
+  PageAllocation m_memory;
+  slot_t* m_slots;
+};
+
+} // namespace dunedaq::appfwk
+
+#endif // APPFWK_INCLUDE_APPFWK_RINGSTORAGE_HPP_
@@ -0,0 +1,209 @@
+#ifndef APPFWK_INCLUDE_APPFWK_SPSCRINGQUEUE_HPP_
+#define APPFWK_INCLUDE_APPFWK_SPSCRINGQUEUE_HPP_
+
+/**
+ *
+ * @file SPSCRingQueue.hpp
+ *
+ * A lock-free, fixed-capacity, single-producer single-consumer ring buffer
+ * implementation of Queue
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/EventCount.hpp"
+#include "appfwk/Queue.hpp"
+#include "appfwk/RingStorage.hpp"
+#include "appfwk/WaitPolicy.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace dunedaq::appfwk {
+
+/**
+ * @brief A Queue implementation for exactly one producer thread and one
+ * consumer thread
+ * @tparam T Data Type to be stored in the ring
+ *
+ * The ring storage is allocated once, at construction, with a power-of-two
+ * number of slots at least as large as the requested capacity, so that slot
+ * indices are computed with a mask. The write and read indices live on
+ * separate cache lines, and each side keeps a local copy of the other side's
+ * index which it only refreshes when the ring looks full (or empty), so in
+ * steady state neither side touches the other's cache line. A push or pop
+ * which has to wait does so according to the WaitPolicy; parking is done on
+ * an EventCount, so the other side only makes a system call when somebody is
+ * actually asleep.
+ *
+ * resize() changes the capacity while the queue is in use. Up to the number
+ * of slots in the ring it only changes a limit. Beyond, it allocates a
+ * larger ring and offers it to the producer, which moves to it the next time
+ * it finds the queue full, at a write index it publishes to the consumer;
+ * the consumer moves to the larger ring once it has popped everything before
+ * that index. Neither side allocates or frees memory, and neither looks for
+ * a larger ring outside its slow path. The smaller ring is freed by the next
+ * call to resize(), or by the destructor.
+ *
+ * The bytes each element is pushed with are kept beside it, and are the
+ * bytes it is popped with, so an element changed in place through peek()
+ * can't make the queue's byte count drift.
+ */
+template<class T>
+class SPSCRingQueue final : public Queue<T>
+{
+public:
+  using value_t = T;                                ///< Type of data stored in the SPSCRingQueue
+  using duration_t = typename Queue<T>::duration_t; ///< Type used for expressing timeouts
+
+  /**
+   * @brief SPSCRingQueue Constructor
+   * @param name Name of this SPSCRingQueue instance
+   * @param capacity Maximum number of elements in the ring
+   * @param wait_policy How to wait when the ring is full (push) or empty (pop)
+   * @param storage_options How to back the ring's storage: NUMA node, prefaulted, locked, huge pages
+   */
+  explicit SPSCRingQueue(const std::string& name,
+                         size_t capacity,
+                         WaitPolicy wait_policy = WaitPolicy::kSpinPark,
+                         const PageAllocation::Options& storage_options = {});
+
+  ~SPSCRingQueue();
+
+  bool can_pop() const noexcept override { return this->get_num_elements() > 0; }
+  bool try_pop(value_t& val, const duration_t&) override; // Returns false if a timeout occurs
+  size_t pop_n(value_t* vals, size_t max_count, const duration_t&) override;
+
+  bool can_push() const noexcept override
+  {
+    return this->get_num_elements() < this->get_capacity() && this->within_capacity_bytes();
+  }
+  bool try_push(value_t&&, const duration_t&) override; // Returns false if a timeout occurs
+  size_t push_n(value_t* vals, size_t count, const duration_t&) override;
+
+  // Elements live in fixed slots, so they can be constructed and consumed in place
+  bool supports_slots() const noexcept override { return true; }
+  void* try_reserve_slot(const duration_t&) override;
+  void commit_slot() override;
+  void cancel_slot() override {}
+  value_t* try_peek(const duration_t&) override;
+  void release_peeked() override;
+
+  size_t get_capacity() const noexcept override { return m_capacity.load(std::memory_order_relaxed); }
+
+  size_t get_num_elements() const noexcept override;
+
+  bool resize(size_t capacity) override;
+
+  size_t get_page_size() const override;
+  int get_numa_node() const override;
+  void move_storage_to_numa_node(int numa_node) override;
+
+  SPSCRingQueue(const SPSCRingQueue&) = delete;            ///< SPSCRingQueue is not copy-constructible
+  SPSCRingQueue& operator=(const SPSCRingQueue&) = delete; ///< SPSCRingQueue is not copy-assignable
+  SPSCRingQueue(SPSCRingQueue&&) = delete;                 ///< SPSCRingQueue is not move-constructible
+  SPSCRingQueue& operator=(SPSCRingQueue&&) = delete;      ///< SPSCRingQueue is not move-assignable
+
+protected:
+  void wake_waiters() override;
+
+private:
+  static constexpr size_t s_cache_line_size = 64;
+
+  struct Ring
+  {
+    Ring(size_t num_slots, const PageAllocation::Options& storage_options)
+      : slots(num_slots, storage_options)
+      , slot_bytes(num_slots, storage_options)
+      , mask(num_slots - 1)
+    {}
+
+    RingStorage<T> slots;
+    RingStorage<size_t> slot_bytes; ///< payload_bytes() of the element in each slot, when it was pushed
+    const size_t mask;
+  };
+
+  // The consumer reads from its ring, the producer writes to its own; they
+  // only differ while the producer has moved to a larger ring and the
+  // consumer hasn't followed yet
+  T* slot(size_t index) noexcept
+  {
+    Ring* ring = m_consumer_ring.load(std::memory_order_relaxed);
+    return ring->slots.slot(index & ring->mask);
+  }
+  void* raw_slot(size_t index) noexcept { return m_producer_ring->slots.raw_slot(index & m_producer_ring->mask); }
+
+  // The producer records the bytes an element is pushed with, and the consumer pops exactly those
+  size_t record_bytes(size_t index, const T& element) noexcept
+  {
+    const size_t bytes = payload_bytes(element);
+    new (m_producer_ring->slot_bytes.raw_slot(index & m_producer_ring->mask)) size_t(bytes);
+    return bytes;
+  }
+  size_t recorded_bytes(size_t index) noexcept
+  {
+    Ring* ring = m_consumer_ring.load(std::memory_order_relaxed);
+    return *ring->slot_bytes.slot(index & ring->mask);
+  }
+
+  // Number of slots the producer may fill beyond write_index, going by its cached read index, or none while the
+  // queue holds its capacity in bytes
+  size_t free_slots(size_t write_index) const noexcept
+  {
+    if (!this->within_capacity_bytes()) {
+      return 0;
+    }
+    const size_t limit = std::min(m_capacity.load(std::memory_order_relaxed), m_producer_ring->mask + 1);
+    const size_t occupancy = write_index - m_cached_read_index;
+    return occupancy < limit ? limit - occupancy : 0;
+  }
+
+  // Called by the producer and the consumer on their slow paths to move to a larger ring
+  void move_producer_to_offered_ring(size_t write_index) noexcept;
+  void follow_producer_to_ring(size_t read_index) noexcept;
+
+  // Wait until at least one slot is free (producer) / filled (consumer). Return the number available.
+  size_t wait_for_space(size_t write_index, const duration_t& timeout);
+  size_t wait_for_data(size_t read_index, const duration_t& timeout);
+
+  std::atomic<size_t> m_capacity;
+  const WaitPolicy m_wait_policy;
+
+  mutable std::mutex m_resize_mutex;         ///< Serialises resize(), and guards the members below
+  PageAllocation::Options m_storage_options; ///< How rings are allocated
+  std::unique_ptr<Ring> m_ring;              ///< The ring the consumer reads from, unless it has moved to m_next_ring
+  std::unique_ptr<Ring> m_next_ring;         ///< A larger ring allocated by resize()
+
+  std::atomic<Ring*> m_offered_ring{ nullptr }; ///< m_next_ring, until the producer takes it
+  std::atomic<Ring*> m_switch_ring;             ///< The ring the producer moved to most recently
+  std::atomic<size_t> m_switch_index{ 0 };      ///< The write index at which it moved
+
+  // Producer-side cache line
+  alignas(s_cache_line_size) std::atomic<size_t> m_write_index{ 0 };
+  size_t m_cached_read_index{ 0 };
+  Ring* m_producer_ring;
+
+  // Consumer-side cache line
+  alignas(s_cache_line_size) std::atomic<size_t> m_read_index{ 0 };
+  size_t m_cached_write_index{ 0 };
+  std::atomic<Ring*> m_consumer_ring; ///< Read by resize() to tell that the consumer has moved
+
+  alignas(s_cache_line_size) EventCount m_no_longer_empty;
+  alignas(s_cache_line_size) EventCount m_no_longer_full;
+};
+
+} // namespace dunedaq::appfwk
+
+#include "detail/SPSCRingQueue.hxx"
+
+#endif // APPFWK_INCLUDE_APPFWK_SPSCRINGQUEUE_HPP_
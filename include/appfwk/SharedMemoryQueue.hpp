@@ -0,0 +1,238 @@
+#ifndef APPFWK_INCLUDE_APPFWK_SHAREDMEMORYQUEUE_HPP_
+#define APPFWK_INCLUDE_APPFWK_SHAREDMEMORYQUEUE_HPP_
+
+/**
+ *
+ * @file SharedMemoryQueue.hpp
+ *
+ * A lock-free, fixed-capacity, single-producer single-consumer ring buffer
+ * implementation of Queue, kept in a named shared memory segment so that the
+ * producer and the consumer may run in different processes on the same host
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/EventCount.hpp"
+#include "appfwk/Queue.hpp"
+#include "appfwk/SharedMemorySegment.hpp"
+#include "appfwk/WaitPolicy.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+namespace dunedaq {
+
+// Disable coverage collection LCOV_EXCL_START
+/**
+ * @brief SharedMemoryQueueMismatch ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,                    // namespace
+                  SharedMemoryQueueMismatch, // issue class name
+                  "Queue \"" << name << "\" can't use shared memory segment \"" << segment_name << "\": " << reason,
+                  ((std::string)name)((std::string)segment_name)((std::string)reason))
+// Re-enable coverage collection LCOV_EXCL_STOP
+
+namespace appfwk {
+
+/**
+ * @brief Whether values of T may be pushed by one process and popped by another
+ *
+ * Trivially copyable types qualify. Specialise this to std::true_type for
+ * other types which hold no pointers or handles into the memory of the
+ * process which created them (std::string and std::vector, for instance,
+ * don't qualify), and which both processes build with the same layout.
+ */
+template<typename T>
+struct is_shared_memory_payload : std::is_trivially_copyable<T>
+{};
+
+template<typename T>
+inline constexpr bool is_shared_memory_payload_v = is_shared_memory_payload<T>::value;
+
+/**
+ * @brief A Queue implementation for exactly one producer thread and one
+ * consumer thread, which may be in different processes
+ * @tparam T Data Type to be stored in the ring, see is_shared_memory_payload
+ *
+ * The ring, its indices and the EventCounts threads park on live in the
+ * POSIX shared memory segment "/dunedaq_appfwk_<name>". The first
+ * SharedMemoryQueue constructed with a name, in any process, creates and
+ * initialises the segment; the others map it, after checking that it holds
+ * a ring of the same element type and capacity. Elements are constructed in
+ * the ring by the producer and moved out of it by the consumer, without a
+ * system call unless one side is parked, and without serialisation. The
+ * data path otherwise works as in SPSCRingQueue.
+ *
+ * The last SharedMemoryQueue to be destroyed, in whichever process, removes
+ * the segment. A process which dies without destroying its queues leaves
+ * the segment behind, and with it any elements not yet popped; remove it
+ * from /dev/shm before restarting both sides to start from an empty queue.
+ *
+ * What isn't in the segment only applies within a process: close() only
+ * wakes the threads of the process which calls it, and readiness listeners
+ * and file descriptors are only raised by pushes made in that process. The
+ * queue can't be resized.
+ */
+template<class T>
+class SharedMemoryQueue final : public Queue<T>
+{
+  static_assert(is_shared_memory_payload_v<T>,
+                "SharedMemoryQueue needs a trivially copyable element type, or one declared safe to share between "
+                "processes by specialising is_shared_memory_payload");
+
+public:
+  using value_t = T;                                ///< Type of data stored in the SharedMemoryQueue
+  using duration_t = typename Queue<T>::duration_t; ///< Type used for expressing timeouts
+
+  /**
+   * @brief SharedMemoryQueue Constructor
+   * @param name Name of this SharedMemoryQueue instance, which also names its shared memory segment
+   * @param capacity Maximum number of elements in the ring
+   * @param wait_policy How to wait when the ring is full (push) or empty (pop)
+   * @param storage_options How to back the segment in this process: NUMA node, prefaulted, locked
+   * @throws SharedMemoryFailed if the segment can't be mapped
+   * @throws SharedMemoryQueueMismatch if the segment holds a ring of another element type or capacity
+   */
+  explicit SharedMemoryQueue(const std::string& name,
+                             size_t capacity,
+                             WaitPolicy wait_policy = WaitPolicy::kSpinPark,
+                             const PageAllocation::Options& storage_options = {});
+
+  ~SharedMemoryQueue();
+
+  bool can_pop() const noexcept override { return this->get_num_elements() > 0; }
+  bool try_pop(value_t& val, const duration_t&) override; // Returns false if a timeout occurs
+  size_t pop_n(value_t* vals, size_t max_count, const duration_t&) override;
+
+  bool can_push() const noexcept override { return this->get_num_elements() < this->get_capacity(); }
+  bool try_push(value_t&&, const duration_t&) override; // Returns false if a timeout occurs
+  size_t push_n(value_t* vals, size_t count, const duration_t&) override;
+
+  // Elements live in fixed slots of the segment, so they can be constructed and consumed in place
+  bool supports_slots() const noexcept override { return true; }
+  void* try_reserve_slot(const duration_t&) override;
+  void commit_slot() override;
+  void cancel_slot() override {}
+  value_t* try_peek(const duration_t&) override;
+  void release_peeked() override;
+
+  size_t get_capacity() const noexcept override { return m_capacity; }
+
+  size_t get_num_elements() const noexcept override;
+
+  // The byte counters of a queue only see what happens in their own process, so pushes and pops count no bytes,
+  // which are worked out from the shared indices instead. The elements hold nothing outside of the ring.
+  size_t get_bytes() const noexcept override { return this->get_num_elements() * sizeof(T); }
+
+  size_t get_page_size() const override;
+  int get_numa_node() const override { return m_segment->numa_node(); }
+  void move_storage_to_numa_node(int numa_node) override { m_segment->bind_to_numa_node(numa_node); }
+
+  /**
+   * @brief Name of the shared memory segment a queue with this name lives in
+   */
+  static std::string segment_name(const std::string& name) { return "/dunedaq_appfwk_" + name; }
+
+  SharedMemoryQueue(const SharedMemoryQueue&) = delete;            ///< SharedMemoryQueue is not copy-constructible
+  SharedMemoryQueue& operator=(const SharedMemoryQueue&) = delete; ///< SharedMemoryQueue is not copy-assignable
+  SharedMemoryQueue(SharedMemoryQueue&&) = delete;                 ///< SharedMemoryQueue is not move-constructible
+  SharedMemoryQueue& operator=(SharedMemoryQueue&&) = delete;      ///< SharedMemoryQueue is not move-assignable
+
+protected:
+  void wake_waiters() override;
+
+private:
+  static constexpr size_t s_cache_line_size = 64;
+
+  using index_t = uint64_t; // NOLINT(build/unsigned)
+
+  // Indices are the same width in every process, and used without locks
+  static_assert(std::atomic<index_t>::is_always_lock_free, "shared ring indices must be lock-free");
+  static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared ring state must be lock-free"); // NOLINT
+
+  // Values of Header::attached
+  static constexpr uint32_t s_retired = UINT32_MAX; ///< The segment is being removed; map a new one // NOLINT
+
+  // Values of Header::state. A new segment is zero-filled, i.e. uninitialised.
+  static constexpr uint32_t s_uninitialised = 0; // NOLINT(build/unsigned)
+  static constexpr uint32_t s_initialising = 1;  // NOLINT(build/unsigned)
+  static constexpr uint32_t s_ready = 2;         // NOLINT(build/unsigned)
+
+  static constexpr uint32_t s_layout_version = 1; // NOLINT(build/unsigned)
+
+  /**
+   * @brief The start of the segment, followed by the slots. Only fixed-width members, so that processes built
+   * separately agree on its layout.
+   */
+  struct Header
+  {
+    std::atomic<uint32_t> state;    ///< s_uninitialised, s_initialising or s_ready // NOLINT(build/unsigned)
+    std::atomic<uint32_t> attached; ///< Number of SharedMemoryQueues mapping the segment, or s_retired // NOLINT
+    uint32_t layout_version;        // NOLINT(build/unsigned)
+    uint32_t element_size;          // NOLINT(build/unsigned)
+    uint64_t element_type;          ///< Hash of the element type's name // NOLINT(build/unsigned)
+    uint64_t num_slots;             // NOLINT(build/unsigned)
+    uint64_t capacity;              // NOLINT(build/unsigned)
+
+    alignas(s_cache_line_size) std::atomic<index_t> write_index;
+    alignas(s_cache_line_size) std::atomic<index_t> read_index;
+
+    alignas(s_cache_line_size) EventCount no_longer_empty;
+    alignas(s_cache_line_size) EventCount no_longer_full;
+  };
+
+  static constexpr size_t slots_offset()
+  {
+    const size_t alignment = alignof(T) > s_cache_line_size ? alignof(T) : s_cache_line_size;
+    return (sizeof(Header) + alignment - 1) / alignment * alignment;
+  }
+
+  // Map the segment and attach to it, initialising it if it is new. Returns false if it is being removed.
+  bool attach(const PageAllocation::Options& storage_options);
+  void initialise_header();
+  void check_header() const;
+  // Map the whole segment once its header is checked, in place of the header alone. Detaches on failure.
+  void map_slots(size_t bytes, const PageAllocation::Options& storage_options);
+
+  // Detach from the segment, removing it if this was the last queue attached
+  void detach() noexcept;
+
+  T* slot(index_t index) noexcept { return std::launder(reinterpret_cast<T*>(raw_slot(index))); }
+  void* raw_slot(index_t index) noexcept { return m_slots + (index & m_mask) * sizeof(T); }
+
+  // Number of slots the producer may fill beyond write_index, going by its cached read index
+  size_t free_slots(index_t write_index) const noexcept;
+
+  // Wait until at least one slot is free (producer) / filled (consumer). Return the number available.
+  size_t wait_for_space(index_t write_index, const duration_t& timeout);
+  size_t wait_for_data(index_t read_index, const duration_t& timeout);
+
+  const size_t m_capacity;
+  const size_t m_num_slots;
+  const size_t m_mask;
+  const WaitPolicy m_wait_policy;
+
+  std::unique_ptr<SharedMemorySegment> m_segment;
+  Header* m_header{ nullptr };
+  char* m_slots{ nullptr };
+
+  // Each side's copy of the other side's index, refreshed when the ring looks full (or empty)
+  alignas(s_cache_line_size) index_t m_cached_read_index{ 0 };
+  alignas(s_cache_line_size) index_t m_cached_write_index{ 0 };
+};
+
+} // namespace appfwk
+} // namespace dunedaq
+
+#include "detail/SharedMemoryQueue.hxx"
+
+#endif // APPFWK_INCLUDE_APPFWK_SHAREDMEMORYQUEUE_HPP_
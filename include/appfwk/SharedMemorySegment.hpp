@@ -0,0 +1,110 @@
+/**
+ * @file SharedMemorySegment.hpp
+ *
+ * SharedMemorySegment maps a named POSIX shared memory segment, so that
+ * processes on the same host can share framework data structures (see
+ * SharedMemoryQueue)
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_SHAREDMEMORYSEGMENT_HPP_
+#define APPFWK_INCLUDE_APPFWK_SHAREDMEMORYSEGMENT_HPP_
+
+#include "appfwk/PageAllocation.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace dunedaq {
+
+// Disable coverage collection LCOV_EXCL_START
+/**
+ * @brief SharedMemoryFailed ERS Issue
+ */
+ERS_DECLARE_ISSUE(appfwk,             // namespace
+                  SharedMemoryFailed, // issue class name
+                  "Unable to map " << bytes << " bytes of shared memory segment \"" << segment_name
+                                   << "\": " << reason,
+                  ((std::string)segment_name)((size_t)bytes)((std::string)reason))
+// Re-enable coverage collection LCOV_EXCL_STOP
+
+namespace appfwk {
+
+/**
+ * @brief A named POSIX shared memory segment, mapped into this process
+ *
+ * The segment is created, zero-filled, by whichever process maps it first,
+ * and mapped as it is by the others. Destroying a SharedMemorySegment only
+ * unmaps it; the segment itself lives until unlink() is called and every
+ * process has unmapped it.
+ */
+class SharedMemorySegment
+{
+public:
+  /**
+   * @brief Map the segment, creating it if it doesn't exist
+   * @param name Name of the segment, starting with a '/', e.g. "/dunedaq_appfwk_my_queue"
+   * @param bytes Size of the segment
+   * @param options How to back the memory. The segment is bound to the NUMA
+   * node, prefaulted and locked as requested; it can't be backed by huge pages
+   * @throws SharedMemoryFailed if the segment can't be opened or mapped, or
+   * it already exists with another size
+   */
+  SharedMemorySegment(const std::string& name, size_t bytes, const PageAllocation::Options& options);
+
+  /**
+   * @brief Map the start of the segment, creating it if it doesn't exist,
+   * e.g. to check a header before mapping the whole of it
+   * @param name Name of the segment
+   * @param bytes Size of the segment, if it is created
+   * @param mapped_bytes How much of the segment to map
+   * @throws SharedMemoryFailed if the segment can't be opened or mapped, or
+   * it already exists with fewer than mapped_bytes
+   */
+  SharedMemorySegment(const std::string& name, size_t bytes, size_t mapped_bytes);
+  ~SharedMemorySegment();
+
+  void* data() const noexcept { return m_data; }
+  size_t size() const noexcept { return m_size; }                 ///< Bytes mapped
+  size_t segment_size() const noexcept { return m_segment_size; } ///< Bytes in the segment, of which size() are mapped
+  const std::string& name() const noexcept { return m_name; }
+
+  /**
+   * @brief NUMA node this process bound the segment to, or -1 if it is left to the kernel
+   */
+  int numa_node() const noexcept { return m_numa_node; }
+
+  /**
+   * @brief Bind the segment to a NUMA node, migrating any pages already touched
+   *
+   * Failure is reported as a warning, and leaves the memory where it is.
+   */
+  void bind_to_numa_node(int numa_node);
+
+  /**
+   * @brief Remove the segment's name, so that the next process to map it creates a new one
+   */
+  void unlink() noexcept;
+
+  SharedMemorySegment(const SharedMemorySegment&) = delete;            ///< SharedMemorySegment is not copy-constructible
+  SharedMemorySegment& operator=(const SharedMemorySegment&) = delete; ///< SharedMemorySegment is not copy-assignable
+  SharedMemorySegment(SharedMemorySegment&&) = delete;                 ///< SharedMemorySegment is not move-constructible
+  SharedMemorySegment& operator=(SharedMemorySegment&&) = delete;      ///< SharedMemorySegment is not move-assignable
+
+private:
+  std::string m_name;
+  size_t m_size;
+  size_t m_segment_size{ 0 };
+  void* m_data{ nullptr };
+  int m_numa_node{ -1 };
+};
+
+} // namespace appfwk
+} // namespace dunedaq
+
+#endif // APPFWK_INCLUDE_APPFWK_SHAREDMEMORYSEGMENT_HPP_
@@ -5,7 +5,9 @@
  *
  * @file StdDeQueue.hpp
  *
- * A std::deque-based implementation of Queue
+ * A mutex-based implementation of Queue. It was originally backed by a
+ * std::deque, hence its name, and now keeps its elements in a preallocated
+ * ring
  *
  * This is part of the DUNE DAQ Application Framework, copyright 2020.
  * Licensing/copyright details are in the COPYING file that you should have
@@ -13,14 +15,16 @@
  */
 
 #include "appfwk/Queue.hpp"
+#include "appfwk/RingStorage.hpp"
+#include "appfwk/TimedMutexCondition.hpp"
+#include "appfwk/WaitPolicy.hpp"
 
 #include <atomic>
 #include <cassert>
 #include <chrono>
-#include <condition_variable>
-#include <deque>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
@@ -31,11 +35,17 @@
 namespace dunedaq {
 namespace appfwk {
 /**
- * @brief A Queue Implementation that uses a std::deque as its backend
- * @tparam T Data Type to be stored in the std::deque
+ * @brief A Queue Implementation protected by a mutex, with condition
+ * variables to wait on
+ * @tparam T Data Type to be stored in the StdDeQueue
+ *
+ * The elements live in a ring of exactly capacity slots which is allocated
+ * at construction, so pushing and popping never allocate. resize() allocates
+ * a new ring before it takes the mutex, and holds the mutex only while it
+ * moves the elements across.
  */
 template<class T>
-class StdDeQueue : public Queue<T>
+class StdDeQueue final : public Queue<T>
 {
 public:
   using value_t = T;                                ///< Type of data stored in the StdDeQueue
@@ -44,19 +54,40 @@ public:
   /**
    * @brief StdDeQueue Constructor
    * @param name Name of this StdDeQueue instance
+   * @param capacity Maximum number of elements in the StdDeQueue
+   * @param wait_policy How to wait for the mutex, and for space (push) or data (pop); blocking by default
+   * @param storage_options How to back the storage: NUMA node, prefaulted, locked, huge pages
    */
-  explicit StdDeQueue(const std::string& name, size_t capacity);
+  explicit StdDeQueue(const std::string& name,
+                      size_t capacity,
+                      WaitPolicy wait_policy = WaitPolicy::kBlock,
+                      const PageAllocation::Options& storage_options = {});
+
+  ~StdDeQueue();
 
   bool can_pop() const noexcept override { return this->get_num_elements() > 0; }
-  void pop(value_t& val, const duration_t&) override; // Throws QueueTimeoutExpired if a timeout occurs
+  bool try_pop(value_t& val, const duration_t&) override; // Returns false if a timeout occurs
 
-  bool can_push() const noexcept override { return this->get_num_elements() < this->get_capacity(); }
-  void push(value_t&&, const duration_t&) override; // Throws QueueTimeoutExpired if a timeout occurs
+  bool can_push() const noexcept override
+  {
+    return this->get_num_elements() < this->get_capacity() && this->within_capacity_bytes();
+  }
+  bool try_push(value_t&&, const duration_t&) override; // Returns false if a timeout occurs
 
-  size_t get_capacity() const override { return m_capacity; }
+  // Batch operations take the mutex and signal the condition variables once per batch
+  size_t push_n(value_t* vals, size_t count, const duration_t&) override;
+  size_t pop_n(value_t* vals, size_t max_count, const duration_t&) override;
+
+  size_t get_capacity() const override { return m_capacity.load(std::memory_order_relaxed); }
 
   size_t get_num_elements() const override { return m_size.load(std::memory_order_acquire); }
 
+  bool resize(size_t capacity) override;
+
+  size_t get_page_size() const override;
+  int get_numa_node() const override;
+  void move_storage_to_numa_node(int numa_node) override;
+
   // Delete the copy and move operations since various member data instances
   // (e.g., of std::mutex or of std::atomic) aren't copyable or movable
 
@@ -65,16 +96,36 @@ public:
   StdDeQueue(StdDeQueue&&) = delete;                 ///< StdDeQueue is not move-constructible
   StdDeQueue& operator=(StdDeQueue&&) = delete;      ///< StdDeQueue is not move-assignable
 
-private:
-  void try_lock_for(std::unique_lock<std::mutex>&, const duration_t&);
+protected:
+  void wake_waiters() override;
 
-  std::deque<value_t> m_deque;
-  size_t m_capacity;
+private:
+  bool lock_until(std::unique_lock<std::timed_mutex>&, std::chrono::steady_clock::time_point);
+  template<typename Condition>
+  bool wait_until(std::unique_lock<std::timed_mutex>&,
+                  TimedMutexCondition&,
+                  Condition,
+                  std::chrono::steady_clock::time_point);
+
+  // Index of the slot holding the element count places after the first one. Called with the mutex held.
+  size_t slot_index(size_t count) const noexcept
+  {
+    size_t index = m_head + count;
+    const size_t num_slots = m_storage->size();
+    return index >= num_slots ? index - num_slots : index;
+  }
+
+  std::atomic<size_t> m_capacity; ///< Read without the mutex by the spinning wait conditions
+  PageAllocation::Options m_storage_options;
+  std::unique_ptr<RingStorage<value_t>> m_storage; ///< Replaced by resize(), with the mutex held
+  size_t m_head{ 0 }; ///< Index of the slot holding the first element
   std::atomic<size_t> m_size = 0;
+  WaitPolicy m_wait_policy;
 
-  std::mutex m_mutex;
-  std::condition_variable m_no_longer_full;
-  std::condition_variable m_no_longer_empty;
+  mutable std::timed_mutex m_mutex; ///< Timed, so that waiting for it gives up at the deadline
+  std::mutex m_resize_mutex;         ///< Serialises calls to resize()
+  TimedMutexCondition m_no_longer_full;
+  TimedMutexCondition m_no_longer_empty;
 };
 
 } // namespace appfwk
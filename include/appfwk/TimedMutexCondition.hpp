@@ -0,0 +1,78 @@
+/**
+ * @file TimedMutexCondition.hpp
+ *
+ * A condition variable for the Queue implementations guarded by a
+ * std::timed_mutex, which only pays for notifications when somebody waits
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_TIMEDMUTEXCONDITION_HPP_
+#define APPFWK_INCLUDE_APPFWK_TIMEDMUTEXCONDITION_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace dunedaq::appfwk {
+
+/**
+ * @brief Lets threads holding a std::timed_mutex sleep until a condition holds
+ *
+ * std::condition_variable only works with std::mutex, which can't be locked
+ * with a deadline, so the Queues which wait for their mutex until a deadline
+ * use std::condition_variable_any. That takes a mutex of its own on every
+ * notification; counting the sleepers under the Queue's mutex lets pushes and
+ * pops which nobody waits for skip it. All calls are made with the Queue's
+ * mutex held.
+ */
+class TimedMutexCondition
+{
+public:
+  TimedMutexCondition() = default;
+
+  /**
+   * @brief Sleep, releasing the mutex, until condition() holds or the deadline passes
+   * @return The last result of condition(), with the mutex held
+   */
+  template<typename Condition>
+  bool wait_until(std::unique_lock<std::timed_mutex>& lk,
+                  std::chrono::steady_clock::time_point deadline,
+                  Condition condition)
+  {
+    ++m_sleepers;
+    const bool result = m_cv.wait_until(lk, deadline, condition);
+    --m_sleepers;
+    return result;
+  }
+
+  void notify_one()
+  {
+    if (m_sleepers > 0) {
+      m_cv.notify_one();
+    }
+  }
+
+  void notify_all()
+  {
+    if (m_sleepers > 0) {
+      m_cv.notify_all();
+    }
+  }
+
+  TimedMutexCondition(const TimedMutexCondition&) = delete;            ///< Not copy-constructible
+  TimedMutexCondition& operator=(const TimedMutexCondition&) = delete; ///< Not copy-assignable
+  TimedMutexCondition(TimedMutexCondition&&) = delete;                 ///< Not move-constructible
+  TimedMutexCondition& operator=(TimedMutexCondition&&) = delete;      ///< Not move-assignable
+
+private:
+  std::condition_variable_any m_cv;
+  size_t m_sleepers{ 0 }; ///< Threads sleeping in wait_until(), guarded by the Queue's mutex
+};
+
+} // namespace dunedaq::appfwk
+
+#endif // APPFWK_INCLUDE_APPFWK_TIMEDMUTEXCONDITION_HPP_
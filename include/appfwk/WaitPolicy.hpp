@@ -0,0 +1,131 @@
+/**
+ * @file WaitPolicy.hpp
+ *
+ * The ways a Queue can wait for space (on push) or data (on pop), and the
+ * waiting helpers shared by the Queue implementations
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_INCLUDE_APPFWK_WAITPOLICY_HPP_
+#define APPFWK_INCLUDE_APPFWK_WAITPOLICY_HPP_
+
+#include "appfwk/EventCount.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace dunedaq::appfwk {
+
+/**
+ * @brief How a thread waits on a Queue which is full (push) or empty (pop)
+ *
+ * The spinning policies trade a CPU core for wakeups in well under a
+ * microsecond, and suit latency-critical links; kBlock costs nothing while
+ * waiting and suits low-rate links.
+ */
+enum class WaitPolicy
+{
+  kBlock,     ///< Sleep in the kernel straight away
+  kSpin,      ///< Busy-wait with a CPU pause hint until the timeout expires
+  kSpinYield, ///< Busy-wait briefly, then yield the CPU between checks until the timeout expires
+  kSpinPark,  ///< Busy-wait briefly, then sleep in the kernel
+};
+
+/**
+ * @brief Whether a thread waiting with this policy ends up sleeping in the kernel
+ */
+constexpr bool
+parks(WaitPolicy policy) noexcept
+{
+  return policy == WaitPolicy::kBlock || policy == WaitPolicy::kSpinPark;
+}
+
+/**
+ * @brief Busy-wait, as the policy allows, until condition() returns true
+ * @return The last result of condition()
+ *
+ * With kBlock this only checks the condition once. With kSpinPark it spins
+ * for a bounded number of iterations, after which the caller should park.
+ * With kSpin and kSpinYield it keeps going until the deadline. The clock is
+ * only read every few iterations.
+ */
+template<typename Condition>
+bool
+spin_until(WaitPolicy policy, Condition&& condition, std::chrono::steady_clock::time_point deadline)
+{
+  constexpr int spin_iterations = 256;
+  constexpr int iterations_per_clock_read = 64;
+
+  if (condition()) {
+    return true;
+  }
+  if (policy == WaitPolicy::kBlock) {
+    return false;
+  }
+
+  for (int i = 0; i < spin_iterations; ++i) {
+    cpu_relax();
+    if (condition()) {
+      return true;
+    }
+  }
+  if (policy == WaitPolicy::kSpinPark) {
+    return false;
+  }
+
+  while (std::chrono::steady_clock::now() < deadline) {
+    for (int i = 0; i < iterations_per_clock_read; ++i) {
+      if (policy == WaitPolicy::kSpinYield) {
+        std::this_thread::yield();
+      } else {
+        cpu_relax();
+      }
+      if (condition()) {
+        return true;
+      }
+    }
+  }
+  return condition();
+}
+
+/**
+ * @brief Wait, as the policy allows, until condition() returns true or the deadline passes
+ * @param event_count Notified whenever condition() may have become true
+ * @return The last result of condition()
+ *
+ * The thread busy-waits with spin_until() first, and the parking policies
+ * then sleep on the EventCount. condition() is checked once more after the
+ * deadline passes while sleeping.
+ */
+template<typename Condition>
+bool
+wait_until(WaitPolicy policy,
+           EventCount& event_count,
+           Condition&& condition,
+           std::chrono::steady_clock::time_point deadline)
+{
+  if (spin_until(policy, condition, deadline)) {
+    return true;
+  }
+  if (!parks(policy)) {
+    return false;
+  }
+
+  while (true) {
+    auto key = event_count.prepare_wait();
+    if (condition()) {
+      event_count.cancel_wait();
+      return true;
+    }
+    if (!event_count.wait_until(key, deadline)) {
+      return condition();
+    }
+  }
+}
+
+} // namespace dunedaq::appfwk
+
+#endif // APPFWK_INCLUDE_APPFWK_WAITPOLICY_HPP_
@@ -0,0 +1,340 @@
+
+#include <algorithm>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace dunedaq::appfwk {
+
+/**
+ * @brief One consumer's view of a BroadcastQueue: pops from the consumer's
+ * own read position, and signals readiness for that position only
+ */
+template<class T>
+class BroadcastQueue<T>::Consumer final : public Queue<T>
+{
+public:
+  Consumer(std::shared_ptr<BroadcastQueue> queue, Cursor& cursor)
+    : Queue<T>(queue->get_name())
+    , m_queue(std::move(queue))
+    , m_cursor(cursor)
+  {}
+
+  ~Consumer()
+  {
+    // Stop holding back the producer
+    m_cursor.active.store(false, std::memory_order_release);
+    m_queue->m_no_longer_full.notify_all();
+  }
+
+  bool try_push(value_t&&, const duration_t&) override
+  {
+    throw QueueOperationUnsupported(ERS_HERE, this->get_name(), "push from a consumer");
+  }
+
+  bool try_pop(value_t& val, const duration_t& timeout) override
+  {
+    if constexpr (std::is_copy_assignable_v<T>) {
+      const T* element = m_queue->acquire_element(m_cursor, timeout);
+      if (element == nullptr) {
+        return false;
+      }
+      try {
+        val = *element;
+      } catch (...) {
+        m_queue->release_element(m_cursor, false);
+        throw;
+      }
+      m_queue->release_element(m_cursor, true);
+      return true;
+    } else {
+      throw QueueOperationUnsupported(ERS_HERE, this->get_name(), "pop of a type which can't be copied; use view");
+    }
+  }
+
+  // The elements are shared with the other consumers, so they can only be read in place, never modified
+  bool supports_read_only_slots() const noexcept override { return true; }
+  const value_t* try_view(const duration_t& timeout) override { return m_queue->acquire_element(m_cursor, timeout); }
+  void release_peeked() override { m_queue->release_element(m_cursor, true); }
+
+  size_t get_capacity() const noexcept override { return m_queue->get_capacity(); }
+
+  size_t get_num_elements() const noexcept override
+  {
+    const size_t read_index = m_cursor.read_index.load(std::memory_order_acquire) & ~s_busy;
+    return std::min(m_queue->m_write_index.load(std::memory_order_acquire) - read_index, m_queue->get_capacity());
+  }
+
+  size_t get_page_size() const noexcept override { return m_queue->get_page_size(); }
+  int get_numa_node() const noexcept override { return m_queue->get_numa_node(); }
+
+  // Closing the queue closes every consumer's view of it
+  bool is_closed() const noexcept override { return m_queue->is_closed(); }
+
+  // Readiness is per consumer, since each one is at its own position
+  void add_listener(EventCount* listener) override { m_cursor.readiness.add_listener(listener, this->get_name()); }
+  void remove_listener(EventCount* listener) override { m_cursor.readiness.remove_listener(listener); }
+  int get_readiness_fd() override { return m_cursor.readiness.get_fd(this->get_name(), get_num_elements() > 0); }
+  void clear_readiness() noexcept override { m_cursor.readiness.clear_fd(); }
+
+private:
+  std::shared_ptr<BroadcastQueue> m_queue;
+  Cursor& m_cursor;
+};
+
+template<class T>
+BroadcastQueue<T>::BroadcastQueue(const std::string& name,
+                                  size_t capacity,
+                                  SlowConsumerPolicy slow_consumer_policy,
+                                  WaitPolicy wait_policy,
+                                  const PageAllocation::Options& storage_options)
+  : Queue<T>(name)
+  , m_capacity(capacity)
+  , m_mask(detail::next_power_of_two(std::max(capacity, size_t(1))) - 1)
+  , m_slow_consumer_policy(slow_consumer_policy)
+  , m_wait_policy(wait_policy)
+  , m_slots(m_mask + 1, storage_options)
+  , m_slot_bytes(m_mask + 1, storage_options)
+{
+  // Not use_single_writer_counters(): every consumer counts its pops here, and the producer releases the bytes
+}
+
+template<class T>
+BroadcastQueue<T>::~BroadcastQueue()
+{
+  // The consumer views hold the queue, so none is left by now
+  const size_t write_index = m_write_index.load(std::memory_order_acquire);
+  for (size_t i = m_reclaimed_index; i != write_index; ++i) {
+    slot(i)->~T();
+  }
+}
+
+template<class T>
+std::shared_ptr<Queue<T>>
+BroadcastQueue<T>::add_consumer()
+{
+  std::lock_guard<std::mutex> lk(m_add_consumer_mutex);
+  const size_t index = m_num_consumers.load(std::memory_order_relaxed);
+  if (index == s_max_consumers) {
+    throw BroadcastQueueConsumersExhausted(ERS_HERE, this->get_name(), s_max_consumers);
+  }
+
+  Cursor& cursor = m_cursors[index];
+  const size_t write_index = m_write_index.load(std::memory_order_acquire);
+  cursor.read_index.store(write_index, std::memory_order_relaxed);
+  cursor.cached_write_index = write_index;
+  cursor.active.store(true, std::memory_order_release);
+  m_num_consumers.store(index + 1, std::memory_order_release);
+
+  return std::make_shared<Consumer>(this->shared_from_this(), cursor);
+}
+
+template<class T>
+bool
+BroadcastQueue<T>::try_pop(value_t&, const duration_t&)
+{
+  throw QueueOperationUnsupported(ERS_HERE, this->get_name(), "pop other than through a DAQSource");
+}
+
+template<class T>
+size_t
+BroadcastQueue<T>::get_num_elements() const noexcept
+{
+  const size_t write_index = m_write_index.load(std::memory_order_acquire);
+  size_t behind = 0;
+  const size_t num_consumers = m_num_consumers.load(std::memory_order_acquire);
+  for (size_t i = 0; i < num_consumers; ++i) {
+    const Cursor& cursor = m_cursors[i];
+    if (cursor.active.load(std::memory_order_acquire)) {
+      behind = std::max(behind, write_index - (cursor.read_index.load(std::memory_order_acquire) & ~s_busy));
+    }
+  }
+  return std::min(behind, m_capacity);
+}
+
+template<class T>
+size_t
+BroadcastQueue<T>::refresh_min_read_index()
+{
+  size_t min_read_index = m_write_index.load(std::memory_order_relaxed);
+  const size_t num_consumers = m_num_consumers.load(std::memory_order_acquire);
+  for (size_t i = 0; i < num_consumers; ++i) {
+    Cursor& cursor = m_cursors[i];
+    if (cursor.active.load(std::memory_order_acquire)) {
+      min_read_index = std::min(min_read_index, cursor.read_index.load(std::memory_order_acquire) & ~s_busy);
+    }
+  }
+
+  // Every consumer is past these, so nobody reads them any more, and the bytes they were pushed with leave the queue
+  size_t bytes = 0;
+  for (; m_reclaimed_index < min_read_index; ++m_reclaimed_index) {
+    slot(m_reclaimed_index)->~T();
+    bytes += slot_bytes(m_reclaimed_index);
+  }
+  if (bytes > 0) {
+    this->on_released(bytes);
+  }
+  m_cached_min_read_index = min_read_index;
+  return min_read_index;
+}
+
+template<class T>
+void
+BroadcastQueue<T>::drop_before(size_t index)
+{
+  const size_t num_consumers = m_num_consumers.load(std::memory_order_acquire);
+  for (size_t i = 0; i < num_consumers; ++i) {
+    Cursor& cursor = m_cursors[i];
+    if (!cursor.active.load(std::memory_order_acquire)) {
+      continue;
+    }
+    size_t read_index = cursor.read_index.load(std::memory_order_acquire);
+    while ((read_index & ~s_busy) < index) {
+      if (read_index & s_busy) {
+        // The consumer is using the element; it moves on once it is done
+        std::this_thread::yield();
+        read_index = cursor.read_index.load(std::memory_order_acquire);
+      } else if (cursor.read_index.compare_exchange_weak(
+                   read_index, index, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        this->on_dropped(index - read_index);
+        break;
+      }
+    }
+  }
+}
+
+template<class T>
+bool
+BroadcastQueue<T>::wait_for_space(size_t write_index, const duration_t& timeout)
+{
+  auto space = [&]() { return m_capacity - (write_index - refresh_min_read_index()); };
+
+  if (space() > 0) {
+    return true;
+  }
+  if (m_slow_consumer_policy == SlowConsumerPolicy::kDrop) {
+    drop_before(write_index + 1 - m_capacity);
+    return space() > 0;
+  }
+  if (timeout.count() <= 0) {
+    return false;
+  }
+
+  // The producer is now blocked; the clock is only read on this path
+  const auto start_time = std::chrono::steady_clock::now();
+  auto blocked_for = [&](bool has_space) {
+    this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
+    return has_space;
+  };
+
+  // Closing the queue ends the wait, and then there is no space to push to
+  auto ready = [&]() { return space() > 0 || this->closed(); };
+  const auto deadline = start_time + timeout;
+  wait_until(m_wait_policy, m_no_longer_full, ready, deadline);
+  return blocked_for(!this->closed() && space() > 0);
+}
+
+template<class T>
+void
+BroadcastQueue<T>::notify_consumers() noexcept
+{
+  m_no_longer_empty.notify_all();
+  this->on_readable();
+  const size_t num_consumers = m_num_consumers.load(std::memory_order_acquire);
+  for (size_t i = 0; i < num_consumers; ++i) {
+    if (m_cursors[i].active.load(std::memory_order_relaxed)) {
+      m_cursors[i].readiness.notify();
+    }
+  }
+}
+
+template<class T>
+bool
+BroadcastQueue<T>::try_push(value_t&& object_to_push, const duration_t& timeout)
+{
+  if (this->closed()) {
+    return false;
+  }
+
+  const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+
+  if (write_index - m_cached_min_read_index >= m_capacity && !wait_for_space(write_index, timeout)) {
+    this->on_push_timeout();
+    return false;
+  }
+
+  T* element = new (raw_slot(write_index)) T(std::move(object_to_push));
+  slot_bytes(write_index) = payload_bytes(*element);
+  this->on_pushed(1, slot_bytes(write_index));
+  m_write_index.store(write_index + 1, std::memory_order_release);
+  notify_consumers();
+  return true;
+}
+
+template<class T>
+size_t
+BroadcastQueue<T>::wait_for_data(Cursor& cursor, size_t read_index, const duration_t& timeout)
+{
+  auto available = [&]() {
+    cursor.cached_write_index = m_write_index.load(std::memory_order_acquire);
+    return cursor.cached_write_index - read_index;
+  };
+
+  if (size_t n = available(); n > 0 || timeout.count() <= 0) {
+    return n;
+  }
+
+  // Closing the queue ends the wait; elements pushed before it are still returned
+  auto ready = [&]() { return available() > 0 || this->closed(); };
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  wait_until(m_wait_policy, m_no_longer_empty, ready, deadline);
+  return available();
+}
+
+template<class T>
+const T*
+BroadcastQueue<T>::acquire_element(Cursor& cursor, const duration_t& timeout)
+{
+  size_t read_index = cursor.read_index.load(std::memory_order_acquire);
+  while (true) {
+    // With the drop policy the producer may have moved the cursor past the cached write index
+    if (read_index >= cursor.cached_write_index && wait_for_data(cursor, read_index, timeout) == 0) {
+      this->on_pop_timeout();
+      return nullptr;
+    }
+    if (m_slow_consumer_policy == SlowConsumerPolicy::kBlock) {
+      return slot(read_index);
+    }
+    // Otherwise claim the element, unless the producer has just dropped it
+    if (cursor.read_index.compare_exchange_weak(
+          read_index, read_index | s_busy, std::memory_order_acquire, std::memory_order_acquire)) {
+      return slot(read_index);
+    }
+  }
+}
+
+template<class T>
+void
+BroadcastQueue<T>::release_element(Cursor& cursor, bool consumed) noexcept
+{
+  size_t read_index = cursor.read_index.load(std::memory_order_relaxed) & ~s_busy;
+  if (consumed) {
+    this->on_popped(1, 0); // The element's bytes are counted once every consumer is done with it
+    ++read_index;
+  }
+  cursor.read_index.store(read_index, std::memory_order_release);
+  if (consumed) {
+    m_no_longer_full.notify_all();
+  }
+}
+
+template<class T>
+void
+BroadcastQueue<T>::wake_waiters()
+{
+  m_no_longer_full.notify_all();
+  notify_consumers();
+}
+
+} // namespace dunedaq::appfwk
@@ -0,0 +1,372 @@
+#include "ers/ers.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include <utility>
+
+namespace dunedaq::appfwk {
+
+template<class T>
+ElasticQueue<T>::ElasticQueue(const std::string& name,
+                              size_t chunk_capacity,
+                              size_t max_bytes,
+                              std::chrono::milliseconds idle_time,
+                              WaitPolicy wait_policy,
+                              const PageAllocation::Options& storage_options)
+  : Queue<T>(name)
+  , m_chunk_capacity(std::max(chunk_capacity, size_t(1)))
+  , m_max_chunks(std::max(max_bytes / (m_chunk_capacity * sizeof(T)), size_t(2)) - 1)
+  , m_idle_time(idle_time)
+  , m_wait_policy(wait_policy)
+  , m_storage_options(storage_options)
+  , m_capacity(m_chunk_capacity)
+{
+  this->use_single_writer_counters();
+
+  // Reserve for the largest capacity, so that moving chunks between these never allocates
+  m_chunks.reserve(m_max_chunks + 1);
+  m_chunk_chain.resize(m_max_chunks + 1);
+  m_spare_chunks.reserve(m_max_chunks + 1);
+
+  for (int i = 0; i < 2; ++i) {
+    m_chunks.push_back(std::make_unique<Chunk>(m_chunk_capacity, m_storage_options));
+    m_spare_chunks.push_back(m_chunks.back().get());
+  }
+}
+
+template<class T>
+ElasticQueue<T>::~ElasticQueue()
+{
+  const size_t size = m_size.load(std::memory_order_acquire);
+  for (size_t i = 0; i < size; ++i) {
+    slot(m_read_offset + i)->~T();
+  }
+}
+
+template<class T>
+size_t
+ElasticQueue<T>::get_footprint() const noexcept
+{
+  // The chunks number one more than the capacity needs
+  return (get_capacity() / m_chunk_capacity + 1) * m_chunk_capacity * sizeof(T);
+}
+
+template<class T>
+size_t
+ElasticQueue<T>::get_page_size() const
+{
+  std::lock_guard<std::timed_mutex> lk(m_mutex);
+  return m_chunks.front()->page_size();
+}
+
+template<class T>
+int
+ElasticQueue<T>::get_numa_node() const
+{
+  std::lock_guard<std::timed_mutex> lk(m_mutex);
+  return m_chunks.front()->numa_node();
+}
+
+template<class T>
+void
+ElasticQueue<T>::move_storage_to_numa_node(int numa_node)
+{
+  // Chunks allocated later go to the same node. The queue doesn't shrink
+  // while the pages move, so the chunks can be bound outside the mutex
+  std::vector<Chunk*> chunks;
+  {
+    std::lock_guard<std::timed_mutex> lk(m_mutex);
+    m_storage_options.numa_node = numa_node;
+    for (auto& chunk : m_chunks) {
+      chunks.push_back(chunk.get());
+    }
+    m_migrating = true;
+  }
+  for (Chunk* chunk : chunks) {
+    chunk->bind_to_numa_node(numa_node);
+  }
+  std::lock_guard<std::timed_mutex> lk(m_mutex);
+  m_migrating = false;
+}
+
+template<class T>
+void
+ElasticQueue<T>::get_kind_info(opmonlib::InfoCollector& ci)
+{
+  std::unique_ptr<Chunk> released;
+  {
+    // A queue nobody pops from only shrinks here
+    std::lock_guard<std::timed_mutex> lk(m_mutex);
+    released = shrink_if_idle();
+  }
+
+  queueinfo::ElasticInfo info;
+  info.chunks = get_capacity() / m_chunk_capacity + 1;
+  info.footprint_bytes = get_footprint();
+  info.max_bytes = (m_max_chunks + 1) * m_chunk_capacity * sizeof(T);
+
+  const uint64_t growths = m_growths.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  const uint64_t shrinks = m_shrinks.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  info.growths = growths - m_reported_growths;
+  info.shrinks = shrinks - m_reported_shrinks;
+  m_reported_growths = growths;
+  m_reported_shrinks = shrinks;
+
+  ci.add(info);
+}
+
+template<class T>
+bool
+ElasticQueue<T>::should_grow() noexcept
+{
+  const size_t capacity = m_capacity.load(std::memory_order_relaxed);
+  if (m_growing || capacity >= m_max_chunks * m_chunk_capacity ||
+      m_size.load(std::memory_order_relaxed) * 100 < capacity * s_grow_watermark_percent) {
+    return false;
+  }
+  m_growing = true;
+  return true;
+}
+
+template<class T>
+void
+ElasticQueue<T>::grow()
+{
+  // Allocate (and prefault, if so configured) outside the mutex, so that other producers and consumers aren't held up
+  std::unique_ptr<Chunk> chunk;
+  try {
+    PageAllocation::Options storage_options;
+    {
+      std::lock_guard<std::timed_mutex> lk(m_mutex);
+      storage_options = m_storage_options;
+    }
+    chunk = std::make_unique<Chunk>(m_chunk_capacity, storage_options);
+  } catch (const PageAllocationFailed& e) {
+    // The queue carries on at its current capacity, and tries again at the next push over the watermark
+    ers::warning(e);
+  }
+
+  {
+    std::lock_guard<std::timed_mutex> lk(m_mutex);
+    if (chunk) {
+      m_spare_chunks.push_back(chunk.get());
+      m_chunks.push_back(std::move(chunk));
+      m_capacity.fetch_add(m_chunk_capacity, std::memory_order_relaxed);
+      m_growths.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_growing = false;
+    m_idle_since = {};
+    m_no_longer_full.notify_all();
+  }
+}
+
+template<class T>
+std::unique_ptr<typename ElasticQueue<T>::Chunk>
+ElasticQueue<T>::shrink_if_idle()
+{
+  const size_t capacity = m_capacity.load(std::memory_order_relaxed);
+  const size_t size = m_size.load(std::memory_order_relaxed);
+  if (capacity == m_chunk_capacity || size * 100 > capacity * s_shrink_watermark_percent) {
+    m_idle_since = {};
+    return nullptr;
+  }
+
+  // The clock is only read while the queue is larger than a chunk and under the watermark
+  const auto now = std::chrono::steady_clock::now();
+  if (m_idle_since == std::chrono::steady_clock::time_point()) {
+    m_idle_since = now;
+    return nullptr;
+  }
+  if (now - m_idle_since < m_idle_time || m_spare_chunks.empty() || size > capacity - m_chunk_capacity ||
+      m_migrating) {
+    return nullptr;
+  }
+
+  // Give back one chunk per idle period
+  m_idle_since = now;
+  Chunk* spare = m_spare_chunks.back();
+  m_spare_chunks.pop_back();
+  auto owner = std::find_if(m_chunks.begin(), m_chunks.end(), [&](const auto& chunk) { return chunk.get() == spare; });
+  assert(owner != m_chunks.end());
+  std::unique_ptr<Chunk> released = std::move(*owner);
+  m_chunks.erase(owner);
+  m_capacity.store(capacity - m_chunk_capacity, std::memory_order_relaxed);
+  m_shrinks.fetch_add(1, std::memory_order_relaxed);
+  return released;
+}
+
+template<class T>
+bool
+ElasticQueue<T>::try_push(value_t&& object_to_push, const duration_t& timeout)
+{
+  if (this->closed()) {
+    return false;
+  }
+
+  std::chrono::steady_clock::time_point start_time;
+  std::unique_lock<std::timed_mutex> lk(m_mutex, std::defer_lock);
+
+  // Anything other than getting the lock straight away and finding space counts as being blocked, and only then is
+  // the clock read
+  bool blocked = !lk.try_lock();
+  if (blocked) {
+    start_time = std::chrono::steady_clock::now();
+    if (!this->lock_until(lk, start_time + timeout)) {
+      this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
+      this->on_push_timeout();
+      return false;
+    }
+  }
+
+  if (!this->can_push()) {
+    if (!blocked) {
+      blocked = true;
+      start_time = std::chrono::steady_clock::now();
+    }
+    this->wait_until(lk, m_no_longer_full, [&]() { return this->can_push() || this->closed(); }, start_time + timeout);
+  }
+
+  if (blocked) {
+    this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
+  }
+
+  if (!lk.owns_lock() || !this->can_push() || this->closed()) {
+    this->on_push_timeout();
+    return false;
+  }
+
+  // Move on to a spare chunk once the last chunk in use is full; there always is one while the queue isn't full
+  const size_t position = m_read_offset + m_size.load(std::memory_order_relaxed);
+  if (position / m_chunk_capacity == m_chunks_in_use) {
+    m_chunk_chain[(m_first_chunk + m_chunks_in_use) % m_chunk_chain.size()] = m_spare_chunks.back();
+    m_spare_chunks.pop_back();
+    ++m_chunks_in_use;
+  }
+
+  T* element = new (raw_slot(position)) T(std::move(object_to_push));
+  m_size++;
+  this->on_pushed(1, payload_bytes(*element));
+  const bool grow = should_grow();
+  m_no_longer_empty.notify_one();
+  this->on_readable();
+
+  if (grow) {
+    lk.unlock();
+    this->grow();
+  }
+  return true;
+}
+
+template<class T>
+bool
+ElasticQueue<T>::try_pop(T& val, const duration_t& timeout)
+{
+  // As in try_push(), the clock is only read once the pop has to wait
+  std::chrono::steady_clock::time_point deadline;
+  std::unique_lock<std::timed_mutex> lk(m_mutex, std::defer_lock);
+
+  const bool waited_for_lock = !lk.try_lock();
+  if (waited_for_lock) {
+    deadline = std::chrono::steady_clock::now() + timeout;
+    if (!this->lock_until(lk, deadline)) {
+      this->on_pop_timeout();
+      return false;
+    }
+  }
+
+  if (!this->can_pop()) {
+    if (!waited_for_lock) {
+      deadline = std::chrono::steady_clock::now() + timeout;
+    }
+    if (!this->wait_until(lk, m_no_longer_empty, [&]() { return this->can_pop() || this->closed(); }, deadline) ||
+        !this->can_pop()) {
+      std::unique_ptr<Chunk> released;
+      if (lk.owns_lock()) {
+        released = shrink_if_idle();
+        lk.unlock();
+      }
+      this->on_pop_timeout();
+      return false;
+    }
+  }
+
+  T* element = slot(m_read_offset);
+  val = std::move(*element);
+  element->~T();
+  m_size--;
+
+  // Hand the first chunk back once consumers are done with it
+  if (++m_read_offset == m_chunk_capacity) {
+    m_spare_chunks.push_back(m_chunk_chain[m_first_chunk]);
+    m_first_chunk = (m_first_chunk + 1) % m_chunk_chain.size();
+    --m_chunks_in_use;
+    m_read_offset = 0;
+  }
+  this->on_popped(1, payload_bytes(val));
+  m_no_longer_full.notify_one();
+
+  auto released = shrink_if_idle();
+  lk.unlock();
+  return true;
+}
+
+// As in StdDeQueue, notifying with the mutex held, after close() set the
+// flag, means that a thread can't miss the notification
+
+template<class T>
+void
+ElasticQueue<T>::wake_waiters()
+{
+  std::lock_guard<std::timed_mutex> lk(m_mutex);
+  m_no_longer_empty.notify_all();
+  m_no_longer_full.notify_all();
+}
+
+template<class T>
+bool
+ElasticQueue<T>::lock_until(std::unique_lock<std::timed_mutex>& lk, std::chrono::steady_clock::time_point deadline)
+{
+  assert(!lk.owns_lock());
+
+  if (spin_until(m_wait_policy, [&]() { return lk.try_lock(); }, deadline)) {
+    return true;
+  }
+  if (!parks(m_wait_policy)) {
+    return false;
+  }
+  return lk.try_lock_until(deadline);
+}
+
+template<class T>
+template<typename Condition>
+bool
+ElasticQueue<T>::wait_until(std::unique_lock<std::timed_mutex>& lk,
+                            TimedMutexCondition& cv,
+                            Condition condition,
+                            std::chrono::steady_clock::time_point deadline)
+{
+  assert(lk.owns_lock());
+
+  if (condition()) {
+    return true;
+  }
+  if (std::chrono::steady_clock::now() >= deadline) {
+    return false;
+  }
+
+  if (m_wait_policy != WaitPolicy::kBlock) {
+    lk.unlock();
+    spin_until(m_wait_policy, condition, deadline);
+    if (!lock_until(lk, deadline)) {
+      return false;
+    }
+    if (condition() || !parks(m_wait_policy)) {
+      return condition();
+    }
+  }
+
+  return cv.wait_until(lk, deadline, condition);
+}
+
+} // namespace dunedaq::appfwk
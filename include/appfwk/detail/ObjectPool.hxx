@@ -0,0 +1,104 @@
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace dunedaq::appfwk {
+
+template<class T>
+ObjectPool<T>::ObjectPool(const std::string& name,
+                          size_t count,
+                          size_t slab_size,
+                          const PageAllocation::Options& options)
+  : PoolBase(name)
+  , m_count(std::min(count, size_t(s_no_index)))
+  , m_stride((std::max(slab_size, sizeof(T)) + alignof(T) - 1) / alignof(T) * alignof(T))
+  , m_memory(m_count * m_stride, options)
+  , m_next_free(new std::atomic<index_t>[m_count])
+{
+  // Initially every slot is free, and they are handed out in address order
+  for (size_t i = 0; i < m_count; ++i) {
+    m_next_free[i].store(i + 1 < m_count ? index_t(i + 1) : s_no_index, std::memory_order_relaxed);
+  }
+  m_free_head.store(m_count > 0 ? 0 : s_no_index, std::memory_order_release);
+}
+
+template<class T>
+template<typename... Args>
+typename ObjectPool<T>::pointer_t
+ObjectPool<T>::try_acquire(Args&&... args)
+{
+  const index_t index = pop_free_slot();
+  if (index == s_no_index) {
+    this->on_exhausted();
+    return pointer_t();
+  }
+
+  T* object = nullptr;
+  try {
+    object = new (slot(index)) T(std::forward<Args>(args)...);
+  } catch (...) {
+    push_free_slot(index);
+    throw;
+  }
+  this->on_acquired();
+  return pointer_t(object, Deleter(this));
+}
+
+template<class T>
+template<typename... Args>
+typename ObjectPool<T>::pointer_t
+ObjectPool<T>::acquire(Args&&... args)
+{
+  pointer_t object = try_acquire(std::forward<Args>(args)...);
+  if (!object) {
+    throw PoolExhausted(ERS_HERE, this->get_name(), m_count);
+  }
+  return object;
+}
+
+template<class T>
+void
+ObjectPool<T>::release(T* object) noexcept
+{
+  const auto offset = static_cast<size_t>(reinterpret_cast<char*>(object) - static_cast<char*>(m_memory.data()));
+  object->~T();
+  push_free_slot(index_t(offset / m_stride));
+  this->on_released();
+}
+
+template<class T>
+typename ObjectPool<T>::index_t
+ObjectPool<T>::pop_free_slot() noexcept
+{
+  uint64_t head = m_free_head.load(std::memory_order_acquire); // NOLINT(build/unsigned)
+  while (true) {
+    const auto index = index_t(head);
+    if (index == s_no_index) {
+      return s_no_index;
+    }
+    // The link may be stale if another thread took the slot meanwhile, but
+    // then the tag has changed and the exchange fails
+    const index_t next = m_next_free[index].load(std::memory_order_relaxed);
+    const uint64_t new_head = ((head >> 32) + 1) << 32 | next; // NOLINT(build/unsigned)
+    if (m_free_head.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire)) {
+      return index;
+    }
+  }
+}
+
+template<class T>
+void
+ObjectPool<T>::push_free_slot(index_t index) noexcept
+{
+  uint64_t head = m_free_head.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  while (true) {
+    m_next_free[index].store(index_t(head), std::memory_order_relaxed);
+    const uint64_t new_head = ((head >> 32) + 1) << 32 | index; // NOLINT(build/unsigned)
+    if (m_free_head.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+} // namespace dunedaq::appfwk
@@ -0,0 +1,203 @@
+
+#include "appfwk/queueinfo/InfoNljs.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace dunedaq::appfwk {
+
+template<class T>
+PriorityQueue<T>::PriorityQueue(const std::string& name,
+                                size_t capacity,
+                                size_t num_lanes,
+                                WaitPolicy wait_policy,
+                                const PageAllocation::Options& storage_options)
+  : Queue<T>(name)
+  , m_num_lanes(std::clamp(num_lanes, size_t(1), s_max_lanes))
+  , m_lane_size(detail::next_power_of_two(std::max(capacity, size_t(1))))
+  , m_mask(m_lane_size - 1)
+  , m_wait_policy(wait_policy)
+  , m_cells(m_lane_size * m_num_lanes, storage_options)
+{
+  // Every slot starts out free for the push at its own position
+  for (size_t lane = 0; lane < m_num_lanes; ++lane) {
+    for (size_t i = 0; i < m_lane_size; ++i) {
+      new (m_cells.raw_slot(lane * m_lane_size + i)) Cell{ { i }, {} };
+    }
+  }
+}
+
+template<class T>
+PriorityQueue<T>::~PriorityQueue()
+{
+  for (size_t lane = 0; lane < m_num_lanes; ++lane) {
+    const size_t push_index = m_lanes[lane].push_index.load(std::memory_order_acquire);
+    for (size_t i = m_lanes[lane].pop_index.load(std::memory_order_acquire); i != push_index; ++i) {
+      cell(lane, i).element()->~T();
+    }
+  }
+}
+
+template<class T>
+size_t
+PriorityQueue<T>::get_lane_num_elements(size_t lane) const noexcept
+{
+  // As in SPSCRingQueue, loading the pop index first means the difference is never negative
+  const size_t pop_index = m_lanes[lane].pop_index.load(std::memory_order_acquire);
+  const size_t push_index = m_lanes[lane].push_index.load(std::memory_order_acquire);
+  return std::min(push_index - pop_index, m_lane_size);
+}
+
+template<class T>
+size_t
+PriorityQueue<T>::get_num_elements() const noexcept
+{
+  size_t num_elements = 0;
+  for (size_t lane = 0; lane < m_num_lanes; ++lane) {
+    num_elements += get_lane_num_elements(lane);
+  }
+  return num_elements;
+}
+
+template<class T>
+void
+PriorityQueue<T>::get_kind_info(opmonlib::InfoCollector& ci)
+{
+  for (size_t lane = 0; lane < m_num_lanes; ++lane) {
+    queueinfo::PriorityLane lane_info;
+    lane_info.number_of_elements = get_lane_num_elements(lane);
+    opmonlib::InfoCollector lane_ci;
+    lane_ci.add(lane_info);
+    ci.add("lane_" + std::to_string(lane), lane_ci);
+  }
+}
+
+template<class T>
+bool
+PriorityQueue<T>::try_enqueue(size_t lane, value_t& val)
+{
+  std::atomic<size_t>& push_index = m_lanes[lane].push_index;
+  size_t index = push_index.load(std::memory_order_relaxed);
+  while (true) {
+    Cell& c = cell(lane, index);
+    const auto lag = static_cast<intptr_t>(c.sequence.load(std::memory_order_acquire) - index);
+    if (lag == 0) {
+      if (push_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+        new (&c.storage) T(std::move(val));
+        c.sequence.store(index + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (lag < 0) {
+      return false; // The slot still holds the element from the previous lap, so the lane is full
+    } else {
+      index = push_index.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template<class T>
+bool
+PriorityQueue<T>::try_dequeue(size_t lane, value_t& val)
+{
+  std::atomic<size_t>& pop_index = m_lanes[lane].pop_index;
+  size_t index = pop_index.load(std::memory_order_relaxed);
+  while (true) {
+    Cell& c = cell(lane, index);
+    const auto lag = static_cast<intptr_t>(c.sequence.load(std::memory_order_acquire) - (index + 1));
+    if (lag == 0) {
+      if (pop_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+        T* element = c.element();
+        val = std::move(*element);
+        element->~T();
+        c.sequence.store(index + m_lane_size, std::memory_order_release);
+        return true;
+      }
+    } else if (lag < 0) {
+      return false; // Nothing has been pushed at this position yet, so the lane is empty
+    } else {
+      index = pop_index.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template<class T>
+bool
+PriorityQueue<T>::try_dequeue_any(value_t& val)
+{
+  for (size_t lane = 0; lane < m_num_lanes; ++lane) {
+    if (try_dequeue(lane, val)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<class T>
+bool
+PriorityQueue<T>::try_push_with_priority(value_t&& val, size_t priority, const duration_t& timeout)
+{
+  if (this->closed()) {
+    return false;
+  }
+
+  const size_t lane = std::min(priority, m_num_lanes - 1);
+  const size_t bytes = payload_bytes(val); // val is moved from once it is in the queue
+
+  if (!try_enqueue(lane, val)) {
+    if (timeout.count() <= 0) {
+      this->on_push_timeout();
+      return false;
+    }
+
+    // The producer is now blocked; the clock is only read on this path
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto deadline = start_time + timeout;
+    bool pushed = false;
+    auto ready = [&]() { return this->closed() || (pushed = try_enqueue(lane, val)); };
+    wait_until(m_wait_policy, m_no_longer_full, ready, deadline);
+    this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
+    if (!pushed) {
+      this->on_push_timeout();
+      return false;
+    }
+  }
+
+  this->on_pushed(1, bytes);
+  m_no_longer_empty.notify_all();
+  this->on_readable();
+  return true;
+}
+
+template<class T>
+bool
+PriorityQueue<T>::try_pop(value_t& val, const duration_t& timeout)
+{
+  if (!try_dequeue_any(val)) {
+    bool popped = false;
+    if (timeout.count() > 0) {
+      // Closing the queue ends the wait; elements pushed before it are still returned
+      auto ready = [&]() { return (popped = try_dequeue_any(val)) || this->closed(); };
+      const auto deadline = std::chrono::steady_clock::now() + timeout;
+      wait_until(m_wait_policy, m_no_longer_empty, ready, deadline);
+    }
+    if (!popped) {
+      this->on_pop_timeout();
+      return false;
+    }
+  }
+
+  this->on_popped(1, payload_bytes(val));
+  m_no_longer_full.notify_all();
+  return true;
+}
+
+template<class T>
+void
+PriorityQueue<T>::wake_waiters()
+{
+  m_no_longer_empty.notify_all();
+  m_no_longer_full.notify_all();
+}
+
+} // namespace dunedaq::appfwk
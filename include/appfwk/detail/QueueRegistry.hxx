@@ -1,44 +1,153 @@
+#include "appfwk/BroadcastQueue.hpp"
+#include "appfwk/ElasticQueue.hpp"
 #include "appfwk/FollyQueue.hpp"
+#include "appfwk/PriorityQueue.hpp"
+#include "appfwk/SPSCRingQueue.hpp"
+#include "appfwk/SharedMemoryQueue.hpp"
 #include "appfwk/StdDeQueue.hpp"
 
 #include <cxxabi.h>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
 
 // Declarations
 namespace dunedaq::appfwk {
 
+template<typename T, template<typename> class QueueType>
+std::shared_ptr<QueueType<T>>
+QueueRegistry::get_queue(const std::string& name)
+{
+  std::shared_ptr<Queue<T>> queuePtr;
+
+  {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto queue_it = m_queue_registry.find(name);
+    if (queue_it != m_queue_registry.end()) {
+      queuePtr = queue_of_type<T>(name, queue_it->second);
+    }
+  }
+
+  if (!queuePtr) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+    // Another thread may have created the Queue while we waited for the lock
+    auto queue_it = m_queue_registry.find(name);
+    if (queue_it == m_queue_registry.end()) {
+      auto config_it = this->m_queue_config_map.find(name);
+      if (config_it == m_queue_config_map.end()) {
+        // TODO: John Freeman (jcfree@fnal.gov), Jun-23-2020. Add checks for demangling status. Timescale 2 weeks.
+        int status = -999;
+        std::string realname_target = abi::__cxa_demangle(typeid(T).name(), 0, 0, &status);
+        throw QueueNotFound(ERS_HERE, name, realname_target);
+      }
+
+      QueueEntry entry = { &typeid(T), create_queue<T>(name, config_it->second) };
+      queue_it = m_queue_registry.emplace(name, std::move(entry)).first;
+    }
+    queuePtr = queue_of_type<T>(name, queue_it->second);
+  }
+
+  return as_queue_type<QueueType>(name, std::move(queuePtr));
+}
+
 template<typename T>
 std::shared_ptr<Queue<T>>
-QueueRegistry::get_queue(const std::string& name)
+QueueRegistry::queue_of_type(const std::string& name, const QueueEntry& entry)
 {
+  // create_queue<T> only makes Queue<T>s, so a matching element type is all the static cast needs. Comparing
+  // type_infos rather than addresses of per-type statics keeps this correct for plugins loaded with RTLD_LOCAL.
+  if (*entry.m_type != typeid(T)) {
+    // TODO: John Freeman (jcfree@fnal.gov), Jun-23-2020. Add checks for demangling status. Timescale 2 weeks.
+    int status = -999;
+    std::string realname_target = abi::__cxa_demangle(typeid(T).name(), 0, 0, &status);
+    std::string realname_source = abi::__cxa_demangle(entry.m_type->name(), 0, 0, &status);
 
-  auto queue_it = m_queue_registry.find(name);
-  if (queue_it != m_queue_registry.end()) {
-    auto queuePtr = std::dynamic_pointer_cast<Queue<T>>(queue_it->second.m_instance);
+    throw QueueTypeMismatch(ERS_HERE, name, realname_source, realname_target);
+  }
+  return std::static_pointer_cast<Queue<T>>(entry.m_instance);
+}
+
+template<template<typename> class QueueType, typename T>
+std::shared_ptr<QueueType<T>>
+QueueRegistry::as_queue_type(const std::string& name, std::shared_ptr<Queue<T>> queue)
+{
+  if constexpr (std::is_same_v<QueueType<T>, Queue<T>>) {
+    return queue;
+  } else {
+    const Queue<T>& instance = *queue;
+    std::shared_ptr<QueueType<T>> typedPtr;
+    if constexpr (std::is_final_v<QueueType<T>>) {
+      // Nothing derives from a final class, so its type_info identifies it exactly
+      if (typeid(instance) == typeid(QueueType<T>)) {
+        typedPtr = std::static_pointer_cast<QueueType<T>>(std::move(queue));
+      }
+    } else {
+      typedPtr = std::dynamic_pointer_cast<QueueType<T>>(std::move(queue));
+    }
 
-    if (!queuePtr) {
-      // TODO: John Freeman (jcfree@fnal.gov), Jun-23-2020. Add checks for demangling status. Timescale 2 weeks.
+    if (!typedPtr) {
       int status = -999;
-      std::string realname_target = abi::__cxa_demangle(typeid(T).name(), 0, 0, &status);
-      std::string realname_source = abi::__cxa_demangle(queue_it->second.m_type->name(), 0, 0, &status);
+      std::string realname_target = abi::__cxa_demangle(typeid(QueueType<T>).name(), 0, 0, &status);
+      std::string realname_source = abi::__cxa_demangle(typeid(instance).name(), 0, 0, &status);
+      throw QueueKindMismatch(ERS_HERE, name, realname_source, realname_target);
+    }
+    return typedPtr;
+  }
+}
 
-      throw QueueTypeMismatch(ERS_HERE, name, realname_source, realname_target);
+template<typename T>
+std::shared_ptr<ObjectPool<T>>
+QueueRegistry::get_pool(const std::string& name)
+{
+  {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto pool_it = m_pool_registry.find(name);
+    if (pool_it != m_pool_registry.end()) {
+      return pool_of_type<T>(name, pool_it->second);
     }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
 
-    return queuePtr;
+  // Another thread may have created the pool while we waited for the lock
+  auto pool_it = m_pool_registry.find(name);
+  if (pool_it != m_pool_registry.end()) {
+    return pool_of_type<T>(name, pool_it->second);
   }
 
-  auto config_it = this->m_queue_config_map.find(name);
-  if (config_it != m_queue_config_map.end()) {
-    QueueEntry entry = { &typeid(T), create_queue<T>(name, config_it->second) };
-    m_queue_registry[name] = entry;
-    return std::dynamic_pointer_cast<Queue<T>>(entry.m_instance);
+  auto config_it = m_pool_config_map.find(name);
+  if (config_it != m_pool_config_map.end()) {
+    const PoolConfig& config = config_it->second;
+    PageAllocation::Options options;
+    options.numa_node = config.numa_node;
+    options.prefault = config.prefault;
+    options.huge_pages = config.huge_pages;
+    options.lock = config.lock_memory;
+    auto pool = std::make_shared<ObjectPool<T>>(name, config.count, config.slab_size, options);
+    m_pool_registry.emplace(name, PoolEntry{ &typeid(T), pool });
+    return pool;
 
   } else {
-    // TODO: John Freeman (jcfree@fnal.gov), Jun-23-2020. Add checks for demangling status. Timescale 2 weeks.
     int status = -999;
     std::string realname_target = abi::__cxa_demangle(typeid(T).name(), 0, 0, &status);
-    throw QueueNotFound(ERS_HERE, name, realname_target);
+    throw PoolNotFound(ERS_HERE, name, realname_target);
+  }
+}
+
+template<typename T>
+std::shared_ptr<ObjectPool<T>>
+QueueRegistry::pool_of_type(const std::string& name, const PoolEntry& entry)
+{
+  if (*entry.m_type != typeid(T)) {
+    int status = -999;
+    std::string realname_target = abi::__cxa_demangle(typeid(T).name(), 0, 0, &status);
+    std::string realname_source = abi::__cxa_demangle(entry.m_type->name(), 0, 0, &status);
+
+    throw PoolTypeMismatch(ERS_HERE, name, realname_source, realname_target);
   }
+  return std::static_pointer_cast<ObjectPool<T>>(entry.m_instance);
 }
 
 template<typename T>
@@ -46,22 +155,88 @@ std::shared_ptr<QueueBase>
 QueueRegistry::create_queue(const std::string& name, const QueueConfig& config)
 {
 
+  // Only the queues which preallocate their storage can honour these
+  PageAllocation::Options storage_options;
+  storage_options.prefault = config.prefault;
+  storage_options.huge_pages = config.huge_pages;
+  storage_options.lock = config.lock_memory;
+  storage_options.numa_node = config.numa_node;
+
+  const WaitPolicy wait_policy = config.wait_policy.value_or(QueueConfig::default_wait_policy(config.kind));
+
   std::shared_ptr<QueueBase> queue;
   switch (config.kind) {
     case QueueConfig::kStdDeQueue:
-      queue = std::make_shared<StdDeQueue<T>>(name, config.capacity);
+      queue = std::make_shared<StdDeQueue<T>>(name, config.capacity, wait_policy, storage_options);
       break;
     case QueueConfig::kFollySPSCQueue:
-      queue = std::make_shared<FollySPSCQueue<T>>(name, config.capacity);
+      queue = std::make_shared<FollySPSCQueue<T>>(name, config.capacity, wait_policy);
       break;
     case QueueConfig::kFollyMPMCQueue:
-      queue = std::make_shared<FollyMPMCQueue<T>>(name, config.capacity);
+      queue = std::make_shared<FollyMPMCQueue<T>>(name, config.capacity, wait_policy);
+      break;
+    case QueueConfig::kSPSCRingQueue:
+      queue = std::make_shared<SPSCRingQueue<T>>(name, config.capacity, wait_policy, storage_options);
+      break;
+    case QueueConfig::kBroadcastQueue:
+      queue = std::make_shared<BroadcastQueue<T>>(
+        name, config.capacity, config.slow_consumer_policy, wait_policy, storage_options);
+      break;
+    case QueueConfig::kPriorityQueue:
+      queue = std::make_shared<PriorityQueue<T>>(
+        name, config.capacity, config.priority_lanes, wait_policy, storage_options);
+      break;
+    case QueueConfig::kSharedMemoryQueue:
+      if constexpr (is_shared_memory_payload_v<T>) {
+        queue = std::make_shared<SharedMemoryQueue<T>>(name, config.capacity, wait_policy, storage_options);
+      } else {
+        int status = -999;
+        std::string realname_target = abi::__cxa_demangle(typeid(T).name(), 0, 0, &status);
+        throw QueueTypeUnsupported(ERS_HERE, name, "SharedMemoryQueue", realname_target);
+      }
+      break;
+    case QueueConfig::kElasticQueue:
+      queue = std::make_shared<ElasticQueue<T>>(name,
+                                                config.capacity,
+                                                config.max_bytes,
+                                                std::chrono::milliseconds(config.idle_ms),
+                                                wait_policy,
+                                                storage_options);
       break;
 
     default:
       throw QueueKindUnknown(ERS_HERE, std::to_string(config.kind));
   }
 
+  // The dwell time recorder relies on elements being popped once each, in the order they were pushed, which isn't
+  // so for a BroadcastQueue or a PriorityQueue, and on the same process pushing and popping them, which needn't be so
+  // for a SharedMemoryQueue
+  if (config.dwell_time && config.kind != QueueConfig::kBroadcastQueue && config.kind != QueueConfig::kPriorityQueue &&
+      config.kind != QueueConfig::kSharedMemoryQueue) {
+    queue->enable_dwell_time_monitoring();
+  }
+  if (config.follow_consumer) {
+    queue->follow_consumer();
+  }
+
+  // Only the queues whose producers test for space themselves can also test for bytes
+  if (config.capacity_bytes > 0) {
+    if (config.kind != QueueConfig::kStdDeQueue && config.kind != QueueConfig::kSPSCRingQueue &&
+        config.kind != QueueConfig::kElasticQueue) {
+      throw QueueCapacityBytesUnsupported(ERS_HERE, name, std::to_string(config.kind));
+    }
+    queue->set_capacity_bytes(config.capacity_bytes);
+  }
+
+  // The credits are held by the queue object, which every consumer of a BroadcastQueue pops from a view of, and
+  // which each process attached to a SharedMemoryQueue has its own of
+  if (config.credits > 0) {
+    if (config.kind == QueueConfig::kBroadcastQueue || config.kind == QueueConfig::kSharedMemoryQueue) {
+      throw QueueCreditsUnsupported(ERS_HERE, name, std::to_string(config.kind));
+    }
+    queue->enable_credits(config.credits);
+  }
+
   return queue;
 }
 
@@ -0,0 +1,401 @@
+
+#include <algorithm>
+#include <new>
+
+namespace dunedaq::appfwk {
+
+template<class T>
+SPSCRingQueue<T>::SPSCRingQueue(const std::string& name,
+                                size_t capacity,
+                                WaitPolicy wait_policy,
+                                const PageAllocation::Options& storage_options)
+  : Queue<T>(name)
+  , m_capacity(capacity)
+  , m_wait_policy(wait_policy)
+  , m_storage_options(storage_options)
+  , m_ring(std::make_unique<Ring>(detail::next_power_of_two(std::max(capacity, size_t(1))), storage_options))
+  , m_switch_ring(m_ring.get())
+  , m_producer_ring(m_ring.get())
+  , m_consumer_ring(m_ring.get())
+{
+  this->use_single_writer_counters();
+}
+
+template<class T>
+SPSCRingQueue<T>::~SPSCRingQueue()
+{
+  // Elements from the switch index on are in the producer's ring if the consumer hasn't followed it yet
+  const size_t write_index = m_write_index.load(std::memory_order_acquire);
+  size_t i = m_read_index.load(std::memory_order_acquire);
+  if (m_consumer_ring.load(std::memory_order_acquire) != m_producer_ring) {
+    for (const size_t switch_index = m_switch_index.load(std::memory_order_acquire); i != switch_index; ++i) {
+      slot(i)->~T();
+    }
+    m_consumer_ring.store(m_producer_ring, std::memory_order_relaxed);
+  }
+  for (; i != write_index; ++i) {
+    slot(i)->~T();
+  }
+}
+
+template<class T>
+bool
+SPSCRingQueue<T>::resize(size_t capacity)
+{
+  if (capacity == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lk(m_resize_mutex);
+
+  if (this->get_num_elements() > capacity) {
+    return false;
+  }
+
+  // Free the smaller ring once the consumer has followed the producer to the larger one
+  if (m_next_ring && m_consumer_ring.load(std::memory_order_acquire) == m_next_ring.get()) {
+    m_ring = std::move(m_next_ring);
+  }
+
+  const size_t num_slots = detail::next_power_of_two(capacity);
+  if (m_next_ring) {
+    if (num_slots <= m_next_ring->mask + 1) {
+      m_capacity.store(capacity, std::memory_order_relaxed);
+      m_no_longer_full.notify_all();
+      return true;
+    }
+    // Take the offered ring back to offer a larger one, unless the producer has already moved to it and the consumer
+    // is still reading from the ring before
+    Ring* offered = m_next_ring.get();
+    if (!m_offered_ring.compare_exchange_strong(offered, nullptr, std::memory_order_acq_rel)) {
+      return false;
+    }
+    m_next_ring.reset();
+  }
+
+  if (num_slots > m_ring->mask + 1) {
+    m_next_ring = std::make_unique<Ring>(num_slots, m_storage_options);
+    m_capacity.store(capacity, std::memory_order_relaxed);
+    m_offered_ring.store(m_next_ring.get(), std::memory_order_release);
+  } else {
+    m_capacity.store(capacity, std::memory_order_relaxed);
+  }
+
+  // A producer waiting for space may now have some
+  m_no_longer_full.notify_all();
+  return true;
+}
+
+template<class T>
+void
+SPSCRingQueue<T>::move_producer_to_offered_ring(size_t write_index) noexcept
+{
+  if (m_offered_ring.load(std::memory_order_relaxed) == nullptr) {
+    return;
+  }
+  Ring* ring = m_offered_ring.exchange(nullptr, std::memory_order_acquire);
+  if (ring == nullptr) {
+    return;
+  }
+
+  // Publish the index before writing any element to the new ring; the consumer sees it before it sees the element
+  m_switch_index.store(write_index, std::memory_order_relaxed);
+  m_switch_ring.store(ring, std::memory_order_release);
+  m_producer_ring = ring;
+}
+
+template<class T>
+void
+SPSCRingQueue<T>::follow_producer_to_ring(size_t read_index) noexcept
+{
+  // The producer moves before it publishes a write index past the switch index, so having loaded the write index, the
+  // consumer can't have read past the switch index in its old ring
+  Ring* ring = m_switch_ring.load(std::memory_order_acquire);
+  if (ring == m_consumer_ring.load(std::memory_order_relaxed)) {
+    return;
+  }
+  const size_t switch_index = m_switch_index.load(std::memory_order_relaxed);
+  if (read_index == switch_index) {
+    m_consumer_ring.store(ring, std::memory_order_release);
+  } else {
+    m_cached_write_index = std::min(m_cached_write_index, switch_index);
+  }
+}
+
+template<class T>
+size_t
+SPSCRingQueue<T>::get_page_size() const
+{
+  std::lock_guard<std::mutex> lk(m_resize_mutex);
+  return m_ring->slots.page_size();
+}
+
+template<class T>
+int
+SPSCRingQueue<T>::get_numa_node() const
+{
+  std::lock_guard<std::mutex> lk(m_resize_mutex);
+  return m_ring->slots.numa_node();
+}
+
+template<class T>
+void
+SPSCRingQueue<T>::move_storage_to_numa_node(int numa_node)
+{
+  // Rings allocated by a later resize() go to the same node
+  std::lock_guard<std::mutex> lk(m_resize_mutex);
+  m_storage_options.numa_node = numa_node;
+  m_ring->slots.bind_to_numa_node(numa_node);
+  m_ring->slot_bytes.bind_to_numa_node(numa_node);
+  if (m_next_ring) {
+    m_next_ring->slots.bind_to_numa_node(numa_node);
+    m_next_ring->slot_bytes.bind_to_numa_node(numa_node);
+  }
+}
+
+template<class T>
+size_t
+SPSCRingQueue<T>::get_num_elements() const noexcept
+{
+  // Load the read index first: the write index can only have moved further
+  // ahead by the time it is loaded, so the difference is never negative, but
+  // it may briefly overestimate if the consumer moves in between
+  const size_t read_index = m_read_index.load(std::memory_order_acquire);
+  const size_t write_index = m_write_index.load(std::memory_order_acquire);
+  return std::min(write_index - read_index, m_capacity.load(std::memory_order_relaxed));
+}
+
+template<class T>
+size_t
+SPSCRingQueue<T>::wait_for_space(size_t write_index, const duration_t& timeout)
+{
+  auto space = [&]() {
+    move_producer_to_offered_ring(write_index);
+    m_cached_read_index = m_read_index.load(std::memory_order_acquire);
+    return free_slots(write_index);
+  };
+
+  if (size_t n = space(); n > 0 || timeout.count() <= 0) {
+    return n;
+  }
+
+  // The producer is now blocked; the clock is only read on this path
+  const auto start_time = std::chrono::steady_clock::now();
+  auto blocked_for = [&](size_t n) {
+    this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
+    return n;
+  };
+
+  // Closing the queue ends the wait, and then there is no space to push to
+  auto ready = [&]() { return space() > 0 || this->closed(); };
+  const auto deadline = start_time + timeout;
+  wait_until(m_wait_policy, m_no_longer_full, ready, deadline);
+  return blocked_for(this->closed() ? 0 : space());
+}
+
+template<class T>
+size_t
+SPSCRingQueue<T>::wait_for_data(size_t read_index, const duration_t& timeout)
+{
+  auto available = [&]() {
+    m_cached_write_index = m_write_index.load(std::memory_order_acquire);
+    follow_producer_to_ring(read_index);
+    return m_cached_write_index - read_index;
+  };
+
+  if (size_t n = available(); n > 0 || timeout.count() <= 0) {
+    return n;
+  }
+
+  // Closing the queue ends the wait; elements pushed before it are still returned
+  auto ready = [&]() { return available() > 0 || this->closed(); };
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  wait_until(m_wait_policy, m_no_longer_empty, ready, deadline);
+  return available();
+}
+
+template<class T>
+bool
+SPSCRingQueue<T>::try_push(value_t&& object_to_push, const duration_t& timeout)
+{
+  if (this->closed()) {
+    return false;
+  }
+
+  const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+
+  if (free_slots(write_index) == 0 && wait_for_space(write_index, timeout) == 0) {
+    this->on_push_timeout();
+    return false;
+  }
+
+  T* element = new (raw_slot(write_index)) T(std::move(object_to_push));
+  this->on_pushed(1, record_bytes(write_index, *element));
+  m_write_index.store(write_index + 1, std::memory_order_release);
+  m_no_longer_empty.notify_all();
+  this->on_readable();
+  return true;
+}
+
+template<class T>
+bool
+SPSCRingQueue<T>::try_pop(T& val, const duration_t& timeout)
+{
+  const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+
+  if (read_index == m_cached_write_index && wait_for_data(read_index, timeout) == 0) {
+    this->on_pop_timeout();
+    return false;
+  }
+
+  T* element = slot(read_index);
+  val = std::move(*element);
+  element->~T();
+  this->on_popped(1, recorded_bytes(read_index));
+  m_read_index.store(read_index + 1, std::memory_order_release);
+  m_no_longer_full.notify_all();
+  return true;
+}
+
+template<class T>
+void*
+SPSCRingQueue<T>::try_reserve_slot(const duration_t& timeout)
+{
+  if (this->closed()) {
+    return nullptr;
+  }
+
+  const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+
+  if (free_slots(write_index) == 0 && wait_for_space(write_index, timeout) == 0) {
+    this->on_push_timeout();
+    return nullptr;
+  }
+  return raw_slot(write_index);
+}
+
+template<class T>
+void
+SPSCRingQueue<T>::commit_slot()
+{
+  const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+  this->on_pushed(1, record_bytes(write_index, *m_producer_ring->slots.slot(write_index & m_producer_ring->mask)));
+  m_write_index.store(write_index + 1, std::memory_order_release);
+  m_no_longer_empty.notify_all();
+  this->on_readable();
+}
+
+template<class T>
+T*
+SPSCRingQueue<T>::try_peek(const duration_t& timeout)
+{
+  const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+
+  if (read_index == m_cached_write_index && wait_for_data(read_index, timeout) == 0) {
+    this->on_pop_timeout();
+    return nullptr;
+  }
+  return slot(read_index);
+}
+
+template<class T>
+void
+SPSCRingQueue<T>::release_peeked()
+{
+  const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+  // The element may have been changed in place since it was pushed; it leaves with the bytes it came with
+  slot(read_index)->~T();
+  this->on_popped(1, recorded_bytes(read_index));
+  m_read_index.store(read_index + 1, std::memory_order_release);
+  m_no_longer_full.notify_all();
+}
+
+template<class T>
+size_t
+SPSCRingQueue<T>::push_n(value_t* vals, size_t count, const duration_t& timeout)
+{
+  if (count == 0) {
+    return 0;
+  }
+  if (this->closed()) {
+    this->throw_failed("push", timeout);
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  size_t write_index = m_write_index.load(std::memory_order_relaxed);
+  size_t pushed = 0;
+
+  while (pushed < count) {
+    size_t space = free_slots(write_index);
+    if (space == 0) {
+      auto remaining = std::chrono::duration_cast<duration_t>(deadline - std::chrono::steady_clock::now());
+      space = wait_for_space(write_index, std::max(remaining, duration_t::zero()));
+      if (space == 0) {
+        break;
+      }
+    }
+
+    const size_t n = std::min(space, count - pushed);
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; ++i) {
+      bytes += record_bytes(write_index + i, *new (raw_slot(write_index + i)) T(std::move(vals[pushed + i])));
+    }
+    write_index += n;
+    pushed += n;
+    this->on_pushed(n, bytes);
+    m_write_index.store(write_index, std::memory_order_release);
+    m_no_longer_empty.notify_all();
+    this->on_readable();
+  }
+
+  if (pushed < count) {
+    this->on_push_timeout();
+  }
+  if (pushed == 0) {
+    this->throw_failed("push", timeout);
+  }
+  return pushed;
+}
+
+template<class T>
+size_t
+SPSCRingQueue<T>::pop_n(value_t* vals, size_t max_count, const duration_t& timeout)
+{
+  if (max_count == 0) {
+    return 0;
+  }
+
+  const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+  size_t available = m_cached_write_index - read_index;
+  if (available < max_count) {
+    // Refresh the cached write index so we take everything that is there, waiting only if there is nothing
+    available = wait_for_data(read_index, available == 0 ? timeout : duration_t::zero());
+  }
+
+  if (available == 0) {
+    this->on_pop_timeout();
+    this->throw_failed("pop", timeout);
+  }
+
+  const size_t n = std::min(available, max_count);
+  size_t bytes = 0;
+  for (size_t i = 0; i < n; ++i) {
+    T* element = slot(read_index + i);
+    vals[i] = std::move(*element);
+    element->~T();
+    bytes += recorded_bytes(read_index + i);
+  }
+  this->on_popped(n, bytes);
+  m_read_index.store(read_index + n, std::memory_order_release);
+  m_no_longer_full.notify_all();
+  return n;
+}
+
+template<class T>
+void
+SPSCRingQueue<T>::wake_waiters()
+{
+  m_no_longer_empty.notify_all();
+  m_no_longer_full.notify_all();
+}
+
+} // namespace dunedaq::appfwk
@@ -0,0 +1,439 @@
+#include "appfwk/RingStorage.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <thread>
+#include <typeinfo>
+
+namespace dunedaq::appfwk {
+
+namespace detail {
+/**
+ * @brief FNV-1a hash of a type's name, which processes built separately agree on
+ */
+inline uint64_t // NOLINT(build/unsigned)
+shared_type_hash(const std::type_info& type) noexcept
+{
+  uint64_t hash = 14695981039346656037ULL; // NOLINT(build/unsigned)
+  for (const char* c = type.name(); *c != '\0'; ++c) {
+    hash = (hash ^ static_cast<unsigned char>(*c)) * 1099511628211ULL;
+  }
+  return hash;
+}
+} // namespace detail
+
+template<class T>
+SharedMemoryQueue<T>::SharedMemoryQueue(const std::string& name,
+                                        size_t capacity,
+                                        WaitPolicy wait_policy,
+                                        const PageAllocation::Options& storage_options)
+  : Queue<T>(name)
+  , m_capacity(capacity)
+  , m_num_slots(detail::next_power_of_two(std::max(capacity, size_t(1))))
+  , m_mask(m_num_slots - 1)
+  , m_wait_policy(wait_policy)
+{
+  this->use_single_writer_counters();
+
+  // The last queue to detach from a segment marks it retired before it removes it; until then, the segment can still
+  // be mapped, and is mapped again once it is gone
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (!attach(storage_options)) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      throw SharedMemoryFailed(
+        ERS_HERE, segment_name(name), slots_offset() + m_num_slots * sizeof(T), "the segment is still being removed");
+    }
+    std::this_thread::yield();
+  }
+
+  // The queue may have been in use before this process attached to it
+  m_cached_read_index = m_header->read_index.load(std::memory_order_acquire);
+  m_cached_write_index = m_header->write_index.load(std::memory_order_acquire);
+}
+
+template<class T>
+bool
+SharedMemoryQueue<T>::attach(const PageAllocation::Options& storage_options)
+{
+  // Only the header is mapped until it is known to describe this queue, so that a segment made for another capacity
+  // or element type is reported as such rather than as being of another size
+  const size_t bytes = slots_offset() + m_num_slots * sizeof(T);
+  m_segment = std::make_unique<SharedMemorySegment>(segment_name(this->get_name()), bytes, sizeof(Header));
+  m_header = static_cast<Header*>(m_segment->data());
+
+  uint32_t state = s_uninitialised; // NOLINT(build/unsigned)
+  if (m_header->state.compare_exchange_strong(state, s_initialising, std::memory_order_acq_rel)) {
+    initialise_header();
+    map_slots(bytes, storage_options);
+    return true;
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (m_header->state.load(std::memory_order_acquire) != s_ready) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      throw SharedMemoryFailed(ERS_HERE,
+                               m_segment->name(),
+                               m_segment->size(),
+                               "the segment was not initialised in time; remove it if the process creating it died");
+    }
+    std::this_thread::yield();
+  }
+
+  uint32_t attached = m_header->attached.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  do {
+    if (attached == s_retired) {
+      m_segment.reset();
+      return false;
+    }
+  } while (!m_header->attached.compare_exchange_weak(attached, attached + 1, std::memory_order_acq_rel));
+
+  try {
+    check_header();
+  } catch (const SharedMemoryQueueMismatch&) {
+    detach();
+    throw;
+  }
+  map_slots(bytes, storage_options);
+  return true;
+}
+
+template<class T>
+void
+SharedMemoryQueue<T>::map_slots(size_t bytes, const PageAllocation::Options& storage_options)
+{
+  // Being attached keeps the segment from being removed in the meantime
+  std::unique_ptr<SharedMemorySegment> segment;
+  try {
+    segment = std::make_unique<SharedMemorySegment>(m_segment->name(), bytes, storage_options);
+  } catch (const SharedMemoryFailed&) {
+    detach();
+    throw;
+  }
+  m_segment = std::move(segment);
+  m_header = static_cast<Header*>(m_segment->data());
+  m_slots = static_cast<char*>(m_segment->data()) + slots_offset();
+}
+
+template<class T>
+void
+SharedMemoryQueue<T>::initialise_header()
+{
+  // Nobody else touches the header until the state is published as ready; the indices are zero-filled already
+  m_header->layout_version = s_layout_version;
+  m_header->element_size = sizeof(T);
+  m_header->element_type = detail::shared_type_hash(typeid(T));
+  m_header->num_slots = m_num_slots;
+  m_header->capacity = m_capacity;
+  new (&m_header->no_longer_empty) EventCount(true);
+  new (&m_header->no_longer_full) EventCount(true);
+  m_header->attached.store(1, std::memory_order_relaxed);
+  m_header->state.store(s_ready, std::memory_order_release);
+}
+
+template<class T>
+void
+SharedMemoryQueue<T>::check_header() const
+{
+  std::string reason;
+  if (m_header->layout_version != s_layout_version) {
+    reason = "it was created by another version of the framework";
+  } else if (m_header->element_size != sizeof(T) ||
+             m_header->element_type != detail::shared_type_hash(typeid(T))) {
+    reason = "it holds another element type";
+  } else if (m_header->capacity != m_capacity) {
+    reason = "it has a capacity of " + std::to_string(m_header->capacity) + " elements, not " +
+             std::to_string(m_capacity);
+  }
+  if (!reason.empty()) {
+    throw SharedMemoryQueueMismatch(ERS_HERE, this->get_name(), m_segment->name(), reason);
+  }
+}
+
+template<class T>
+void
+SharedMemoryQueue<T>::detach() noexcept
+{
+  uint32_t attached = m_header->attached.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  while (!m_header->attached.compare_exchange_weak(
+    attached, attached == 1 ? s_retired : attached - 1, std::memory_order_acq_rel)) {
+  }
+  if (attached == 1) {
+    // Without the slots mapped, the segment isn't known to hold elements of this queue's type
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      if (m_slots != nullptr) {
+        const index_t write_index = m_header->write_index.load(std::memory_order_acquire);
+        for (index_t i = m_header->read_index.load(std::memory_order_acquire); i != write_index; ++i) {
+          slot(i)->~T();
+        }
+      }
+    }
+    m_segment->unlink();
+  }
+  m_segment.reset();
+  m_header = nullptr;
+  m_slots = nullptr;
+}
+
+template<class T>
+SharedMemoryQueue<T>::~SharedMemoryQueue()
+{
+  detach();
+}
+
+template<class T>
+size_t
+SharedMemoryQueue<T>::get_page_size() const
+{
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+template<class T>
+size_t
+SharedMemoryQueue<T>::get_num_elements() const noexcept
+{
+  // As in SPSCRingQueue, loading the read index first keeps the difference from going negative
+  const index_t read_index = m_header->read_index.load(std::memory_order_acquire);
+  const index_t write_index = m_header->write_index.load(std::memory_order_acquire);
+  return std::min(static_cast<size_t>(write_index - read_index), m_capacity);
+}
+
+template<class T>
+size_t
+SharedMemoryQueue<T>::free_slots(index_t write_index) const noexcept
+{
+  const index_t occupancy = write_index - m_cached_read_index;
+  return occupancy < m_capacity ? m_capacity - static_cast<size_t>(occupancy) : 0;
+}
+
+template<class T>
+size_t
+SharedMemoryQueue<T>::wait_for_space(index_t write_index, const duration_t& timeout)
+{
+  auto space = [&]() {
+    m_cached_read_index = m_header->read_index.load(std::memory_order_acquire);
+    return free_slots(write_index);
+  };
+
+  if (size_t n = space(); n > 0 || timeout.count() <= 0) {
+    return n;
+  }
+
+  // The producer is now blocked; the clock is only read on this path
+  const auto start_time = std::chrono::steady_clock::now();
+  auto blocked_for = [&](size_t n) {
+    this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
+    return n;
+  };
+
+  // Closing the queue ends the wait, and then there is no space to push to
+  auto ready = [&]() { return space() > 0 || this->closed(); };
+  const auto deadline = start_time + timeout;
+  wait_until(m_wait_policy, m_header->no_longer_full, ready, deadline);
+  return blocked_for(this->closed() ? 0 : space());
+}
+
+template<class T>
+size_t
+SharedMemoryQueue<T>::wait_for_data(index_t read_index, const duration_t& timeout)
+{
+  auto available = [&]() {
+    m_cached_write_index = m_header->write_index.load(std::memory_order_acquire);
+    return static_cast<size_t>(m_cached_write_index - read_index);
+  };
+
+  if (size_t n = available(); n > 0 || timeout.count() <= 0) {
+    return n;
+  }
+
+  // Closing the queue ends the wait; elements pushed before it are still returned
+  auto ready = [&]() { return available() > 0 || this->closed(); };
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  wait_until(m_wait_policy, m_header->no_longer_empty, ready, deadline);
+  return available();
+}
+
+template<class T>
+bool
+SharedMemoryQueue<T>::try_push(value_t&& object_to_push, const duration_t& timeout)
+{
+  if (this->closed()) {
+    return false;
+  }
+
+  const index_t write_index = m_header->write_index.load(std::memory_order_relaxed);
+
+  if (free_slots(write_index) == 0 && wait_for_space(write_index, timeout) == 0) {
+    this->on_push_timeout();
+    return false;
+  }
+
+  new (raw_slot(write_index)) T(std::move(object_to_push));
+  this->on_pushed(1, 0);
+  m_header->write_index.store(write_index + 1, std::memory_order_release);
+  m_header->no_longer_empty.notify_all();
+  this->on_readable();
+  return true;
+}
+
+template<class T>
+bool
+SharedMemoryQueue<T>::try_pop(T& val, const duration_t& timeout)
+{
+  const index_t read_index = m_header->read_index.load(std::memory_order_relaxed);
+
+  if (read_index == m_cached_write_index && wait_for_data(read_index, timeout) == 0) {
+    this->on_pop_timeout();
+    return false;
+  }
+
+  T* element = slot(read_index);
+  val = std::move(*element);
+  element->~T();
+  this->on_popped(1, 0);
+  m_header->read_index.store(read_index + 1, std::memory_order_release);
+  m_header->no_longer_full.notify_all();
+  return true;
+}
+
+template<class T>
+void*
+SharedMemoryQueue<T>::try_reserve_slot(const duration_t& timeout)
+{
+  if (this->closed()) {
+    return nullptr;
+  }
+
+  const index_t write_index = m_header->write_index.load(std::memory_order_relaxed);
+
+  if (free_slots(write_index) == 0 && wait_for_space(write_index, timeout) == 0) {
+    this->on_push_timeout();
+    return nullptr;
+  }
+  return raw_slot(write_index);
+}
+
+template<class T>
+void
+SharedMemoryQueue<T>::commit_slot()
+{
+  this->on_pushed(1, 0);
+  m_header->write_index.store(m_header->write_index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  m_header->no_longer_empty.notify_all();
+  this->on_readable();
+}
+
+template<class T>
+T*
+SharedMemoryQueue<T>::try_peek(const duration_t& timeout)
+{
+  const index_t read_index = m_header->read_index.load(std::memory_order_relaxed);
+
+  if (read_index == m_cached_write_index && wait_for_data(read_index, timeout) == 0) {
+    this->on_pop_timeout();
+    return nullptr;
+  }
+  return slot(read_index);
+}
+
+template<class T>
+void
+SharedMemoryQueue<T>::release_peeked()
+{
+  const index_t read_index = m_header->read_index.load(std::memory_order_relaxed);
+  slot(read_index)->~T();
+  this->on_popped(1, 0);
+  m_header->read_index.store(read_index + 1, std::memory_order_release);
+  m_header->no_longer_full.notify_all();
+}
+
+template<class T>
+size_t
+SharedMemoryQueue<T>::push_n(value_t* vals, size_t count, const duration_t& timeout)
+{
+  if (count == 0) {
+    return 0;
+  }
+  if (this->closed()) {
+    this->throw_failed("push", timeout);
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  index_t write_index = m_header->write_index.load(std::memory_order_relaxed);
+  size_t pushed = 0;
+
+  while (pushed < count) {
+    size_t space = free_slots(write_index);
+    if (space == 0) {
+      auto remaining = std::chrono::duration_cast<duration_t>(deadline - std::chrono::steady_clock::now());
+      space = wait_for_space(write_index, std::max(remaining, duration_t::zero()));
+      if (space == 0) {
+        break;
+      }
+    }
+
+    const size_t n = std::min(space, count - pushed);
+    for (size_t i = 0; i < n; ++i) {
+      new (raw_slot(write_index + i)) T(std::move(vals[pushed + i]));
+    }
+    write_index += n;
+    pushed += n;
+    this->on_pushed(n, 0);
+    m_header->write_index.store(write_index, std::memory_order_release);
+    m_header->no_longer_empty.notify_all();
+    this->on_readable();
+  }
+
+  if (pushed < count) {
+    this->on_push_timeout();
+  }
+  if (pushed == 0) {
+    this->throw_failed("push", timeout);
+  }
+  return pushed;
+}
+
+template<class T>
+size_t
+SharedMemoryQueue<T>::pop_n(value_t* vals, size_t max_count, const duration_t& timeout)
+{
+  if (max_count == 0) {
+    return 0;
+  }
+
+  const index_t read_index = m_header->read_index.load(std::memory_order_relaxed);
+  size_t available = static_cast<size_t>(m_cached_write_index - read_index);
+  if (available < max_count) {
+    // Refresh the cached write index so we take everything that is there, waiting only if there is nothing
+    available = wait_for_data(read_index, available == 0 ? timeout : duration_t::zero());
+  }
+
+  if (available == 0) {
+    this->on_pop_timeout();
+    this->throw_failed("pop", timeout);
+  }
+
+  const size_t n = std::min(available, max_count);
+  for (size_t i = 0; i < n; ++i) {
+    T* element = slot(read_index + i);
+    vals[i] = std::move(*element);
+    element->~T();
+  }
+  this->on_popped(n, 0);
+  m_header->read_index.store(read_index + n, std::memory_order_release);
+  m_header->no_longer_full.notify_all();
+  return n;
+}
+
+template<class T>
+void
+SharedMemoryQueue<T>::wake_waiters()
+{
+  // Only threads of this process test this process's closed flag, but waking the others does no harm
+  m_header->no_longer_empty.notify_all();
+  m_header->no_longer_full.notify_all();
+}
+
+} // namespace dunedaq::appfwk
@@ -1,103 +1,347 @@
 
 #include "ers/ers.hpp"
 
+#include <algorithm>
+#include <new>
+
 namespace dunedaq::appfwk {
 
 template<class T>
-StdDeQueue<T>::StdDeQueue(const std::string& name, size_t capacity)
+StdDeQueue<T>::StdDeQueue(const std::string& name,
+                          size_t capacity,
+                          WaitPolicy wait_policy,
+                          const PageAllocation::Options& storage_options)
   : Queue<T>(name)
-  , m_deque()
   , m_capacity(capacity)
+  , m_storage_options(storage_options)
+  , m_storage(std::make_unique<RingStorage<value_t>>(capacity, storage_options))
   , m_size(0)
+  , m_wait_policy(wait_policy)
+{
+  this->use_single_writer_counters();
+}
+
+template<class T>
+StdDeQueue<T>::~StdDeQueue()
+{
+  const size_t size = m_size.load(std::memory_order_acquire);
+  for (size_t i = 0; i < size; ++i) {
+    m_storage->slot(slot_index(i))->~T();
+  }
+}
+
+template<class T>
+bool
+StdDeQueue<T>::resize(size_t capacity)
+{
+  if (capacity == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> resize_lk(m_resize_mutex);
+
+  PageAllocation::Options storage_options;
+  {
+    std::lock_guard<std::timed_mutex> lk(m_mutex);
+    storage_options = m_storage_options;
+  }
+
+  // Allocate (and prefault, if so configured) outside the mutex, so that producers and consumers aren't held up
+  auto storage = std::make_unique<RingStorage<value_t>>(capacity, storage_options);
+
+  {
+    std::lock_guard<std::timed_mutex> lk(m_mutex);
+    const size_t size = m_size.load(std::memory_order_relaxed);
+    if (size > capacity) {
+      return false;
+    }
+    for (size_t i = 0; i < size; ++i) {
+      T* element = m_storage->slot(slot_index(i));
+      new (storage->raw_slot(i)) T(std::move(*element));
+      element->~T();
+    }
+    m_head = 0;
+    m_storage.swap(storage);
+    m_capacity.store(capacity, std::memory_order_relaxed);
+    m_no_longer_full.notify_all();
+  }
+
+  // The old storage is released here, outside the mutex
+  return true;
+}
+
+template<class T>
+size_t
+StdDeQueue<T>::get_page_size() const
 {
-  assert(m_deque.max_size() > this->get_capacity());
+  std::lock_guard<std::timed_mutex> lk(m_mutex);
+  return m_storage->page_size();
+}
+
+template<class T>
+int
+StdDeQueue<T>::get_numa_node() const
+{
+  std::lock_guard<std::timed_mutex> lk(m_mutex);
+  return m_storage->numa_node();
 }
 
 template<class T>
 void
-StdDeQueue<T>::push(value_t&& object_to_push, const duration_t& timeout)
+StdDeQueue<T>::move_storage_to_numa_node(int numa_node)
+{
+  // Only resize() replaces the storage, so holding its mutex keeps the storage in place while the pages move,
+  // without holding up producers and consumers
+  std::lock_guard<std::mutex> resize_lk(m_resize_mutex);
+  {
+    // Storage allocated by a later resize() goes to the same node
+    std::lock_guard<std::timed_mutex> lk(m_mutex);
+    m_storage_options.numa_node = numa_node;
+  }
+  m_storage->bind_to_numa_node(numa_node);
+}
+
+template<class T>
+bool
+StdDeQueue<T>::try_push(value_t&& object_to_push, const duration_t& timeout)
 {
 
+  if (this->closed()) {
+    return false;
+  }
+
   auto start_time = std::chrono::steady_clock::now();
-  std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+  auto deadline = start_time + timeout;
+  std::unique_lock<std::timed_mutex> lk(m_mutex, std::defer_lock);
 
-  this->try_lock_for(lk, timeout);
+  // Anything other than getting the lock straight away and finding space counts as being blocked
+  bool blocked = !lk.try_lock();
+  if (blocked && !this->lock_until(lk, deadline)) {
+    this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
+    this->on_push_timeout();
+    return false;
+  }
 
-  auto time_to_wait_for_space = (start_time + timeout) - std::chrono::steady_clock::now();
+  if (!this->can_push()) {
+    blocked = true;
+    this->wait_until(lk, m_no_longer_full, [&]() { return this->can_push() || this->closed(); }, deadline);
+  }
 
-  if (time_to_wait_for_space.count() > 0) {
-    m_no_longer_full.wait_for(lk, time_to_wait_for_space, [&]() { return this->can_push(); });
+  if (blocked) {
+    this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
   }
 
-  if (this->can_push()) {
-    m_deque.push_back(std::move(object_to_push));
-    m_size++;
-    m_no_longer_empty.notify_one();
-  } else {
-    throw QueueTimeoutExpired(
-      ERS_HERE, this->get_name(), "push", std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+  if (!lk.owns_lock() || !this->can_push() || this->closed()) {
+    this->on_push_timeout();
+    return false;
   }
+
+  T* element =
+    new (m_storage->raw_slot(slot_index(m_size.load(std::memory_order_relaxed)))) T(std::move(object_to_push));
+  m_size++;
+  this->on_pushed(1, payload_bytes(*element));
+  m_no_longer_empty.notify_one();
+  this->on_readable();
+  return true;
 }
 
 template<class T>
-void
-StdDeQueue<T>::pop(T& val, const duration_t& timeout)
+bool
+StdDeQueue<T>::try_pop(T& val, const duration_t& timeout)
 {
 
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  std::unique_lock<std::timed_mutex> lk(m_mutex, std::defer_lock);
+
+  if (!lk.try_lock() && !this->lock_until(lk, deadline)) {
+    this->on_pop_timeout();
+    return false;
+  }
+
+  if (!this->wait_until(lk, m_no_longer_empty, [&]() { return this->can_pop() || this->closed(); }, deadline) ||
+      !this->can_pop()) {
+    this->on_pop_timeout();
+    return false;
+  }
+
+  T* element = m_storage->slot(m_head);
+  val = std::move(*element);
+  element->~T();
+  m_head = slot_index(1);
+  m_size--;
+  this->on_popped(1, payload_bytes(val));
+  m_no_longer_full.notify_one();
+  return true;
+}
+
+template<class T>
+size_t
+StdDeQueue<T>::push_n(value_t* vals, size_t count, const duration_t& timeout)
+{
+  if (count == 0) {
+    return 0;
+  }
+  if (this->closed()) {
+    this->throw_failed("push", timeout);
+  }
+
   auto start_time = std::chrono::steady_clock::now();
-  std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+  auto deadline = start_time + timeout;
+  std::unique_lock<std::timed_mutex> lk(m_mutex, std::defer_lock);
+
+  bool blocked = !lk.try_lock();
+  bool locked = !blocked || this->lock_until(lk, deadline);
 
-  this->try_lock_for(lk, timeout);
+  size_t pushed = 0;
+  while (locked && pushed < count) {
+    if (!this->can_push()) {
+      blocked = true;
+      if (!this->wait_until(lk, m_no_longer_full, [&]() { return this->can_push() || this->closed(); }, deadline) ||
+          this->closed()) {
+        break;
+      }
+    }
 
-  auto time_to_wait_for_data = (start_time + timeout) - std::chrono::steady_clock::now();
+    const size_t size = m_size.load(std::memory_order_relaxed);
+    size_t n = std::min(count - pushed, m_capacity.load(std::memory_order_relaxed) - size);
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; ++i) {
+      bytes += payload_bytes(*new (m_storage->raw_slot(slot_index(size + i))) T(std::move(vals[pushed + i])));
+    }
+    pushed += n;
+    m_size += n;
+    this->on_pushed(n, bytes);
 
-  if (time_to_wait_for_data.count() > 0) {
-    m_no_longer_empty.wait_for(lk, time_to_wait_for_data, [&]() { return this->can_pop(); });
+    // More than one element may satisfy more than one waiting consumer
+    if (n == 1) {
+      m_no_longer_empty.notify_one();
+    } else {
+      m_no_longer_empty.notify_all();
+    }
+    this->on_readable();
   }
 
-  if (this->can_pop()) {
-    val = std::move(m_deque.front());
-    m_size--;
-    m_deque.pop_front();
+  if (blocked) {
+    this->on_push_blocked(std::chrono::steady_clock::now() - start_time);
+  }
+  if (pushed < count) {
+    this->on_push_timeout();
+  }
+
+  if (pushed == 0) {
+    this->throw_failed("push", timeout);
+  }
+  return pushed;
+}
+
+template<class T>
+size_t
+StdDeQueue<T>::pop_n(value_t* vals, size_t max_count, const duration_t& timeout)
+{
+  if (max_count == 0) {
+    return 0;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  std::unique_lock<std::timed_mutex> lk(m_mutex, std::defer_lock);
+
+  bool locked = lk.try_lock() || this->lock_until(lk, deadline);
+
+  if (!locked ||
+      !this->wait_until(lk, m_no_longer_empty, [&]() { return this->can_pop() || this->closed(); }, deadline) ||
+      !this->can_pop()) {
+    this->on_pop_timeout();
+    this->throw_failed("pop", timeout);
+  }
+
+  size_t n = std::min(max_count, m_size.load(std::memory_order_relaxed));
+  size_t bytes = 0;
+  for (size_t i = 0; i < n; ++i) {
+    T* element = m_storage->slot(m_head);
+    vals[i] = std::move(*element);
+    element->~T();
+    m_head = slot_index(1);
+    bytes += payload_bytes(vals[i]);
+  }
+  m_size -= n;
+  this->on_popped(n, bytes);
+
+  if (n == 1) {
     m_no_longer_full.notify_one();
   } else {
-    throw QueueTimeoutExpired(
-      ERS_HERE, this->get_name(), "pop", std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+    m_no_longer_full.notify_all();
   }
+  return n;
 }
 
-// This try_lock_for() function was written because while objects of
-// type std::timed_mutex have their own try_lock_for functions, the
-// std::condition_variable::wait_for functions used in this class's push
-// and pop operations require an std::mutex
+// Notifying with the mutex held, after close() set the flag, means that a
+// thread can't test the flag, find it clear, and only then start waiting on
+// the condition variable, missing the notification
 
 template<class T>
 void
-StdDeQueue<T>::try_lock_for(std::unique_lock<std::mutex>& lk, const duration_t& timeout)
+StdDeQueue<T>::wake_waiters()
+{
+  std::lock_guard<std::timed_mutex> lk(m_mutex);
+  m_no_longer_empty.notify_all();
+  m_no_longer_full.notify_all();
+}
+
+// Called when the mutex wasn't free straight away. Once a policy which parks
+// has finished busy-waiting for it, the thread sleeps on the mutex until the
+// deadline.
+
+template<class T>
+bool
+StdDeQueue<T>::lock_until(std::unique_lock<std::timed_mutex>& lk, std::chrono::steady_clock::time_point deadline)
 {
   assert(!lk.owns_lock());
 
-  auto start_time = std::chrono::steady_clock::now();
-  lk.try_lock();
+  if (spin_until(m_wait_policy, [&]() { return lk.try_lock(); }, deadline)) {
+    return true;
+  }
+  if (!parks(m_wait_policy)) {
+    return false;
+  }
+  return lk.try_lock_until(deadline);
+}
 
-  if (!lk.owns_lock() && timeout.count() > 0) {
+// With the mutex held, wait until condition() holds or the deadline passes,
+// and return with the mutex held. The spinning policies busy-wait with the
+// mutex released, which they can do because the conditions only read the
+// atomic element count, and only the parking policies sleep on the condition
+// variable. Re-taking the mutex after spinning is bounded by the deadline
+// too, so wait_until() returns false without the mutex if it is still taken
+// then.
 
-    int approximate_number_of_retries = 5;
-    duration_t pause_between_tries = duration_t(timeout.count() / approximate_number_of_retries);
+template<class T>
+template<typename Condition>
+bool
+StdDeQueue<T>::wait_until(std::unique_lock<std::timed_mutex>& lk,
+                          TimedMutexCondition& cv,
+                          Condition condition,
+                          std::chrono::steady_clock::time_point deadline)
+{
+  assert(lk.owns_lock());
 
-    while (std::chrono::steady_clock::now() < start_time + timeout) {
-      std::this_thread::sleep_for(pause_between_tries);
-      lk.try_lock();
-      if (lk.owns_lock()) {
-        break;
-      }
-    }
+  if (condition()) {
+    return true;
+  }
+  if (std::chrono::steady_clock::now() >= deadline) {
+    return false;
   }
 
-  if (!lk.owns_lock()) {
-    throw QueueTimeoutExpired(
-      ERS_HERE, this->get_name(), "lock mutex", std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+  if (m_wait_policy != WaitPolicy::kBlock) {
+    lk.unlock();
+    spin_until(m_wait_policy, condition, deadline);
+    if (!lock_until(lk, deadline)) {
+      return false;
+    }
+    if (condition() || !parks(m_wait_policy)) {
+      return condition();
+    }
   }
+
+  return cv.wait_until(lk, deadline, condition);
 }
 
 } // namespace dunedaq::appfwk
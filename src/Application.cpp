@@ -9,6 +9,7 @@
 #include "appfwk/Application.hpp"
 
 #include "appfwk/Issues.hpp"
+#include "appfwk/QueueRegistry.hpp"
 #include "appfwk/appinfo/InfoNljs.hpp"
 #include "appfwk/cmd/Nljs.hpp"
 #include "rcif/cmd/Nljs.hpp"
@@ -137,6 +138,15 @@ Application::gather_stats(opmonlib::InfoCollector& ci, int level)
     // give only generic application info
   } else if (ai.state == "CONFIGURED" || ai.state == "RUNNING") {
     try {
+      // Before the queues report, which resets their high-water marks
+      const MemoryUsage usage = QueueRegistry::get().get_memory_usage();
+      appinfo::Memory memory;
+      memory.queue_bytes = usage.queue_bytes;
+      memory.queue_bytes_high_water = usage.queue_bytes_high_water;
+      memory.queue_capacity_bytes = usage.queue_capacity_bytes;
+      memory.unlimited_queues = usage.unlimited_queues;
+      tmp_ci.add(memory);
+
       m_mod_mgr.gather_stats(tmp_ci, level);
     } catch (ers::Issue& ex) {
       ers::error(ex);
@@ -19,15 +19,49 @@
 
 #include "logging/Logging.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <map>
+#include <mutex>
 #include <regex>
+#include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 namespace dunedaq {
 namespace appfwk {
 
+namespace {
+
+PageAllocation::HugePages
+to_huge_pages(app::HugePages huge_pages)
+{
+  switch (huge_pages) {
+    case app::HugePages::Explicit:
+      return PageAllocation::HugePages::kExplicit;
+    case app::HugePages::Transparent:
+      return PageAllocation::HugePages::kTransparent;
+    default:
+      return PageAllocation::HugePages::kNone;
+  }
+}
+
+// The number of endpoints, across all modules, which are on the named queue
+size_t
+count_endpoints(const std::map<std::string, std::vector<std::string>>& module_queues, const std::string& queue_name)
+{
+  size_t count = 0;
+  for (const auto& [mod_name, queues] : module_queues) {
+    count += std::count(queues.begin(), queues.end(), queue_name);
+  }
+  return count;
+}
+
+} // namespace ""
+
 DAQModuleManager::DAQModuleManager()
   : m_initialized(false)
 {}
@@ -36,8 +70,14 @@ void
 DAQModuleManager::initialize(const dataobj_t& data)
 {
   auto ini = data.get<app::Init>();
-  init_queues(ini.queues);
+  read_queue_endpoints(ini.modules);
+  init_queues(ini.queues, ini.pools);
   init_modules(ini.modules);
+  rank_modules_by_data_flow();
+  m_dispatch_threads = ini.dispatch_threads;
+  for (const auto& co : ini.command_orders) {
+    m_dispatch_orders[co.cmd] = co.order;
+  }
   this->m_initialized = true;
 }
 
@@ -53,7 +93,80 @@ DAQModuleManager::init_modules(const app::ModSpecs& mspecs)
 }
 
 void
-DAQModuleManager::init_queues(const app::QueueSpecs& qspecs)
+DAQModuleManager::read_queue_endpoints(const app::ModSpecs& mspecs)
+{
+  // Modules which follow the ModInit convention say which queues they read and write
+  for (const auto& mspec : mspecs) {
+    if (mspec.data.is_object() && mspec.data.count("qinfos")) {
+      for (const auto& qi : mspec.data.get<app::ModInit>().qinfos) {
+        auto& queues = qi.dir == "input" ? m_module_inputs[mspec.inst] : m_module_outputs[mspec.inst];
+        queues.push_back(qi.inst);
+      }
+    }
+  }
+}
+
+void
+DAQModuleManager::rank_modules_by_data_flow()
+{
+  // Order the modules so that every module comes after the modules which
+  // feed its input queues (Kahn's algorithm). Modules in a cycle, which
+  // have no such order, go last, by name. Each module's wave is one more
+  // than the latest of the modules feeding it, so that the modules in a
+  // wave only depend on those in earlier waves; modules in a cycle get a
+  // wave each.
+  std::map<std::string, std::set<std::string>> producers_of;
+  for (const auto& [mod_name, queues] : m_module_outputs) {
+    for (const auto& queue : queues) {
+      producers_of[queue].insert(mod_name);
+    }
+  }
+
+  std::map<std::string, std::set<std::string>> downstream;
+  std::map<std::string, size_t> num_upstream;
+  for (const auto& [mod_name, mod_ptr] : m_module_map) {
+    num_upstream[mod_name];
+  }
+  for (const auto& [mod_name, queues] : m_module_inputs) {
+    for (const auto& queue : queues) {
+      for (const auto& producer : producers_of[queue]) {
+        if (producer != mod_name && downstream[producer].insert(mod_name).second) {
+          ++num_upstream[mod_name];
+        }
+      }
+    }
+  }
+
+  std::vector<std::string> ready;
+  for (const auto& [mod_name, count] : num_upstream) {
+    if (count == 0) {
+      ready.push_back(mod_name);
+    }
+  }
+  m_module_rank.clear();
+  m_module_wave.clear();
+  size_t num_waves = 0;
+  for (size_t i = 0; i < ready.size(); ++i) {
+    m_module_rank[ready[i]] = i;
+    const size_t wave = m_module_wave[ready[i]];
+    num_waves = std::max(num_waves, wave + 1);
+    for (const auto& consumer : downstream[ready[i]]) {
+      m_module_wave[consumer] = std::max(m_module_wave[consumer], wave + 1);
+      if (--num_upstream[consumer] == 0) {
+        ready.push_back(consumer);
+      }
+    }
+  }
+  for (const auto& [mod_name, count] : num_upstream) {
+    if (count > 0) {
+      m_module_rank.emplace(mod_name, m_module_rank.size());
+      m_module_wave[mod_name] = num_waves++;
+    }
+  }
+}
+
+void
+DAQModuleManager::init_queues(const app::QueueSpecs& qspecs, const app::PoolSpecs& pspecs)
 {
   std::map<std::string, QueueConfig> queue_cfgs;
   for (const auto& qs : qspecs) {
@@ -75,15 +188,114 @@ DAQModuleManager::init_queues(const app::QueueSpecs& qspecs)
       case app::QueueKind::FollyMPMCQueue:
         qc.kind = QueueConfig::queue_kind::kFollyMPMCQueue;
         break;
+      case app::QueueKind::SPSCRingQueue:
+        qc.kind = QueueConfig::queue_kind::kSPSCRingQueue;
+        break;
+      case app::QueueKind::BroadcastQueue:
+        qc.kind = QueueConfig::queue_kind::kBroadcastQueue;
+        break;
+      case app::QueueKind::PriorityQueue:
+        qc.kind = QueueConfig::queue_kind::kPriorityQueue;
+        break;
+      case app::QueueKind::SharedMemoryQueue:
+        qc.kind = QueueConfig::queue_kind::kSharedMemoryQueue;
+        break;
+      case app::QueueKind::ElasticQueue:
+        qc.kind = QueueConfig::queue_kind::kElasticQueue;
+        break;
+      case app::QueueKind::Auto:
+        break; // Chosen below, once the rest of the configuration is known
       default:
         throw MissingComponent(ERS_HERE, "unknown queue type");
         break;
     }
     qc.capacity = qs.capacity;
+    qc.dwell_time = qs.dwell_time;
+    qc.prefault = qs.prefault;
+    qc.huge_pages = to_huge_pages(qs.huge_pages);
+    qc.lock_memory = qs.lock_memory;
+    qc.numa_node = qs.numa_node;
+    qc.follow_consumer = qs.follow_consumer;
+    qc.slow_consumer_policy =
+      qs.slow_consumer == app::SlowConsumerPolicy::Drop ? SlowConsumerPolicy::kDrop : SlowConsumerPolicy::kBlock;
+    qc.priority_lanes = qs.priority_lanes;
+    qc.max_bytes = qs.max_bytes;
+    qc.idle_ms = qs.idle_ms;
+    qc.capacity_bytes = qs.capacity_bytes;
+    qc.credits = qs.credits;
+    switch (qs.wait_policy) {
+      case app::WaitPolicy::Default:
+        break; // Left to the kind of queue
+      case app::WaitPolicy::Block:
+        qc.wait_policy = WaitPolicy::kBlock;
+        break;
+      case app::WaitPolicy::Spin:
+        qc.wait_policy = WaitPolicy::kSpin;
+        break;
+      case app::WaitPolicy::SpinYield:
+        qc.wait_policy = WaitPolicy::kSpinYield;
+        break;
+      case app::WaitPolicy::SpinPark:
+        qc.wait_policy = WaitPolicy::kSpinPark;
+        break;
+    }
+
+    // Endpoints are only known for the modules which declare them, so a count of 0 means "unknown"
+    const size_t producers = count_endpoints(m_module_outputs, queue_name);
+    const size_t consumers = count_endpoints(m_module_inputs, queue_name);
+    if (qs.kind == app::QueueKind::Auto) {
+      qc.kind = QueueConfig::select_kind(producers, consumers, qc);
+      TLOG() << "Queue " << queue_name << " has " << producers << " producers and " << consumers
+             << " consumers declared, using a " << QueueConfig::qktos(qc.kind);
+    } else if (qc.kind == QueueConfig::queue_kind::kBroadcastQueue && producers > 1) {
+      // Every consumer of a broadcast queue sees every element, but there can only be one producer
+      throw QueueTopologyUnsupported(
+        ERS_HERE, queue_name, QueueConfig::qktos(qc.kind), producers, consumers, "one producer");
+    } else if ((qc.kind == QueueConfig::queue_kind::kFollySPSCQueue ||
+                qc.kind == QueueConfig::queue_kind::kSPSCRingQueue ||
+                qc.kind == QueueConfig::queue_kind::kSharedMemoryQueue) &&
+               (producers > 1 || consumers > 1)) {
+      throw QueueTopologyUnsupported(
+        ERS_HERE, queue_name, QueueConfig::qktos(qc.kind), producers, consumers, "one of each");
+    }
     queue_cfgs[queue_name] = qc;
     TLOG_DEBUG(2) << "Adding queue: " << queue_name;
   }
-  QueueRegistry::get().configure(queue_cfgs);
+
+  std::map<std::string, PoolConfig> pool_cfgs;
+  for (const auto& ps : pspecs) {
+    PoolConfig pc;
+    pc.count = ps.count;
+    pc.slab_size = ps.slab_size;
+    pc.numa_node = ps.numa_node;
+    pc.prefault = ps.prefault;
+    pc.huge_pages = to_huge_pages(ps.huge_pages);
+    pc.lock_memory = ps.lock_memory;
+    pool_cfgs[ps.inst] = pc;
+    TLOG_DEBUG(2) << "Adding pool: " << ps.inst;
+  }
+
+  QueueRegistry::get().configure(queue_cfgs, pool_cfgs);
+}
+
+void
+DAQModuleManager::resize_queues(const app::QueueResizes& resizes)
+{
+  std::string failed_queue_names("");
+  for (const auto& qr : resizes) {
+    TLOG_DEBUG(2) << "Resizing queue " << qr.inst << " to " << qr.capacity << " elements";
+    try {
+      QueueRegistry::get().resize_queue(qr.inst, qr.capacity);
+    } catch (ers::Issue& ex) {
+      ers::error(ex);
+      failed_queue_names.append(qr.inst);
+      failed_queue_names.append(", ");
+    }
+  }
+
+  if (!failed_queue_names.empty()) {
+    throw CommandDispatchingFailed(ERS_HERE, "resize", failed_queue_names);
+  }
 }
 
 void
@@ -208,20 +420,52 @@ DAQModuleManager::dispatch_one_match_only(cmdlib::cmd::CmdId id, const dataobj_t
     mod_seq.emplace_back(cmd_mod_names, &dummy);
   }
 
+  DispatchSeq_t dispatch_seq;
+  for (auto& [mod_names, data_ptr] : mod_seq) {
+    for (auto& mod_name : mod_names) {
+      dispatch_seq.emplace_back(mod_name, data_ptr);
+    }
+  }
+
+  if (m_dispatch_threads > 0 && get_dispatch_order(id) != app::DispatchOrder::Serial) {
+    dispatch_in_parallel(id, dispatch_seq, get_dispatch_order(id));
+  } else {
+    dispatch_serially(id, dispatch_seq);
+  }
+}
+
+void
+DAQModuleManager::dispatch_serially(cmdlib::cmd::CmdId id, DispatchSeq_t& dispatch_seq)
+{
+  // At stop, modules are stopped in data flow order, and each module's input
+  // queues are closed just before it is stopped: the modules upstream have
+  // stopped pushing by then, so its threads empty the queues and then return
+  // from pop straight away instead of waiting for their timeout
+  const bool stopping = id == "stop";
+  if (stopping) {
+    std::stable_sort(dispatch_seq.begin(), dispatch_seq.end(), [&](const auto& a, const auto& b) {
+      return m_module_rank.at(a.first) < m_module_rank.at(b.first);
+    });
+  }
+
   std::string failed_mod_names("");
 
   // All sorted, execute!
-  for (auto& [mod_names, data_ptr] : mod_seq) {
-    for (auto& mod_name : mod_names) {
-      try {
-        TLOG_DEBUG(2) << "Executing " << id << " -> " << mod_name;
-        m_module_map[mod_name]->execute_command(id, *data_ptr);
-      } catch (ers::Issue& ex) {
-        ers::error(ex);
-        failed_mod_names.append(mod_name);
-        failed_mod_names.append(", ");
+  for (auto& [mod_name, data_ptr] : dispatch_seq) {
+    if (stopping) {
+      for (const auto& queue : m_module_inputs[mod_name]) {
+        TLOG_DEBUG(2) << "Closing " << queue << " before stopping " << mod_name;
+        QueueRegistry::get().close_queue(queue);
       }
     }
+    try {
+      TLOG_DEBUG(2) << "Executing " << id << " -> " << mod_name;
+      m_module_map[mod_name]->execute_command(id, *data_ptr);
+    } catch (ers::Issue& ex) {
+      ers::error(ex);
+      failed_mod_names.append(mod_name);
+      failed_mod_names.append(", ");
+    }
   }
 
   // Throw if any dispatching failed
@@ -230,6 +474,111 @@ DAQModuleManager::dispatch_one_match_only(cmdlib::cmd::CmdId id, const dataobj_t
   }
 }
 
+void
+DAQModuleManager::dispatch_in_parallel(cmdlib::cmd::CmdId id,
+                                       const DispatchSeq_t& dispatch_seq,
+                                       app::DispatchOrder order)
+{
+  // Group the modules into waves, which are executed one after the other, each on up to m_dispatch_threads modules
+  // at a time. A module which is matched more than once is executed with each of its parameters in turn, by one thread.
+  std::map<size_t, std::map<std::string, std::vector<const dataobj_t*>>> waves;
+  for (const auto& [mod_name, data_ptr] : dispatch_seq) {
+    const size_t wave = order == app::DispatchOrder::Parallel ? 0 : m_module_wave.at(mod_name);
+    waves[wave][mod_name].push_back(data_ptr);
+  }
+  std::vector<std::vector<std::pair<std::string, std::vector<const dataobj_t*>>>> dispatch_waves;
+  for (const auto& [wave, modules] : waves) {
+    dispatch_waves.emplace_back(modules.begin(), modules.end());
+  }
+  if (order == app::DispatchOrder::ReverseDataFlow) {
+    std::reverse(dispatch_waves.begin(), dispatch_waves.end());
+  }
+
+  // As when dispatching serially, each module's input queues are closed just before it is stopped
+  const bool stopping = id == "stop";
+
+  std::mutex failures_mutex;
+  std::set<std::string> failed_modules;
+  std::exception_ptr unexpected;
+
+  for (const auto& wave : dispatch_waves) {
+    if (stopping) {
+      for (const auto& [mod_name, params] : wave) {
+        for (const auto& queue : m_module_inputs[mod_name]) {
+          TLOG_DEBUG(2) << "Closing " << queue << " before stopping " << mod_name;
+          QueueRegistry::get().close_queue(queue);
+        }
+      }
+    }
+
+    std::atomic<size_t> next{ 0 };
+    auto execute_modules = [&]() {
+      for (size_t i = next++; i < wave.size(); i = next++) {
+        const auto& [mod_name, params] = wave[i];
+        for (const auto* data_ptr : params) {
+          try {
+            TLOG_DEBUG(2) << "Executing " << id << " -> " << mod_name;
+            m_module_map.at(mod_name)->execute_command(id, *data_ptr);
+          } catch (ers::Issue& ex) {
+            ers::error(ex);
+            std::lock_guard<std::mutex> lock(failures_mutex);
+            failed_modules.insert(mod_name);
+          } catch (...) {
+            // Anything else would have left dispatch_serially, so it leaves here too, once the wave is done
+            std::lock_guard<std::mutex> lock(failures_mutex);
+            if (!unexpected) {
+              unexpected = std::current_exception();
+            }
+          }
+        }
+      }
+    };
+
+    // The thread dispatching the command is one of the threads executing it
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(m_dispatch_threads, wave.size()); ++i) {
+      threads.emplace_back(execute_modules);
+    }
+    execute_modules();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    if (unexpected) {
+      std::rethrow_exception(unexpected);
+    }
+  }
+
+  // Throw if any dispatching failed, naming the modules in the order they were matched
+  std::string failed_mod_names("");
+  for (const auto& [mod_name, data_ptr] : dispatch_seq) {
+    if (failed_modules.erase(mod_name) > 0) {
+      failed_mod_names.append(mod_name);
+      failed_mod_names.append(", ");
+    }
+  }
+  if (!failed_mod_names.empty()) {
+    throw CommandDispatchingFailed(ERS_HERE, id, failed_mod_names);
+  }
+}
+
+app::DispatchOrder
+DAQModuleManager::get_dispatch_order(cmdlib::cmd::CmdId id) const
+{
+  if (auto it = m_dispatch_orders.find(id); it != m_dispatch_orders.end()) {
+    return it->second;
+  }
+
+  // By default, modules start once those they feed have started, so that nothing is pushed to a module which isn't
+  // running, and stop once those feeding them have stopped, so that they can empty their input queues
+  if (id == "start") {
+    return app::DispatchOrder::ReverseDataFlow;
+  }
+  if (id == "stop") {
+    return app::DispatchOrder::DataFlow;
+  }
+  return app::DispatchOrder::Parallel;
+}
+
 void
 DAQModuleManager::execute(const dataobj_t& cmd_data)
 {
@@ -248,6 +597,21 @@ DAQModuleManager::execute(const dataobj_t& cmd_data)
     throw DAQModuleManagerAlreadyInitialized(ERS_HERE);
   }
 
+  // Resizing is done by the framework, whatever state the application is in; modules aren't involved
+  if (cmd.id == "resize") {
+    resize_queues(cmd.data.get<app::Resize>().queues);
+    return;
+  }
+
+  // Queues closed at the previous stop are open again for the whole run
+  if (cmd.id == "start") {
+    for (const auto& [mod_name, queues] : m_module_inputs) {
+      for (const auto& queue : queues) {
+        QueueRegistry::get().reopen_queue(queue);
+      }
+    }
+  }
+
   dispatch_one_match_only(cmd.id, cmd.data);
 
   // dispatch(cmd.id, cmd.data);
@@ -0,0 +1,218 @@
+/**
+ * @file PageAllocation.cpp
+ *
+ * The PageAllocation class implementation
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/PageAllocation.hpp"
+
+#include "ers/ers.hpp"
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cinttypes>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace dunedaq::appfwk {
+
+namespace {
+
+size_t
+base_page_size()
+{
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+size_t
+round_up(size_t bytes, size_t multiple)
+{
+  return (bytes + multiple - 1) / multiple * multiple;
+}
+
+// glibc has no wrapper for mbind(2), and libnuma isn't a dependency of the
+// framework, so the system call is made directly
+bool
+mbind_to_numa_node(void* addr, size_t bytes, int numa_node)
+{
+  constexpr size_t bits_per_word = sizeof(unsigned long) * CHAR_BIT; // NOLINT(runtime/int)
+  std::vector<unsigned long> nodemask(static_cast<size_t>(numa_node) / bits_per_word + 1, 0); // NOLINT(runtime/int)
+  nodemask[static_cast<size_t>(numa_node) / bits_per_word] |= 1UL << (static_cast<size_t>(numa_node) % bits_per_word);
+
+  // The kernel reads one bit fewer than maxnode
+  const unsigned long maxnode = nodemask.size() * bits_per_word + 1; // NOLINT(runtime/int)
+  return syscall(SYS_mbind, addr, bytes, MPOL_BIND, nodemask.data(), maxnode, MPOL_MF_MOVE) == 0;
+}
+
+void*
+map_anonymous(size_t bytes, int extra_flags)
+{
+  return mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+}
+
+// Transparent huge pages can only be used for 2 MB aligned ranges, so map
+// more than needed and trim the mapping to an aligned range
+void*
+map_huge_page_aligned(size_t bytes)
+{
+  const size_t alignment = PageAllocation::s_huge_page_size;
+  void* data = map_anonymous(bytes + alignment, 0);
+  if (data == MAP_FAILED) {
+    return data;
+  }
+
+  const auto start = reinterpret_cast<uintptr_t>(data);
+  const uintptr_t aligned_start = round_up(start, alignment);
+  if (aligned_start != start) {
+    munmap(data, aligned_start - start);
+  }
+  if (aligned_start + bytes != start + bytes + alignment) {
+    munmap(reinterpret_cast<void*>(aligned_start + bytes), start + alignment - aligned_start);
+  }
+  return reinterpret_cast<void*>(aligned_start);
+}
+
+// Whether all of [data, data + bytes) is backed by transparent huge pages, going by the AnonHugePages of the mapping
+// holding it in /proc/self/smaps. The kernel may have merged the mapping with neighbouring ones advised the same way,
+// in which case all of the merged mapping has to be backed by huge pages for this to be known.
+bool
+backed_by_transparent_huge_pages(void* data, size_t bytes)
+{
+  const auto start = reinterpret_cast<uintptr_t>(data);
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool in_mapping = false;
+  size_t mapping_bytes = 0;
+  while (std::getline(smaps, line)) {
+    uintptr_t first = 0;
+    uintptr_t last = 0;
+    size_t huge_kb = 0;
+    if (in_mapping && std::sscanf(line.c_str(), "AnonHugePages: %zu kB", &huge_kb) == 1) {
+      return huge_kb * 1024 >= mapping_bytes;
+    }
+    if (std::sscanf(line.c_str(), "%" SCNxPTR "-%" SCNxPTR, &first, &last) == 2) {
+      in_mapping = first <= start && start + bytes <= last;
+      mapping_bytes = last - first;
+    }
+  }
+  return false;
+}
+
+} // namespace ""
+
+PageAllocation::PageAllocation(size_t bytes, const Options& options)
+  : m_page_size(base_page_size())
+{
+  if (bytes == 0) {
+    return;
+  }
+
+  void* data = MAP_FAILED;
+  if (options.huge_pages == HugePages::kExplicit) {
+    m_size = round_up(bytes, s_huge_page_size);
+    data = map_anonymous(m_size, MAP_HUGETLB | (21 << MAP_HUGE_SHIFT));
+    if (data == MAP_FAILED) {
+      ers::warning(HugePagesUnavailable(ERS_HERE, m_size, std::strerror(errno)));
+    } else {
+      m_page_size = s_huge_page_size;
+    }
+  } else if (options.huge_pages == HugePages::kTransparent) {
+    m_size = round_up(bytes, s_huge_page_size);
+    data = map_huge_page_aligned(m_size);
+    if (data != MAP_FAILED) {
+      if (madvise(data, m_size, MADV_HUGEPAGE) == 0) {
+        m_huge_pages_requested = true;
+      } else {
+        ers::warning(HugePagesUnavailable(ERS_HERE, m_size, std::strerror(errno)));
+      }
+    }
+  }
+
+  if (data == MAP_FAILED) {
+    m_size = round_up(bytes, m_page_size);
+    data = map_anonymous(m_size, 0);
+  }
+  if (data == MAP_FAILED) {
+    throw PageAllocationFailed(ERS_HERE, m_size, std::strerror(errno));
+  }
+  m_data = data;
+
+  // The binding is best put in place before the pages are first touched
+  if (options.numa_node >= 0) {
+    bind_to_numa_node(options.numa_node);
+  }
+
+  if (options.prefault) {
+    volatile char* bytes_to_touch = static_cast<char*>(m_data);
+    for (size_t offset = 0; offset < m_size; offset += m_page_size) {
+      bytes_to_touch[offset] = 0;
+    }
+  }
+
+  if (options.lock && mlock(m_data, m_size) != 0) {
+    ers::warning(MemoryLockFailed(ERS_HERE, m_size, std::strerror(errno)));
+  }
+
+  // The kernel is free to ignore the advice, so the huge page size is only reported once the memory has been touched
+  // and is seen to be backed by huge pages
+  if (m_huge_pages_requested && (options.prefault || options.lock) &&
+      backed_by_transparent_huge_pages(m_data, m_size)) {
+    m_page_size = s_huge_page_size;
+  }
+}
+
+void
+PageAllocation::bind_to_numa_node(int numa_node)
+{
+  if (m_data == nullptr || numa_node < 0 || numa_node == m_numa_node) {
+    return;
+  }
+
+  if (bind_to_numa_node(m_data, m_size, numa_node)) {
+    m_numa_node = numa_node;
+  }
+}
+
+bool
+PageAllocation::bind_to_numa_node(void* data, size_t bytes, int numa_node)
+{
+  if (!mbind_to_numa_node(data, bytes, numa_node)) {
+    ers::warning(NUMABindingFailed(ERS_HERE, bytes, numa_node, std::strerror(errno)));
+    return false;
+  }
+  return true;
+}
+
+int
+PageAllocation::current_numa_node() noexcept
+{
+  unsigned cpu = 0;
+  unsigned numa_node = 0;
+  if (syscall(SYS_getcpu, &cpu, &numa_node, nullptr) != 0) {
+    return -1;
+  }
+  return static_cast<int>(numa_node);
+}
+
+PageAllocation::~PageAllocation()
+{
+  if (m_data != nullptr) {
+    munmap(m_data, m_size);
+  }
+}
+
+} // namespace dunedaq::appfwk
@@ -12,35 +12,105 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 
 namespace dunedaq::appfwk {
 
-std::unique_ptr<QueueRegistry> QueueRegistry::s_instance = nullptr;
+std::unique_ptr<QueueRegistry>&
+QueueRegistry::instance()
+{
+  // Initialised once, thread-safely, by whichever thread gets here first, including from the static initialisation of
+  // another translation unit
+  static std::unique_ptr<QueueRegistry> s_instance(new QueueRegistry());
+  return s_instance;
+}
 
 QueueRegistry&
 QueueRegistry::get()
 {
-  if (!s_instance) {
-    s_instance.reset(new QueueRegistry());
-  }
-  return *s_instance;
+  return *instance();
 }
 
 void
-QueueRegistry::configure(const std::map<std::string, QueueConfig>& config_map)
+QueueRegistry::configure(const std::map<std::string, QueueConfig>& config_map,
+                         const std::map<std::string, PoolConfig>& pool_config_map)
 {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+
   if (m_configured) {
     throw QueueRegistryConfigured(ERS_HERE);
   }
 
-  m_queue_config_map = config_map;
+  m_queue_config_map.insert(config_map.begin(), config_map.end());
+  m_pool_config_map.insert(pool_config_map.begin(), pool_config_map.end());
   m_configured = true;
 }
 
+void
+QueueRegistry::close_queue(const std::string& name)
+{
+  std::shared_ptr<QueueBase> queue;
+  {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto queue_it = m_queue_registry.find(name);
+    if (queue_it != m_queue_registry.end()) {
+      queue = queue_it->second.m_instance;
+    }
+  }
+  if (queue) {
+    queue->close();
+  }
+}
+
+void
+QueueRegistry::resize_queue(const std::string& name, size_t capacity)
+{
+  std::shared_ptr<QueueBase> queue;
+  {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto config_it = m_queue_config_map.find(name);
+    if (config_it == m_queue_config_map.end()) {
+      throw QueueResizeFailed(ERS_HERE, name, capacity, "no such queue is configured");
+    }
+    auto queue_it = m_queue_registry.find(name);
+    if (queue_it == m_queue_registry.end()) {
+      config_it->second.capacity = capacity;
+      return;
+    }
+    queue = queue_it->second.m_instance;
+  }
+
+  // Resizing may allocate, so it is done without holding up lookups
+  if (!queue->resize(capacity)) {
+    throw QueueResizeFailed(ERS_HERE, name, capacity, "its kind can't be resized, or it holds more elements");
+  }
+
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  m_queue_config_map[name].capacity = capacity;
+}
+
+void
+QueueRegistry::reopen_queue(const std::string& name)
+{
+  std::shared_ptr<QueueBase> queue;
+  {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto queue_it = m_queue_registry.find(name);
+    if (queue_it != m_queue_registry.end()) {
+      queue = queue_it->second.m_instance;
+    }
+  }
+  if (queue) {
+    queue->reopen();
+  }
+}
+
 void
 QueueRegistry::gather_stats(opmonlib::InfoCollector& ic, int level)
 {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
 
   for (const auto& [name, queue_entry] : m_queue_registry) {
     opmonlib::InfoCollector tmp_ci;
@@ -49,6 +119,33 @@ QueueRegistry::gather_stats(opmonlib::InfoCollector& ic, int level)
       ic.add(name, tmp_ci);
     }
   }
+
+  for (const auto& [name, pool_entry] : m_pool_registry) {
+    opmonlib::InfoCollector tmp_ci;
+    pool_entry.m_instance->get_info(tmp_ci, level);
+    if (!tmp_ci.is_empty()) {
+      ic.add(name, tmp_ci);
+    }
+  }
+}
+
+MemoryUsage
+QueueRegistry::get_memory_usage() const
+{
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+  MemoryUsage usage;
+  for (const auto& [name, queue_entry] : m_queue_registry) {
+    const QueueBase& queue = *queue_entry.m_instance;
+    usage.queue_bytes += queue.get_bytes();
+    usage.queue_bytes_high_water += queue.get_bytes_high_water();
+    if (queue.get_capacity_bytes() > 0) {
+      usage.queue_capacity_bytes += queue.get_capacity_bytes();
+    } else {
+      ++usage.unlimited_queues;
+    }
+  }
+  return usage;
 }
 
 QueueConfig::queue_kind
@@ -60,8 +157,81 @@ QueueConfig::stoqk(const std::string& name)
     return queue_kind::kFollySPSCQueue;
   else if (name == "FollyMPMCQueue")
     return queue_kind::kFollyMPMCQueue;
+  else if (name == "SPSCRingQueue")
+    return queue_kind::kSPSCRingQueue;
+  else if (name == "BroadcastQueue")
+    return queue_kind::kBroadcastQueue;
+  else if (name == "PriorityQueue")
+    return queue_kind::kPriorityQueue;
+  else if (name == "SharedMemoryQueue")
+    return queue_kind::kSharedMemoryQueue;
+  else if (name == "ElasticQueue")
+    return queue_kind::kElasticQueue;
   else
     throw QueueKindUnknown(ERS_HERE, name);
 }
 
+std::string
+QueueConfig::qktos(queue_kind kind)
+{
+  switch (kind) {
+    case queue_kind::kStdDeQueue:
+      return "StdDeQueue";
+    case queue_kind::kFollySPSCQueue:
+      return "FollySPSCQueue";
+    case queue_kind::kFollyMPMCQueue:
+      return "FollyMPMCQueue";
+    case queue_kind::kSPSCRingQueue:
+      return "SPSCRingQueue";
+    case queue_kind::kBroadcastQueue:
+      return "BroadcastQueue";
+    case queue_kind::kPriorityQueue:
+      return "PriorityQueue";
+    case queue_kind::kSharedMemoryQueue:
+      return "SharedMemoryQueue";
+    case queue_kind::kElasticQueue:
+      return "ElasticQueue";
+    default:
+      return "Unknown";
+  }
+}
+
+QueueConfig::queue_kind
+QueueConfig::select_kind(size_t producers, size_t consumers, const QueueConfig& config)
+{
+  if (producers == 1 && consumers == 1) {
+    return queue_kind::kSPSCRingQueue;
+  }
+
+  // There are no queues specialised for a single producer or a single consumer alone, so those get an MPMC queue, as
+  // do queues whose endpoints aren't all known. The Folly one is the cheaper, unless options it ignores are asked for.
+  const bool preallocated = config.prefault || config.huge_pages != PageAllocation::HugePages::kNone ||
+                            config.lock_memory || config.numa_node >= 0 || config.follow_consumer;
+  if (preallocated || config.capacity_bytes > 0) {
+    return queue_kind::kStdDeQueue;
+  }
+  return queue_kind::kFollyMPMCQueue;
+}
+
+WaitPolicy
+QueueConfig::stowp(const std::string& name)
+{
+  if (name == "Block")
+    return WaitPolicy::kBlock;
+  else if (name == "Spin")
+    return WaitPolicy::kSpin;
+  else if (name == "SpinYield")
+    return WaitPolicy::kSpinYield;
+  else if (name == "SpinPark")
+    return WaitPolicy::kSpinPark;
+  else
+    throw WaitPolicyUnknown(ERS_HERE, name);
+}
+
+WaitPolicy
+QueueConfig::default_wait_policy(queue_kind kind)
+{
+  return kind == queue_kind::kStdDeQueue ? WaitPolicy::kBlock : WaitPolicy::kSpinPark;
+}
+
 } // namespace dunedaq::appfwk
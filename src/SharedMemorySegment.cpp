@@ -0,0 +1,116 @@
+/**
+ * @file SharedMemorySegment.cpp
+ *
+ * The SharedMemorySegment class implementation
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/SharedMemorySegment.hpp"
+
+#include "ers/ers.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+namespace dunedaq::appfwk {
+
+SharedMemorySegment::SharedMemorySegment(const std::string& name, size_t bytes, size_t mapped_bytes)
+  : m_name(name)
+  , m_size(mapped_bytes)
+{
+  const int fd = shm_open(m_name.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    throw SharedMemoryFailed(ERS_HERE, m_name, m_size, std::strerror(errno));
+  }
+
+  // A new segment has size zero. Processes racing to create it all set the same size, which leaves the contents
+  // alone if one of them has already done so.
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    const int error = errno;
+    close(fd);
+    throw SharedMemoryFailed(ERS_HERE, m_name, m_size, std::strerror(error));
+  }
+  if (status.st_size == 0 && ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+    const int error = errno;
+    close(fd);
+    throw SharedMemoryFailed(ERS_HERE, m_name, m_size, std::strerror(error));
+  }
+  m_segment_size = status.st_size == 0 ? bytes : static_cast<size_t>(status.st_size);
+  if (m_segment_size < m_size) {
+    close(fd);
+    throw SharedMemoryFailed(
+      ERS_HERE, m_name, m_size, "the segment already exists with " + std::to_string(m_segment_size) + " bytes");
+  }
+
+  void* data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  const int error = errno;
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw SharedMemoryFailed(ERS_HERE, m_name, m_size, std::strerror(error));
+  }
+  m_data = data;
+}
+
+SharedMemorySegment::SharedMemorySegment(const std::string& name, size_t bytes, const PageAllocation::Options& options)
+  : SharedMemorySegment(name, bytes, bytes)
+{
+  if (m_segment_size != m_size) {
+    throw SharedMemoryFailed(
+      ERS_HERE, m_name, m_size, "the segment already exists with " + std::to_string(m_segment_size) + " bytes");
+  }
+
+  if (options.huge_pages != PageAllocation::HugePages::kNone) {
+    ers::warning(HugePagesUnavailable(ERS_HERE, m_size, "shared memory segments use regular pages"));
+  }
+
+  // The binding is best put in place before the pages are first touched. Another process may already be using the
+  // segment, so prefaulting reads the pages rather than writing them.
+  bind_to_numa_node(options.numa_node);
+  if (options.prefault) {
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const volatile char* bytes_to_touch = static_cast<char*>(m_data);
+    for (size_t offset = 0; offset < m_size; offset += page_size) {
+      bytes_to_touch[offset];
+    }
+  }
+
+  if (options.lock && mlock(m_data, m_size) != 0) {
+    ers::warning(MemoryLockFailed(ERS_HERE, m_size, std::strerror(errno)));
+  }
+}
+
+SharedMemorySegment::~SharedMemorySegment()
+{
+  if (m_data != nullptr) {
+    munmap(m_data, m_size);
+  }
+}
+
+void
+SharedMemorySegment::bind_to_numa_node(int numa_node)
+{
+  if (numa_node < 0 || numa_node == m_numa_node) {
+    return;
+  }
+  if (PageAllocation::bind_to_numa_node(m_data, m_size, numa_node)) {
+    m_numa_node = numa_node;
+  }
+}
+
+void
+SharedMemorySegment::unlink() noexcept
+{
+  shm_unlink(m_name.c_str());
+}
+
+} // namespace dunedaq::appfwk
@@ -15,6 +15,8 @@
  */
 
 #include "appfwk/FollyQueue.hpp"
+#include "appfwk/QueueRegistry.hpp"
+#include "appfwk/SPSCRingQueue.hpp"
 #include "appfwk/StdDeQueue.hpp"
 
 #include "logging/Logging.hpp"
@@ -22,6 +24,7 @@
 #include "boost/program_options.hpp"
 namespace bpo = boost::program_options;
 
+#include <algorithm>
 #include <chrono>
 #include <future>
 #include <iostream>
@@ -50,6 +53,11 @@ namespace {
  */
 std::string queue_type = "StdDeQueue";
 
+/**
+ * @brief How the queue's producers and consumers wait
+ */
+std::string wait_policy = "SpinPark";
+
 auto timeout = std::chrono::milliseconds(100); ///< Queue's timeout
 
 /**
@@ -60,6 +68,7 @@ std::unique_ptr<dunedaq::appfwk::Queue<int>> queue = nullptr;
 int num_elements = 1000000;   ///< Number of elements to push to the Queue (total)
 int num_adding_threads = 1;   ///< Number of threads which will call push
 int num_removing_threads = 1; ///< Number of threads which will call pop
+int batch_size = 1;           ///< Number of elements moved per push/pop call (push_n/pop_n when > 1)
 
 int avg_milliseconds_between_pushes = 0; ///< Target average rate of pushes
 int avg_milliseconds_between_pops = 0;   ///< Target average rate of pops
@@ -111,7 +120,9 @@ add_things(const volatile bool& spinlock)
   const auto start_time_system =
     std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 
-  for (int i = 0; i < num_pushes; ++i) {
+  std::vector<int> batch(batch_size);
+
+  for (int i = 0; i < num_pushes;) {
 
     if (avg_milliseconds_between_pushes > 0) {
       std::this_thread::sleep_for(std::chrono::milliseconds((*push_distribution)(generator)));
@@ -121,36 +132,46 @@ add_things(const volatile bool& spinlock)
       std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 
-    while (true) {
+    const int num_in_batch = std::min(batch_size, num_pushes - i);
+    for (int i_b = 0; i_b < num_in_batch; ++i_b) {
+      batch[i_b] = i + i_b;
+    }
+
+    int num_pushed = 0;
+    while (num_pushed < num_in_batch) {
       try {
 
-        if (!enable_per_pushpop_timing) {
-          queue->push(std::move(i), timeout);
+        int n = 0;
+        start_time_push = std::chrono::steady_clock::now();
+        if (batch_size == 1) {
+          queue->push(std::move(batch[0]), timeout);
+          n = 1;
         } else {
-          start_time_push = std::chrono::steady_clock::now();
-          queue->push(std::move(i), timeout);
-          if (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
-                                                                    start_time_push) > timeout) {
-            timeout_pushes++;
-          }
+          n = static_cast<int>(queue->push_n(&batch[num_pushed], num_in_batch - num_pushed, timeout));
         }
+        if (enable_per_pushpop_timing && std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           std::chrono::steady_clock::now() - start_time_push) > timeout) {
+          timeout_pushes++;
+        }
+        num_pushed += n;
 
         if (enable_max_size_checking) {
-          size_snapshot = queue_size.fetch_add(1) + 1; // fetch_add returns previous value
+          size_snapshot = queue_size.fetch_add(n) + n; // fetch_add returns previous value
 
           if (size_snapshot > max_queue_size) {
             max_queue_size = size_snapshot;
           }
         }
 
-        break;
       } catch (const dunedaq::appfwk::QueueTimeoutExpired& err) {
         throw_pushes++;
         std::ostringstream msg;
-        msg << "Thread #" << std::this_thread::get_id() << ": exception thrown on push #" << i << ": " << err.what();
+        msg << "Thread #" << std::this_thread::get_id() << ": exception thrown on push #" << i + num_pushed << ": "
+            << err.what();
         TLOG(TLVL_WARNING) << msg.str();
       }
     }
+    i += num_in_batch;
   }
 
   std::ostringstream msg;
@@ -170,7 +191,7 @@ remove_things(const volatile bool& spinlock)
 {
   const int num_pops = num_removing_threads > 0 ? num_elements / num_removing_threads : 0;
   auto start_time_pop = std::chrono::steady_clock::now(); // Won't ever use the initialization value
-  int val = -999;
+  std::vector<int> batch(batch_size, -999);
 
   while (spinlock) {
   } // Main program thread will set this to false, then this thread starts popping
@@ -179,7 +200,7 @@ remove_things(const volatile bool& spinlock)
   const auto start_time_system =
     std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 
-  for (int i = 0; i < num_pops; ++i) {
+  for (int i = 0; i < num_pops;) {
 
     if (avg_milliseconds_between_pops > 0) {
       std::this_thread::sleep_for(std::chrono::milliseconds((*pop_distribution)(generator)));
@@ -192,19 +213,22 @@ remove_things(const volatile bool& spinlock)
     while (true) {
       try {
 
-        if (!enable_per_pushpop_timing) {
-          queue->pop(val, timeout);
+        int n = 0;
+        start_time_pop = std::chrono::steady_clock::now();
+        if (batch_size == 1) {
+          queue->pop(batch[0], timeout);
+          n = 1;
         } else {
-          start_time_pop = std::chrono::steady_clock::now();
-          queue->pop(val, timeout);
-
-          if (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time_pop) >
-              timeout)
-            timeout_pops++;
+          n = static_cast<int>(queue->pop_n(batch.data(), std::min(batch_size, num_pops - i), timeout));
+        }
+        if (enable_per_pushpop_timing && std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           std::chrono::steady_clock::now() - start_time_pop) > timeout) {
+          timeout_pops++;
         }
+        i += n;
 
         if (enable_max_size_checking) {
-          queue_size--;
+          queue_size -= n;
         }
         break;
 
@@ -254,6 +278,10 @@ main(int argc, char* argv[])
   pop_pause_desc << "average time in milliseconds between a thread's pops (default is " << avg_milliseconds_between_pops
                  << ")";
 
+  std::ostringstream batch_size_desc;
+  batch_size_desc << "# of elements moved per push/pop call; values above 1 use push_n/pop_n (default is "
+                  << batch_size << ")";
+
   std::ostringstream capacity_used_desc;
   capacity_used_desc << "fraction of the queue's capacity filled at start (default is " << initial_capacity_used << ")";
 
@@ -262,13 +290,18 @@ main(int argc, char* argv[])
                      bpo::value<std::string>(),
                      "Type of queue instance you want to test (default is "
                      "StdDeQueue) (supported "
-                     "types are: StdDeQueue, FollySPSCQueue, FollyMPMCQueue)")(
+                     "types are: StdDeQueue, FollySPSCQueue, FollyMPMCQueue, SPSCRingQueue)")(
+    "wait_policy",
+    bpo::value<std::string>(),
+    "How threads wait on a full or empty queue (default is SpinPark) (supported policies are: Block, Spin, "
+    "SpinYield, SpinPark)")(
     "nelements", bpo::value<int>(), num_elements_desc.str().c_str())(
     "push_threads", bpo::value<int>(), push_threads_desc.str().c_str())(
     "pop_threads", bpo::value<int>(), pop_threads_desc.str().c_str())(
     "pause_between_pushes", bpo::value<int>(), push_pause_desc.str().c_str())(
     "pause_between_pops", bpo::value<int>(), pop_pause_desc.str().c_str())(
-    "capacity", bpo::value<int>()->default_value(1000000000), "queue capacity")(
+    "batch_size", bpo::value<int>(), batch_size_desc.str().c_str())(
+    "capacity", bpo::value<int>()->default_value(1000000), "queue capacity")(
     "initial_capacity_used", bpo::value<double>(), capacity_used_desc.str().c_str())("help,h", "produce help message");
 
   bpo::variables_map vm;
@@ -286,14 +319,21 @@ main(int argc, char* argv[])
     queue_type = vm["queue_type"].as<std::string>();
   }
 
+  if (vm.count("wait_policy")) {
+    wait_policy = vm["wait_policy"].as<std::string>();
+  }
+
   int capacity = vm["capacity"].as<int>();
+  auto policy = dunedaq::appfwk::QueueConfig::stowp(wait_policy);
 
   if (queue_type == "StdDeQueue") {
-    queue.reset(new dunedaq::appfwk::StdDeQueue<int>("StdDeQueue", static_cast<size_t>(capacity)));
+    queue.reset(new dunedaq::appfwk::StdDeQueue<int>("StdDeQueue", static_cast<size_t>(capacity), policy));
   } else if (queue_type == "FollySPSCQueue") {
-    queue.reset(new dunedaq::appfwk::FollySPSCQueue<int>("FollySPSCQueue", static_cast<size_t>(capacity)));
+    queue.reset(new dunedaq::appfwk::FollySPSCQueue<int>("FollySPSCQueue", static_cast<size_t>(capacity), policy));
   } else if (queue_type == "FollyMPMCQueue") {
-    queue.reset(new dunedaq::appfwk::FollyMPMCQueue<int>("FollyMPMCQueue", static_cast<size_t>(capacity)));
+    queue.reset(new dunedaq::appfwk::FollyMPMCQueue<int>("FollyMPMCQueue", static_cast<size_t>(capacity), policy));
+  } else if (queue_type == "SPSCRingQueue") {
+    queue.reset(new dunedaq::appfwk::SPSCRingQueue<int>("SPSCRingQueue", static_cast<size_t>(capacity), policy));
   } else {
     TLOG(TLVL_ERROR) << "Unknown queue type \"" << queue_type << "\" requested for testing";
     return 1;
@@ -314,7 +354,7 @@ main(int argc, char* argv[])
     if (num_adding_threads < 0) {
       throw dunedaq::appfwk::ParameterDomainIssue(ERS_HERE, "# of pushing threads must be non-negative");
     }
-    if (queue_type == "FollySPSCQueue" && num_adding_threads != 0 && num_adding_threads != 1) {
+    if ((queue_type == "FollySPSCQueue" || queue_type == "SPSCRingQueue") && num_adding_threads != 0 && num_adding_threads != 1) {
       throw dunedaq::appfwk::ParameterDomainIssue(ERS_HERE, "# of pushing threads must 0 or 1 for SPSC queue");
     }
     if (num_adding_threads > 0 && num_elements % num_adding_threads != 0) {
@@ -330,7 +370,7 @@ main(int argc, char* argv[])
     if (num_removing_threads < 0) {
       throw dunedaq::appfwk::ParameterDomainIssue(ERS_HERE, "# of popping threads must be non-negative");
     }
-    if (queue_type == "FollySPSCQueue" && num_removing_threads != 0 && num_removing_threads != 1) {
+    if ((queue_type == "FollySPSCQueue" || queue_type == "SPSCRingQueue") && num_removing_threads != 0 && num_removing_threads != 1) {
       throw dunedaq::appfwk::ParameterDomainIssue(ERS_HERE, "# of popping threads must 0 or 1 for SPSC queue");
     }
     if (num_removing_threads > 0 && num_elements % num_removing_threads != 0) {
@@ -358,6 +398,14 @@ main(int argc, char* argv[])
     }
   }
 
+  if (vm.count("batch_size")) {
+    batch_size = vm["batch_size"].as<int>();
+
+    if (batch_size <= 0) {
+      throw dunedaq::appfwk::ParameterDomainIssue(ERS_HERE, "Batch size must be a positive integer");
+    }
+  }
+
   if (vm.count("initial_capacity_used")) {
     initial_capacity_used = vm["initial_capacity_used"].as<double>();
 
@@ -377,6 +425,8 @@ main(int argc, char* argv[])
                   << " elements between them, each thread has an average time of " << avg_milliseconds_between_pops
                   << " milliseconds between pops";
   TLOG(TLVL_INFO) << "Queue of type " << queue_type << " has capacity for " << capacity << " elements";
+  TLOG(TLVL_INFO) << "Threads wait on the queue with the " << wait_policy << " policy";
+  TLOG(TLVL_INFO) << "Elements are pushed and popped in batches of up to " << batch_size;
 
   int elements_to_begin_with = static_cast<int>(initial_capacity_used * capacity);
 
@@ -0,0 +1,226 @@
+/**
+ *
+ * @file queue_registry_check.cxx
+ *
+ * A benchmark of the QueueRegistry. A user-settable number of threads
+ * resolve handles to a user-settable number of queues at the same
+ * time: the first pass over the queues creates them, and the passes
+ * after it re-resolve handles to queues which already exist, as a
+ * plugin re-resolving its queues would
+ *
+ * Run "queue_registry_check --help" to see options
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/QueueRegistry.hpp"
+#include "appfwk/StdDeQueue.hpp"
+
+#include "logging/Logging.hpp"
+
+#include "boost/program_options.hpp"
+namespace bpo = boost::program_options;
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+// Disable coverage collection LCOV_EXCL_START
+ERS_DECLARE_ISSUE(appfwk,               ///< Namespace
+                  ParameterDomainIssue, ///< Issue class name
+                  "ParameterDomainIssue: \"" << ers_messg << "\"",
+                  ((std::string)ers_messg))
+// Re-enable coverage collection LCOV_EXCL_STOP
+} // namespace dunedaq
+
+namespace {
+
+int num_queues = 10000; ///< Number of queues in the registry
+int num_threads = 16;   ///< Number of threads resolving handles to all of the queues
+int num_passes = 10;    ///< Number of times each thread resolves a handle to each queue
+
+std::vector<std::string> queue_names; ///< Names of the queues, built before timing starts
+
+/**
+ * @brief Handles resolved by each thread on its first pass, to check that all threads got the same queues
+ */
+std::vector<std::vector<std::shared_ptr<dunedaq::appfwk::Queue<int>>>> resolved;
+
+std::atomic<long> first_pass_ns = 0; ///< Time taken by the first passes (creation), summed over threads
+std::atomic<long> later_pass_ns = 0; ///< Time taken by the later passes (lookup), summed over threads
+
+/**
+ * @brief Resolve handles to all of the queues, num_passes times
+ */
+void
+resolve_queues(int thread_index, const volatile bool& spinlock)
+{
+  auto& registry = dunedaq::appfwk::QueueRegistry::get();
+  auto& handles = resolved[thread_index];
+  handles.reserve(num_queues);
+
+  while (spinlock) {
+  } // Main program thread will set this to false, then this thread starts resolving
+
+  // Threads start at different queues so that the first pass creates queues from several threads at once
+  const int offset = thread_index * num_queues / num_threads;
+
+  auto start_time = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_queues; ++i) {
+    handles.push_back(registry.get_queue<int>(queue_names[(i + offset) % num_queues]));
+  }
+  first_pass_ns +=
+    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+  start_time = std::chrono::steady_clock::now();
+  for (int pass = 1; pass < num_passes; ++pass) {
+    for (int i = 0; i < num_queues; ++i) {
+      auto queue = registry.get_queue<int, dunedaq::appfwk::StdDeQueue>(queue_names[(i + offset) % num_queues]);
+      if (!queue) {
+        TLOG(TLVL_ERROR) << "Thread #" << thread_index << " got no handle to " << queue_names[(i + offset) % num_queues];
+      }
+    }
+  }
+  later_pass_ns +=
+    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+  // Put the handles in queue_names order for the comparison in main
+  std::vector<std::shared_ptr<dunedaq::appfwk::Queue<int>>> ordered(num_queues);
+  for (int i = 0; i < num_queues; ++i) {
+    ordered[(i + offset) % num_queues] = std::move(handles[i]);
+  }
+  handles = std::move(ordered);
+}
+
+} // namespace ""
+
+int
+main(int argc, char* argv[])
+{
+
+  std::ostringstream descstr;
+  descstr << argv[0] << " known arguments ";
+
+  std::ostringstream num_queues_desc;
+  num_queues_desc << "# of queues in the registry (default is " << num_queues << ")";
+
+  std::ostringstream num_threads_desc;
+  num_threads_desc << "# of threads resolving handles to every queue (default is " << num_threads << ")";
+
+  std::ostringstream num_passes_desc;
+  num_passes_desc << "# of times each thread resolves each queue; the first pass creates the queues (default is "
+                  << num_passes << ")";
+
+  bpo::options_description desc(descstr.str());
+  desc.add_options()("nqueues", bpo::value<int>(), num_queues_desc.str().c_str())(
+    "threads", bpo::value<int>(), num_threads_desc.str().c_str())(
+    "passes", bpo::value<int>(), num_passes_desc.str().c_str())("help,h", "produce help message");
+
+  bpo::variables_map vm;
+  bpo::store(bpo::parse_command_line(argc, argv, desc), vm);
+  bpo::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << "\n"; // NOLINT (TRACE prints an unnecessary warning
+                               // suggesting that a streamer be implemented for
+                               // boost::program_options::options_description)
+    return 0;
+  }
+
+  if (vm.count("nqueues")) {
+    num_queues = vm["nqueues"].as<int>();
+
+    if (num_queues <= 0) {
+      throw dunedaq::appfwk::ParameterDomainIssue(ERS_HERE, "# of queues must be a positive integer");
+    }
+  }
+
+  if (vm.count("threads")) {
+    num_threads = vm["threads"].as<int>();
+
+    if (num_threads <= 0) {
+      throw dunedaq::appfwk::ParameterDomainIssue(ERS_HERE, "# of threads must be a positive integer");
+    }
+  }
+
+  if (vm.count("passes")) {
+    num_passes = vm["passes"].as<int>();
+
+    if (num_passes <= 0) {
+      throw dunedaq::appfwk::ParameterDomainIssue(ERS_HERE, "# of passes must be a positive integer");
+    }
+  }
+
+  std::map<std::string, dunedaq::appfwk::QueueConfig> queue_map;
+  dunedaq::appfwk::QueueConfig config;
+  config.kind = dunedaq::appfwk::QueueConfig::kStdDeQueue;
+  config.capacity = 1;
+  for (int i = 0; i < num_queues; ++i) {
+    queue_names.push_back("queue_" + std::to_string(i));
+    queue_map[queue_names.back()] = config;
+  }
+  dunedaq::appfwk::QueueRegistry::get().configure(queue_map);
+
+  resolved.resize(num_threads);
+
+  TLOG(TLVL_INFO) << num_threads << " thread(s) resolving handles to " << num_queues << " queues " << num_passes
+                  << " time(s) each";
+
+  bool spinlock = true;
+
+  std::vector<std::thread> resolvers;
+  for (int i = 0; i < num_threads; ++i) {
+    resolvers.emplace_back(resolve_queues, i, std::cref(spinlock));
+  }
+
+  // 20 ms is the pause Ron used when he originally implemented the
+  // spinlock strategy in his logging package
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  spinlock = false;
+
+  const auto start_time = std::chrono::steady_clock::now();
+  for (auto& resolver : resolvers) {
+    resolver.join();
+  }
+  const auto total_time =
+    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+  int mismatches = 0;
+  for (int i_t = 1; i_t < num_threads; ++i_t) {
+    for (int i_q = 0; i_q < num_queues; ++i_q) {
+      if (resolved[i_t][i_q] != resolved[0][i_q]) {
+        ++mismatches;
+      }
+    }
+  }
+
+  TLOG(TLVL_INFO) << "\n\nFinal results: ";
+  TLOG(TLVL_INFO) << "Total time was " << total_time << " ms";
+  TLOG(TLVL_INFO) << "First pass (creating the queues) took on average "
+                  << static_cast<double>(first_pass_ns) / (static_cast<double>(num_threads) * num_queues)
+                  << " ns per handle";
+  if (num_passes > 1) {
+    TLOG(TLVL_INFO) << "Later passes (resolving existing queues) took on average "
+                    << static_cast<double>(later_pass_ns) /
+                         (static_cast<double>(num_threads) * num_queues * (num_passes - 1))
+                    << " ns per handle";
+  }
+
+  if (mismatches > 0) {
+    TLOG(TLVL_ERROR) << mismatches << " handle(s) resolved by one thread pointed to another queue than in thread #0";
+    return 1;
+  }
+  TLOG(TLVL_INFO) << "All threads resolved handles to the same queues";
+
+  return 0;
+} // NOLINT
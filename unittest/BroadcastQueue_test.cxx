@@ -0,0 +1,288 @@
+/**
+ *
+ * @file BroadcastQueue_test.cxx BroadcastQueue class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/BroadcastQueue.hpp"
+
+#define BOOST_TEST_MODULE BroadcastQueue_test // NOLINT
+#include "boost/test/included/unit_test.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::appfwk;
+
+BOOST_AUTO_TEST_SUITE(BroadcastQueue_test)
+
+namespace {
+
+constexpr auto timeout = std::chrono::milliseconds(2);
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(Fanout)
+{
+  auto queue = std::make_shared<BroadcastQueue<int>>("BroadcastQueue", 4);
+  auto first = queue->add_consumer();
+  auto second = queue->add_consumer();
+  BOOST_REQUIRE(first != nullptr && second != nullptr);
+
+  for (int i = 0; i < 3; ++i) {
+    queue->push(std::move(i), timeout);
+  }
+  BOOST_REQUIRE_EQUAL(queue->get_num_elements(), 3);
+  BOOST_REQUIRE_EQUAL(first->get_num_elements(), 3);
+
+  int value = -1;
+  for (int i = 0; i < 3; ++i) {
+    first->pop(value, timeout);
+    BOOST_REQUIRE_EQUAL(value, i);
+  }
+  BOOST_REQUIRE(!first->try_pop(value, timeout));
+
+  // The slowest consumer sets the occupancy
+  BOOST_REQUIRE_EQUAL(first->get_num_elements(), 0);
+  BOOST_REQUIRE_EQUAL(queue->get_num_elements(), 3);
+
+  for (int i = 0; i < 3; ++i) {
+    second->pop(value, timeout);
+    BOOST_REQUIRE_EQUAL(value, i);
+  }
+  BOOST_REQUIRE_EQUAL(queue->get_num_elements(), 0);
+
+  BOOST_REQUIRE_THROW(queue->pop(value, timeout), QueueOperationUnsupported);
+}
+
+BOOST_AUTO_TEST_CASE(SlowConsumerBlocks)
+{
+  auto queue = std::make_shared<BroadcastQueue<int>>("BroadcastQueue", 2, SlowConsumerPolicy::kBlock);
+  auto fast = queue->add_consumer();
+  auto slow = queue->add_consumer();
+
+  queue->push(1, timeout);
+  queue->push(2, timeout);
+
+  int value = 0;
+  fast->pop(value, timeout);
+  fast->pop(value, timeout);
+  BOOST_REQUIRE(!queue->try_push(3, timeout));
+
+  slow->pop(value, timeout);
+  BOOST_REQUIRE_EQUAL(value, 1);
+  BOOST_REQUIRE(queue->try_push(3, timeout));
+
+  // A consumer which goes away stops holding back the producer
+  slow.reset();
+  BOOST_REQUIRE(queue->try_push(4, timeout));
+}
+
+BOOST_AUTO_TEST_CASE(SlowConsumerDrops)
+{
+  auto queue = std::make_shared<BroadcastQueue<int>>("BroadcastQueue", 2, SlowConsumerPolicy::kDrop);
+  auto fast = queue->add_consumer();
+  auto slow = queue->add_consumer();
+
+  int value = 0;
+  for (int i = 0; i < 5; ++i) {
+    BOOST_REQUIRE(queue->try_push(std::move(i), std::chrono::milliseconds(0)));
+    fast->pop(value, timeout);
+    BOOST_REQUIRE_EQUAL(value, i);
+  }
+
+  // The slow consumer lost the oldest elements and sees the last capacity of them
+  slow->pop(value, timeout);
+  BOOST_REQUIRE_EQUAL(value, 3);
+  slow->pop(value, timeout);
+  BOOST_REQUIRE_EQUAL(value, 4);
+  BOOST_REQUIRE(!slow->try_pop(value, std::chrono::milliseconds(0)));
+}
+
+BOOST_AUTO_TEST_CASE(SharedPayload)
+{
+  auto queue = std::make_shared<BroadcastQueue<std::unique_ptr<int>>>("BroadcastQueue", 2);
+  auto first = queue->add_consumer();
+  auto second = queue->add_consumer();
+
+  queue->push(std::make_unique<int>(42), timeout);
+
+  // Both consumers see the same element in place, read-only
+  BOOST_REQUIRE(first->supports_read_only_slots());
+  BOOST_REQUIRE(!first->supports_slots());
+  const std::unique_ptr<int>* seen_by_first = first->try_view(timeout);
+  const std::unique_ptr<int>* seen_by_second = second->try_view(timeout);
+  BOOST_REQUIRE(seen_by_first != nullptr);
+  BOOST_REQUIRE_EQUAL(seen_by_first, seen_by_second);
+  BOOST_REQUIRE_EQUAL(**seen_by_first, 42);
+  first->release_peeked();
+  second->release_peeked();
+
+  // Move-only elements can't be popped, as that would copy them
+  std::unique_ptr<int> value;
+  queue->push(std::make_unique<int>(43), timeout);
+  BOOST_REQUIRE_THROW(first->try_pop(value, timeout), QueueOperationUnsupported);
+  BOOST_REQUIRE_THROW(first->try_peek(timeout), QueueOperationUnsupported);
+}
+
+BOOST_AUTO_TEST_CASE(BytesOfChangedPayload)
+{
+  struct Payload
+  {
+    std::string text;
+    size_t payload_size() const noexcept { return text.size(); }
+  };
+  auto queue = std::make_shared<BroadcastQueue<std::shared_ptr<Payload>>>("BroadcastQueue", 1);
+  auto first = queue->add_consumer();
+  auto second = queue->add_consumer();
+
+  // The payload grows after it was pushed, and still leaves with the bytes it came with
+  auto payload = std::make_shared<Payload>(Payload{ std::string(100, 'x') });
+  queue->push(std::shared_ptr<Payload>(payload), timeout);
+  payload->text.append(1000, 'y');
+
+  std::shared_ptr<Payload> value;
+  first->pop(value, timeout);
+  second->pop(value, timeout);
+  queue->push(std::make_shared<Payload>(), timeout); // Finding the ring full, the producer reclaims the first
+  first->pop(value, timeout);
+  second->pop(value, timeout);
+  BOOST_REQUIRE_EQUAL(queue->get_bytes(), sizeof(std::shared_ptr<Payload>));
+}
+
+BOOST_AUTO_TEST_CASE(ElementsDestroyedOnceAllConsumersPass)
+{
+  auto payload = std::make_shared<int>(1);
+  auto queue = std::make_shared<BroadcastQueue<std::shared_ptr<int>>>("BroadcastQueue", 1);
+  auto first = queue->add_consumer();
+  auto second = queue->add_consumer();
+
+  queue->push(std::shared_ptr<int>(payload), timeout);
+  std::shared_ptr<int> value;
+  first->pop(value, timeout);
+  second->pop(value, timeout);
+  value.reset();
+  BOOST_REQUIRE_EQUAL(payload.use_count(), 2);
+
+  // The slot is reclaimed when the producer next needs it
+  queue->push(std::make_shared<int>(2), timeout);
+  BOOST_REQUIRE_EQUAL(payload.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ReadinessPerConsumer)
+{
+  auto queue = std::make_shared<BroadcastQueue<int>>("BroadcastQueue", 4);
+  auto first = queue->add_consumer();
+  auto second = queue->add_consumer();
+
+  EventCount listener;
+  first->add_listener(&listener);
+  auto key = listener.prepare_wait();
+  queue->push(1, timeout);
+  BOOST_REQUIRE(listener.wait_until(key, std::chrono::steady_clock::now() + timeout));
+  first->remove_listener(&listener);
+
+  int value = 0;
+  first->pop(value, timeout);
+  BOOST_REQUIRE(!first->can_pop());
+  BOOST_REQUIRE(second->can_pop());
+}
+
+BOOST_AUTO_TEST_CASE(Close)
+{
+  auto queue = std::make_shared<BroadcastQueue<int>>("BroadcastQueue", 4);
+  auto first = queue->add_consumer();
+  auto second = queue->add_consumer();
+
+  queue->push(1, timeout);
+  queue->close();
+  BOOST_REQUIRE(first->is_closed());
+  BOOST_REQUIRE_THROW(queue->push(2, timeout), QueueClosed);
+
+  // Each consumer gets what was pushed before the queue was closed, and then nothing
+  int value = 0;
+  first->pop(value, timeout);
+  BOOST_REQUIRE_EQUAL(value, 1);
+  BOOST_REQUIRE_THROW(first->pop(value, timeout), QueueClosed);
+  second->pop(value, timeout);
+  BOOST_REQUIRE_EQUAL(value, 1);
+
+  // A consumer already waiting returns as soon as the queue is closed
+  queue->reopen();
+  std::thread closer([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue->close();
+  });
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(!second->try_pop(value, std::chrono::milliseconds(5000)));
+  closer.join();
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(1000));
+}
+
+BOOST_AUTO_TEST_CASE(TooManyConsumers)
+{
+  auto queue = std::make_shared<BroadcastQueue<int>>("BroadcastQueue", 4);
+  std::vector<std::shared_ptr<Queue<int>>> consumers;
+  for (size_t i = 0; i < BroadcastQueue<int>::s_max_consumers; ++i) {
+    consumers.push_back(queue->add_consumer());
+  }
+  BOOST_REQUIRE_THROW(queue->add_consumer(), BroadcastQueueConsumersExhausted);
+}
+
+BOOST_AUTO_TEST_CASE(ThreadedFanout)
+{
+  constexpr int n_elements = 100000;
+  constexpr size_t n_consumers = 3;
+
+  for (auto policy : { SlowConsumerPolicy::kBlock, SlowConsumerPolicy::kDrop }) {
+    auto queue = std::make_shared<BroadcastQueue<int>>("BroadcastQueue", 64, policy);
+    std::vector<std::shared_ptr<Queue<int>>> consumers;
+    for (size_t i = 0; i < n_consumers; ++i) {
+      consumers.push_back(queue->add_consumer());
+    }
+
+    std::vector<int> received(n_consumers, 0);
+    std::vector<char> in_order(n_consumers, 1);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n_consumers; ++i) {
+      threads.emplace_back([&, i]() {
+        int value = 0;
+        int last = -1;
+        while (last < n_elements - 1 && consumers[i]->try_pop(value, std::chrono::milliseconds(1000))) {
+          in_order[i] = in_order[i] && value > last;
+          last = value;
+          ++received[i];
+        }
+      });
+    }
+
+    for (int i = 0; i < n_elements; ++i) {
+      BOOST_REQUIRE(queue->try_push(std::move(i), std::chrono::milliseconds(1000)));
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    for (size_t i = 0; i < n_consumers; ++i) {
+      BOOST_REQUIRE(in_order[i]);
+      if (policy == SlowConsumerPolicy::kBlock) {
+        BOOST_REQUIRE_EQUAL(received[i], n_elements);
+      } else {
+        BOOST_REQUIRE_GT(received[i], 0);
+      }
+    }
+
+    // Every consumer is past every element; at most the last ring's worth, which the producer reclaims once it
+    // finds the ring full, is still counted
+    BOOST_REQUIRE_LE(queue->get_bytes(), queue->get_capacity() * sizeof(int));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -179,6 +179,43 @@ BOOST_AUTO_TEST_CASE(CommandMatchingModules)
     mgr.execute(cmd_data), ConflictingCommandMatching, [&](ConflictingCommandMatching) { return true; });
 }
 
+BOOST_AUTO_TEST_CASE(ParallelDispatch)
+{
+  QueueRegistry::reset();
+  auto mgr = DAQModuleManager();
+
+  dunedaq::appfwk::app::Init init;
+  init.dispatch_threads = 2;
+  init.command_orders.push_back({ "stuff", dunedaq::appfwk::app::DispatchOrder::DataFlow });
+  for (const std::string name : { "DummyModule1", "DummyModule2", "DummyModule3" }) {
+    dunedaq::appfwk::app::ModSpec module_init;
+    module_init.inst = name;
+    module_init.plugin = "DummyModule";
+    init.modules.push_back(module_init);
+  }
+  nlohmann::json init_data;
+  to_json(init_data, init);
+  dunedaq::cmdlib::cmd::Command cmd;
+  cmd.id = "init";
+  cmd.data = init_data;
+  nlohmann::json cmd_data;
+  to_json(cmd_data, cmd);
+  mgr.execute(cmd_data);
+
+  BOOST_REQUIRE_EQUAL(mgr.initialized(), true);
+
+  cmd.id = "stuff";
+  to_json(cmd_data, cmd);
+  mgr.execute(cmd_data);
+
+  // Failures are still collected from every module
+  cmd.id = "bad_stuff";
+  to_json(cmd_data, cmd);
+  BOOST_REQUIRE_EXCEPTION(mgr.execute(cmd_data), CommandDispatchingFailed, [&](CommandDispatchingFailed ex) {
+    return std::string(ex.what()).find("DummyModule3") != std::string::npos;
+  });
+}
+
 BOOST_AUTO_TEST_CASE(InitializeQueues)
 {
   QueueRegistry::reset();
@@ -232,4 +269,64 @@ BOOST_AUTO_TEST_CASE(InitializeUnknownQueueType)
   BOOST_REQUIRE_EXCEPTION(mgr.execute(cmd_data), MissingComponent, [&](MissingComponent) { return true; });
 }
 
+BOOST_AUTO_TEST_CASE(InitializeAutoQueues)
+{
+  QueueRegistry::reset();
+  auto mgr = DAQModuleManager();
+
+  // One producer and one consumer of "link", two producers of "merge"
+  dunedaq::appfwk::app::Init init;
+  dunedaq::appfwk::app::QueueSpec queue_init;
+  queue_init.kind = dunedaq::appfwk::app::QueueKind::Auto;
+  queue_init.capacity = 10;
+  queue_init.inst = "link";
+  init.queues.push_back(queue_init);
+  queue_init.inst = "merge";
+  init.queues.push_back(queue_init);
+
+  auto add_module = [&](const std::string& name, const dunedaq::appfwk::app::QueueInfos& qinfos) {
+    dunedaq::appfwk::app::ModInit mod_init;
+    mod_init.qinfos = qinfos;
+    dunedaq::appfwk::app::ModSpec module_init;
+    module_init.inst = name;
+    module_init.plugin = "DummyModule";
+    to_json(module_init.data, mod_init);
+    init.modules.push_back(module_init);
+  };
+  add_module("source", { { "link", "output", "output" }, { "merge", "merge", "output" } });
+  add_module("filter", { { "link", "input", "input" }, { "merge", "merge", "output" } });
+
+  nlohmann::json init_data;
+  to_json(init_data, init);
+  dunedaq::cmdlib::cmd::Command cmd;
+  cmd.id = "init";
+  cmd.data = init_data;
+  nlohmann::json cmd_data;
+  to_json(cmd_data, cmd);
+  mgr.execute(cmd_data);
+
+  BOOST_REQUIRE_NO_THROW((QueueRegistry::get().get_queue<int, SPSCRingQueue>("link")));
+  BOOST_REQUIRE_NO_THROW((QueueRegistry::get().get_queue<int, FollyMPMCQueue>("merge")));
+
+  // A queue configured as SPSC can't have more than one producer
+  QueueRegistry::reset();
+  auto spsc_mgr = DAQModuleManager();
+  init.queues[1].kind = dunedaq::appfwk::app::QueueKind::SPSCRingQueue;
+  to_json(init_data, init);
+  cmd.data = init_data;
+  to_json(cmd_data, cmd);
+  BOOST_REQUIRE_EXCEPTION(
+    spsc_mgr.execute(cmd_data), QueueTopologyUnsupported, [&](QueueTopologyUnsupported) { return true; });
+
+  // Nor can a broadcast queue, which allows several consumers
+  QueueRegistry::reset();
+  auto broadcast_mgr = DAQModuleManager();
+  init.queues[1].kind = dunedaq::appfwk::app::QueueKind::BroadcastQueue;
+  to_json(init_data, init);
+  cmd.data = init_data;
+  to_json(cmd_data, cmd);
+  BOOST_REQUIRE_EXCEPTION(
+    broadcast_mgr.execute(cmd_data), QueueTopologyUnsupported, [&](QueueTopologyUnsupported) { return true; });
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,185 @@
+/**
+ * @file DAQSourceSet_test.cxx DAQSourceSet class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/DAQSink.hpp"
+#include "appfwk/DAQSource.hpp"
+#include "appfwk/DAQSourceSet.hpp"
+
+#define BOOST_TEST_MODULE DAQSourceSet_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::appfwk;
+
+BOOST_AUTO_TEST_SUITE(DAQSourceSet_test)
+
+/**
+ * @brief Initializes the QueueRegistry with one queue of each kind
+ */
+struct DAQSourceSetTestFixture
+{
+  DAQSourceSetTestFixture() {}
+
+  void setup()
+  {
+    std::map<std::string, QueueConfig> queue_map = { { "deque", { QueueConfig::queue_kind::kStdDeQueue, 10 } },
+                                                     { "ring", { QueueConfig::queue_kind::kSPSCRingQueue, 10 } },
+                                                     { "mpmc", { QueueConfig::queue_kind::kFollyMPMCQueue, 10 } } };
+
+    QueueRegistry::get().configure(queue_map);
+  }
+};
+
+BOOST_TEST_GLOBAL_FIXTURE(DAQSourceSetTestFixture);
+
+namespace {
+constexpr auto timeout = std::chrono::milliseconds(2);
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(Timeout)
+{
+  DAQSource<int> deque_source("deque");
+  DAQSource<std::string> ring_source("ring");
+
+  DAQSourceSet sources;
+  BOOST_REQUIRE_EQUAL(sources.add(deque_source), 0);
+  BOOST_REQUIRE_EQUAL(sources.add(ring_source), 1);
+  BOOST_REQUIRE_EQUAL(sources.size(), 2);
+
+  BOOST_REQUIRE(!sources.wait_any());
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(!sources.wait_any(timeout));
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time >= timeout);
+}
+
+BOOST_AUTO_TEST_CASE(Wakeup)
+{
+  for (auto policy : { WaitPolicy::kBlock, WaitPolicy::kSpin, WaitPolicy::kSpinYield, WaitPolicy::kSpinPark }) {
+    DAQSource<int> deque_source("deque");
+    DAQSource<std::string> ring_source("ring");
+    DAQSource<double> mpmc_source("mpmc");
+
+    DAQSourceSet sources(policy);
+    sources.add(deque_source);
+    sources.add(ring_source);
+    sources.add(mpmc_source);
+
+    // Each push wakes the waiting thread, which then finds the source it was made to
+    std::thread producer([]() {
+      DAQSink<int> deque_sink("deque");
+      DAQSink<std::string> ring_sink("ring");
+      DAQSink<double> mpmc_sink("mpmc");
+      std::this_thread::sleep_for(timeout);
+      ring_sink.push("ring", timeout);
+      std::this_thread::sleep_for(timeout);
+      mpmc_sink.push(3.0, timeout);
+      std::this_thread::sleep_for(timeout);
+      deque_sink.push(1, timeout);
+    });
+
+    std::string ring_value;
+    double mpmc_value = 0;
+    int deque_value = 0;
+    auto ready = sources.wait_any(std::chrono::milliseconds(1000));
+    BOOST_REQUIRE(ready);
+    BOOST_REQUIRE_EQUAL(*ready, 1);
+    ring_source.pop(ring_value);
+    BOOST_REQUIRE_EQUAL(ring_value, "ring");
+
+    ready = sources.wait_any(std::chrono::milliseconds(1000));
+    BOOST_REQUIRE(ready);
+    BOOST_REQUIRE_EQUAL(*ready, 2);
+    mpmc_source.pop(mpmc_value);
+
+    ready = sources.wait_any(std::chrono::milliseconds(1000));
+    BOOST_REQUIRE(ready);
+    BOOST_REQUIRE_EQUAL(*ready, 0);
+    deque_source.pop(deque_value);
+    BOOST_REQUIRE_EQUAL(deque_value, 1);
+
+    producer.join();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Closed)
+{
+  DAQSource<int> deque_source("deque");
+  DAQSource<std::string> ring_source("ring");
+
+  DAQSourceSet sources;
+  sources.add(deque_source);
+  sources.add(ring_source);
+
+  // Closing a source wakes the waiting thread, which then finds the source closed
+  std::thread closer([]() {
+    std::this_thread::sleep_for(timeout);
+    QueueRegistry::get().close_queue("ring");
+  });
+  auto ready = sources.wait_any(std::chrono::milliseconds(1000));
+  closer.join();
+  BOOST_REQUIRE(ready);
+  BOOST_REQUIRE_EQUAL(*ready, 1);
+  BOOST_REQUIRE(ring_source.is_closed());
+
+  QueueRegistry::get().reopen_queue("ring");
+  BOOST_REQUIRE(!sources.wait_any());
+}
+
+BOOST_AUTO_TEST_CASE(Fairness)
+{
+  DAQSink<int> deque_sink("deque");
+  DAQSink<std::string> ring_sink("ring");
+  DAQSource<int> deque_source("deque");
+  DAQSource<std::string> ring_source("ring");
+
+  DAQSourceSet sources;
+  sources.add(deque_source);
+  sources.add(ring_source);
+
+  for (int i = 0; i < 3; ++i) {
+    deque_sink.push(i, timeout);
+    ring_sink.push(std::to_string(i), timeout);
+  }
+
+  // With both sources ready, they take turns
+  int deque_value = 0;
+  std::string ring_value;
+  for (int i = 0; i < 3; ++i) {
+    BOOST_REQUIRE_EQUAL(sources.wait_any().value(), 0);
+    deque_source.pop(deque_value);
+    BOOST_REQUIRE_EQUAL(sources.wait_any().value(), 1);
+    ring_source.pop(ring_value);
+  }
+  BOOST_REQUIRE(!sources.wait_any());
+}
+
+BOOST_AUTO_TEST_CASE(TooManySets)
+{
+  DAQSource<int> deque_source("deque");
+
+  std::vector<std::unique_ptr<DAQSourceSet>> sets;
+  for (size_t i = 0; i < ReadinessNotifier::s_max_listeners; ++i) {
+    sets.push_back(std::make_unique<DAQSourceSet>());
+    sets.back()->add(deque_source);
+  }
+  DAQSourceSet one_too_many;
+  BOOST_REQUIRE_THROW(one_too_many.add(deque_source), QueueListenersExhausted);
+
+  // A set which goes away frees its place
+  sets.pop_back();
+  BOOST_REQUIRE_EQUAL(one_too_many.add(deque_source), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+/**
+ * @file DwellTimeRecorder_test.cxx LatencyHistogram and DwellTimeRecorder class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/DwellTimeRecorder.hpp"
+#include "appfwk/ElasticQueue.hpp"
+#include "appfwk/SPSCRingQueue.hpp"
+#include "appfwk/StdDeQueue.hpp"
+
+#define BOOST_TEST_MODULE DwellTimeRecorder_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(DwellTimeRecorder_test)
+
+using namespace dunedaq::appfwk;
+
+BOOST_AUTO_TEST_CASE(BucketEdges)
+{
+  // Every value must fall in a bucket whose upper edge is at least the value
+  // and within 1/8 of it
+  for (uint64_t value : { 0ULL, 1ULL, 7ULL, 8ULL, 15ULL, 16ULL, 17ULL, 1000ULL, 123456789ULL, 1ULL << 62 }) {
+    auto edge = LatencyHistogram::bucket_upper_edge(LatencyHistogram::bucket_index(value));
+    BOOST_CHECK_GE(edge, value);
+    BOOST_CHECK_LE(edge - value, value / 8);
+  }
+  BOOST_REQUIRE_LT(LatencyHistogram::bucket_index(UINT64_MAX), (64 - 3 + 1) * 8);
+}
+
+BOOST_AUTO_TEST_CASE(Percentiles)
+{
+  LatencyHistogram histogram;
+  BOOST_REQUIRE_EQUAL(histogram.take_summary().samples, 0);
+
+  for (uint64_t value = 1; value <= 1000; ++value) {
+    histogram.record(value * 1000);
+  }
+  auto summary = histogram.take_summary();
+  BOOST_REQUIRE_EQUAL(summary.samples, 1000);
+  BOOST_REQUIRE_EQUAL(summary.max, 1000000);
+  BOOST_CHECK_GE(summary.p50, 500000);
+  BOOST_CHECK_LE(summary.p50, 500000 * 9 / 8);
+  BOOST_CHECK_GE(summary.p99, 990000);
+  BOOST_CHECK_LE(summary.p999, summary.max);
+  BOOST_CHECK_GE(summary.p999, summary.p99);
+
+  // Taking a summary starts a new interval
+  summary = histogram.take_summary();
+  BOOST_REQUIRE_EQUAL(summary.samples, 0);
+  BOOST_REQUIRE_EQUAL(summary.max, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Recorder)
+{
+  DwellTimeRecorder recorder(4);
+
+  recorder.on_push(2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  recorder.on_pop(1);
+  recorder.on_push(1);
+  recorder.on_pop(2);
+
+  auto summary = recorder.take_summary();
+  BOOST_REQUIRE_EQUAL(summary.samples, 3);
+  BOOST_CHECK_GE(summary.max, 2000000);
+
+  // A pop with no matching stamp is skipped rather than recorded
+  recorder.on_pop(1);
+  BOOST_REQUIRE_EQUAL(recorder.take_summary().samples, 0);
+}
+
+BOOST_AUTO_TEST_CASE(LateStamp)
+{
+  DwellTimeRecorder recorder(4); // Eight slots
+
+  // The consumer gets to the first element before its stamp, which lands afterwards
+  recorder.on_pop(1);
+  recorder.on_push(1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  // The late stamp is still in the first slot when the pop sequence comes back round to it, and is skipped
+  recorder.on_push(7);
+  recorder.on_pop(8);
+  auto summary = recorder.take_summary();
+  BOOST_REQUIRE_EQUAL(summary.samples, 7);
+  BOOST_CHECK_LT(summary.max, 20000000);
+}
+
+BOOST_AUTO_TEST_CASE(Queues)
+{
+  StdDeQueue<int> deque("StdDeQueue", 10);
+  SPSCRingQueue<int> ring("SPSCRingQueue", 10);
+  ElasticQueue<int> elastic("ElasticQueue", 2, 16 * sizeof(int));
+
+  // The ElasticQueue grows past its first chunk, which the side array has to cover
+  BOOST_REQUIRE_EQUAL(static_cast<QueueBase&>(elastic).get_max_capacity(), elastic.get_max_capacity());
+  BOOST_REQUIRE_GT(elastic.get_max_capacity(), elastic.get_capacity());
+
+  for (Queue<int>* queue : std::initializer_list<Queue<int>*>{ &deque, &ring, &elastic }) {
+    queue->enable_dwell_time_monitoring();
+
+    int values[3] = { 1, 2, 3 };
+    queue->push(0, std::chrono::milliseconds(0));
+    queue->push_n(values, 3, std::chrono::milliseconds(0));
+    int popped = -1;
+    queue->pop(popped, std::chrono::milliseconds(0));
+    BOOST_REQUIRE_EQUAL(queue->pop_n(values, 3, std::chrono::milliseconds(0)), 3);
+
+    dunedaq::opmonlib::InfoCollector ic;
+    queue->get_info(ic, 0);
+    BOOST_REQUIRE(!ic.is_empty());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,139 @@
+/**
+ *
+ * @file ElasticQueue_test.cxx ElasticQueue class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/ElasticQueue.hpp"
+
+#define BOOST_TEST_MODULE ElasticQueue_test // NOLINT
+#include "boost/test/included/unit_test.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(ElasticQueue_test)
+
+// For a first look at the code, you may want to skip past the
+// contents of the unnamed namespace and move ahead to the actual test
+// cases
+
+namespace {
+
+constexpr auto timeout = std::chrono::milliseconds(2);
+
+constexpr size_t chunk_capacity = 8;
+constexpr size_t chunk_bytes = chunk_capacity * sizeof(int);
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(sanity_checks)
+{
+  dunedaq::appfwk::ElasticQueue<int> queue("ElasticQueue", chunk_capacity, 5 * chunk_bytes);
+
+  BOOST_REQUIRE(!queue.can_pop());
+  BOOST_REQUIRE_EQUAL(queue.get_capacity(), chunk_capacity);
+  BOOST_REQUIRE_EQUAL(queue.get_max_capacity(), 4 * chunk_capacity);
+  BOOST_REQUIRE_EQUAL(queue.get_footprint(), 2 * chunk_bytes);
+
+  queue.push(42, timeout);
+  BOOST_REQUIRE_EQUAL(queue.get_num_elements(), 1);
+  int popped_value = -999;
+  queue.pop(popped_value, timeout);
+  BOOST_REQUIRE_EQUAL(popped_value, 42);
+  BOOST_REQUIRE_EQUAL(queue.get_num_elements(), 0);
+
+  dunedaq::opmonlib::InfoCollector ic;
+  queue.get_info(ic, 0);
+  BOOST_REQUIRE(!ic.is_empty());
+}
+
+BOOST_AUTO_TEST_CASE(growth_checks)
+{
+  dunedaq::appfwk::ElasticQueue<int> queue("ElasticQueue", chunk_capacity, 5 * chunk_bytes);
+
+  // Elements stay in order across chunks, and the queue grows a chunk at a time up to the ceiling, and no further
+  for (int i = 0; i < static_cast<int>(4 * chunk_capacity); ++i) {
+    queue.push(std::move(i), timeout);
+  }
+  BOOST_REQUIRE_EQUAL(queue.get_capacity(), 4 * chunk_capacity);
+  BOOST_REQUIRE_EQUAL(queue.get_footprint(), 5 * chunk_bytes);
+  BOOST_REQUIRE(!queue.can_push());
+  BOOST_REQUIRE_THROW(queue.push(-1, timeout), dunedaq::appfwk::QueueTimeoutExpired);
+
+  for (int i = 0; i < static_cast<int>(4 * chunk_capacity); ++i) {
+    int popped_value = -999;
+    queue.pop(popped_value, timeout);
+    BOOST_REQUIRE_EQUAL(popped_value, i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(shrink_checks)
+{
+  dunedaq::appfwk::ElasticQueue<int> queue(
+    "ElasticQueue", chunk_capacity, 5 * chunk_bytes, std::chrono::milliseconds(20));
+
+  for (int i = 0; i < static_cast<int>(3 * chunk_capacity); ++i) {
+    queue.push(std::move(i), timeout);
+  }
+  const size_t grown_capacity = queue.get_capacity();
+  BOOST_REQUIRE(grown_capacity > chunk_capacity);
+
+  // Chunks are given back one per idle period, by consumers polling the queue, until one is left
+  int popped_value = -999;
+  for (int i = 0; i < static_cast<int>(3 * chunk_capacity); ++i) {
+    queue.pop(popped_value, timeout);
+    BOOST_REQUIRE_EQUAL(popped_value, i);
+  }
+  BOOST_REQUIRE_EQUAL(queue.get_capacity(), grown_capacity);
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (queue.get_capacity() > chunk_capacity && std::chrono::steady_clock::now() < deadline) {
+    BOOST_REQUIRE(!queue.try_pop(popped_value, std::chrono::milliseconds(5)));
+  }
+  BOOST_REQUIRE_EQUAL(queue.get_capacity(), chunk_capacity);
+  BOOST_REQUIRE_EQUAL(queue.get_footprint(), 2 * chunk_bytes);
+
+  // The queue still works, and grows again, once shrunk
+  for (int i = 0; i < static_cast<int>(2 * chunk_capacity); ++i) {
+    queue.push(std::move(i), timeout);
+  }
+  for (int i = 0; i < static_cast<int>(2 * chunk_capacity); ++i) {
+    queue.pop(popped_value, timeout);
+    BOOST_REQUIRE_EQUAL(popped_value, i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_checks)
+{
+  constexpr int num_elements = 100000;
+  dunedaq::appfwk::ElasticQueue<int> queue(
+    "ElasticQueue", chunk_capacity, 64 * chunk_bytes, std::chrono::milliseconds(1));
+
+  std::thread producer([&]() {
+    for (int i = 0; i < num_elements; ++i) {
+      queue.push(std::move(i), std::chrono::seconds(10));
+    }
+  });
+
+  int mismatches = 0;
+  for (int i = 0; i < num_elements; ++i) {
+    int popped_value = -999;
+    queue.pop(popped_value, std::chrono::seconds(10));
+    if (popped_value != i) {
+      ++mismatches;
+    }
+  }
+  producer.join();
+  BOOST_REQUIRE_EQUAL(mismatches, 0);
+  BOOST_REQUIRE(!queue.can_pop());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,8 +12,12 @@
 #define BOOST_TEST_MODULE FollyQueue_test // NOLINT
 #include "boost/test/included/unit_test.hpp"
 
+#include "QueueChecks.hpp"
+
 #include <chrono>
+#include <thread>
 #include <utility>
+#include <vector>
 
 // For a first look at the code, you may want to skip past the
 // contents of the unnamed namespace and move ahead to the actual test
@@ -182,3 +186,50 @@ BOOST_AUTO_TEST_CASE(full_checks, *boost::unit_test::depends_on("empty_checks"))
   }
 
 }
+
+BOOST_AUTO_TEST_CASE(batch_checks, *boost::unit_test::depends_on("full_checks"))
+{
+  dunedaq::appfwk::unittest::check_batches(queue, timeout);
+}
+
+BOOST_AUTO_TEST_CASE(try_checks, *boost::unit_test::depends_on("batch_checks"))
+{
+  dunedaq::appfwk::unittest::check_try_operations(queue, timeout);
+}
+BOOST_AUTO_TEST_CASE(wait_policies)
+{
+  dunedaq::appfwk::unittest::check_wait_policies<dunedaq::appfwk::FollySPSCQueue<int>>("FollyQueue", timeout);
+}
+
+BOOST_AUTO_TEST_CASE(close_checks)
+{
+  using dunedaq::appfwk::WaitPolicy;
+  for (auto policy : { WaitPolicy::kBlock, WaitPolicy::kSpin, WaitPolicy::kSpinYield, WaitPolicy::kSpinPark }) {
+    dunedaq::appfwk::FollySPSCQueue<int> close_queue("FollyQueue", 2, policy);
+    dunedaq::appfwk::unittest::check_close(close_queue, timeout);
+
+    dunedaq::appfwk::FollyMPMCQueue<int> mpmc_close_queue("FollyMPMCQueue", 2, policy);
+    dunedaq::appfwk::unittest::check_close(mpmc_close_queue, timeout);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(resize_checks)
+{
+  dunedaq::appfwk::FollySPSCQueue<int> resize_queue("resize_queue", 2);
+  resize_queue.push(1, timeout);
+  resize_queue.push(2, timeout);
+  BOOST_REQUIRE(!resize_queue.try_push(3, timeout));
+
+  BOOST_REQUIRE(!resize_queue.resize(0));
+  BOOST_REQUIRE(!resize_queue.resize(1)); // Holds more elements than that
+  BOOST_REQUIRE(resize_queue.resize(3));
+  BOOST_REQUIRE_EQUAL(resize_queue.get_capacity(), 3);
+  resize_queue.push(3, timeout);
+  BOOST_REQUIRE(!resize_queue.try_push(4, timeout));
+
+  int popped_value = 0;
+  for (int i = 1; i <= 3; ++i) {
+    resize_queue.pop(popped_value, timeout);
+    BOOST_REQUIRE_EQUAL(popped_value, i);
+  }
+}
@@ -0,0 +1,129 @@
+/**
+ * @file ObjectPool_test.cxx ObjectPool class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/ObjectPool.hpp"
+#include "appfwk/SPSCRingQueue.hpp"
+
+#define BOOST_TEST_MODULE ObjectPool_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(ObjectPool_test)
+
+using namespace dunedaq::appfwk;
+
+namespace {
+
+struct Payload
+{
+  explicit Payload(int value)
+    : m_value(value)
+  {
+    if (value < 0) {
+      throw std::invalid_argument("negative payload");
+    }
+  }
+  int m_value;
+  std::string m_text{ "payload" };
+};
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(AcquireRelease)
+{
+  ObjectPool<Payload> pool("Pool", 3);
+  BOOST_REQUIRE_EQUAL(pool.get_capacity(), 3);
+  BOOST_REQUIRE_EQUAL(pool.get_num_allocated(), 0);
+
+  std::vector<ObjectPool<Payload>::pointer_t> objects;
+  std::set<Payload*> addresses;
+  for (int i = 0; i < 3; ++i) {
+    objects.push_back(pool.acquire(i));
+    BOOST_REQUIRE_EQUAL(objects.back()->m_value, i);
+    addresses.insert(objects.back().get());
+  }
+  BOOST_REQUIRE_EQUAL(addresses.size(), 3);
+  BOOST_REQUIRE_EQUAL(pool.get_num_allocated(), 3);
+
+  BOOST_REQUIRE(!pool.try_acquire(3));
+  BOOST_REQUIRE_EXCEPTION(pool.acquire(3), PoolExhausted, [&](PoolExhausted) { return true; });
+
+  // A returned slot is the next one handed out
+  Payload* released = objects[1].get();
+  objects[1].reset();
+  BOOST_REQUIRE_EQUAL(pool.get_num_allocated(), 2);
+  auto reacquired = pool.acquire(4);
+  BOOST_REQUIRE_EQUAL(reacquired.get(), released);
+
+  // A throwing constructor doesn't leak the slot
+  reacquired.reset();
+  BOOST_REQUIRE_THROW(pool.acquire(-1), std::invalid_argument);
+  BOOST_REQUIRE_EQUAL(pool.get_num_allocated(), 2);
+  BOOST_REQUIRE(pool.try_acquire(5));
+}
+
+BOOST_AUTO_TEST_CASE(SlabSize)
+{
+  ObjectPool<Payload> pool("Pool", 4, 256);
+  auto first = pool.acquire(1);
+  auto second = pool.acquire(2);
+  BOOST_REQUIRE_EQUAL(reinterpret_cast<char*>(second.get()) - reinterpret_cast<char*>(first.get()), 256); // NOLINT
+  BOOST_REQUIRE_EQUAL(reinterpret_cast<uintptr_t>(first.get()) % alignof(Payload), 0);                     // NOLINT
+}
+
+BOOST_AUTO_TEST_CASE(Monitoring)
+{
+  ObjectPool<Payload> pool("Pool", 2);
+  auto first = pool.acquire(1);
+  auto second = pool.acquire(2);
+  BOOST_REQUIRE(!pool.try_acquire(3));
+
+  dunedaq::opmonlib::InfoCollector ic;
+  pool.get_info(ic, 1);
+  BOOST_REQUIRE(!ic.is_empty());
+}
+
+BOOST_AUTO_TEST_CASE(ReleaseThroughQueue)
+{
+  constexpr int num_objects = 10000;
+  ObjectPool<Payload> pool("Pool", 16);
+  SPSCRingQueue<ObjectPool<Payload>::pointer_t> queue("Queue", 8);
+
+  // Objects are acquired by the producer and returned by the consumer
+  std::thread producer([&]() {
+    for (int i = 0; i < num_objects; ++i) {
+      ObjectPool<Payload>::pointer_t object;
+      while (!(object = pool.try_acquire(i))) {
+        std::this_thread::yield();
+      }
+      queue.push(std::move(object), std::chrono::milliseconds(1000));
+    }
+  });
+
+  ObjectPool<Payload>::pointer_t object;
+  for (int i = 0; i < num_objects; ++i) {
+    queue.pop(object, std::chrono::milliseconds(1000));
+    if (object->m_value != i) {
+      BOOST_REQUIRE_EQUAL(object->m_value, i);
+    }
+    object.reset();
+  }
+  producer.join();
+  BOOST_REQUIRE_EQUAL(pool.get_num_allocated(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,96 @@
+/**
+ * @file PageAllocation_test.cxx PageAllocation class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/PageAllocation.hpp"
+
+#define BOOST_TEST_MODULE PageAllocation_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+
+BOOST_AUTO_TEST_SUITE(PageAllocation_test)
+
+using namespace dunedaq::appfwk;
+
+BOOST_AUTO_TEST_CASE(RegularPages)
+{
+  const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+  PageAllocation empty(0, PageAllocation::Options());
+  BOOST_REQUIRE(empty.data() == nullptr);
+  BOOST_REQUIRE_EQUAL(empty.size(), 0);
+
+  PageAllocation::Options options;
+  options.prefault = true;
+  options.lock = true; // Falls back to a warning if the memlock limit is too low
+  PageAllocation memory(page_size + 1, options);
+  BOOST_REQUIRE(memory.data() != nullptr);
+  BOOST_REQUIRE_EQUAL(memory.size(), 2 * page_size);
+  BOOST_REQUIRE_EQUAL(memory.page_size(), page_size);
+  BOOST_REQUIRE_EQUAL(reinterpret_cast<uintptr_t>(memory.data()) % page_size, 0); // NOLINT
+
+  // The memory starts zeroed and is writable
+  const char* bytes = static_cast<const char*>(memory.data());
+  BOOST_REQUIRE_EQUAL(bytes[0], 0);
+  BOOST_REQUIRE_EQUAL(bytes[memory.size() - 1], 0);
+  std::memset(memory.data(), 0xff, memory.size());
+}
+
+BOOST_AUTO_TEST_CASE(HugePages)
+{
+  PageAllocation::Options options;
+  options.huge_pages = PageAllocation::HugePages::kTransparent;
+  PageAllocation transparent(1, options);
+  BOOST_REQUIRE_EQUAL(transparent.size(), PageAllocation::s_huge_page_size);
+  BOOST_REQUIRE_EQUAL(reinterpret_cast<uintptr_t>(transparent.data()) % PageAllocation::s_huge_page_size, 0); // NOLINT
+
+  // Untouched memory isn't backed by any pages yet, so the huge pages are only requested
+  const auto base_page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  BOOST_REQUIRE_EQUAL(transparent.page_size(), base_page_size);
+
+  // Once prefaulted, the huge page size is reported if the kernel honoured the advice
+  options.prefault = true;
+  PageAllocation prefaulted(1, options);
+  BOOST_REQUIRE(prefaulted.page_size() == base_page_size ||
+                prefaulted.page_size() == PageAllocation::s_huge_page_size);
+  BOOST_REQUIRE(prefaulted.page_size() == base_page_size || prefaulted.huge_pages_requested());
+  BOOST_TEST_MESSAGE("Transparent huge page allocation got pages of " << prefaulted.page_size() << " bytes");
+
+  // Explicit huge pages need a reserved pool; without one the allocation
+  // falls back to regular pages
+  options.huge_pages = PageAllocation::HugePages::kExplicit;
+  options.prefault = true;
+  PageAllocation explicit_pages(1, options);
+  BOOST_REQUIRE(explicit_pages.data() != nullptr);
+  BOOST_REQUIRE_GE(explicit_pages.size(), explicit_pages.page_size());
+  BOOST_TEST_MESSAGE("Explicit huge page allocation got pages of " << explicit_pages.page_size() << " bytes");
+}
+
+BOOST_AUTO_TEST_CASE(NUMAPlacement)
+{
+  const int numa_node = PageAllocation::current_numa_node();
+  BOOST_REQUIRE_GE(numa_node, 0);
+
+  PageAllocation::Options options;
+  options.numa_node = numa_node;
+  options.prefault = true;
+  PageAllocation memory(1, options);
+  BOOST_REQUIRE_EQUAL(memory.numa_node(), numa_node);
+
+  // Binding an allocation after the fact migrates it
+  PageAllocation unbound(1, PageAllocation::Options());
+  BOOST_REQUIRE_EQUAL(unbound.numa_node(), -1);
+  unbound.bind_to_numa_node(numa_node);
+  BOOST_REQUIRE_EQUAL(unbound.numa_node(), numa_node);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
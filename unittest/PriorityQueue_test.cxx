@@ -0,0 +1,175 @@
+/**
+ *
+ * @file PriorityQueue_test.cxx PriorityQueue class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/PriorityQueue.hpp"
+
+#define BOOST_TEST_MODULE PriorityQueue_test // NOLINT
+#include "boost/test/included/unit_test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Request
+{
+  bool urgent = false;
+  int id = 0;
+};
+
+} // namespace ""
+
+template<>
+struct dunedaq::appfwk::QueuePriority<Request>
+{
+  static size_t of(const Request& request) noexcept { return request.urgent ? 0 : 1; }
+};
+
+using namespace dunedaq::appfwk;
+
+BOOST_AUTO_TEST_SUITE(PriorityQueue_test)
+
+namespace {
+
+constexpr auto timeout = std::chrono::milliseconds(2);
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(UrgentFirst)
+{
+  PriorityQueue<Request> queue("PriorityQueue", 8, 2);
+  BOOST_REQUIRE_EQUAL(queue.get_num_lanes(), 2);
+  BOOST_REQUIRE_EQUAL(queue.get_capacity(), 16);
+
+  for (int i = 0; i < 4; ++i) {
+    queue.push(Request{ false, i }, timeout);
+  }
+  queue.push(Request{ true, 100 }, timeout);
+  queue.push(Request{ true, 101 }, timeout);
+  BOOST_REQUIRE_EQUAL(queue.get_lane_num_elements(0), 2);
+  BOOST_REQUIRE_EQUAL(queue.get_lane_num_elements(1), 4);
+  BOOST_REQUIRE_EQUAL(queue.get_num_elements(), 6);
+
+  // Urgent requests come out first, and each lane keeps its order
+  Request request;
+  for (int expected : { 100, 101, 0, 1, 2, 3 }) {
+    queue.pop(request, timeout);
+    BOOST_REQUIRE_EQUAL(request.id, expected);
+  }
+  BOOST_REQUIRE(!queue.try_pop(request, timeout));
+}
+
+BOOST_AUTO_TEST_CASE(PriorityOnPush)
+{
+  PriorityQueue<int> queue("PriorityQueue", 4, 3);
+
+  BOOST_REQUIRE(queue.try_push_with_priority(1, 2, timeout));
+  BOOST_REQUIRE(queue.try_push_with_priority(2, 1, timeout));
+  BOOST_REQUIRE(queue.try_push_with_priority(3, 0, timeout));
+  // Priorities past the last lane go to the last lane
+  BOOST_REQUIRE(queue.try_push_with_priority(4, 7, timeout));
+  BOOST_REQUIRE_EQUAL(queue.get_lane_num_elements(2), 2);
+
+  int value = 0;
+  for (int expected : { 3, 2, 1, 4 }) {
+    queue.pop(value, timeout);
+    BOOST_REQUIRE_EQUAL(value, expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LanesFillSeparately)
+{
+  PriorityQueue<int> queue("PriorityQueue", 2, 2);
+
+  BOOST_REQUIRE(queue.try_push_with_priority(1, 1, timeout));
+  BOOST_REQUIRE(queue.try_push_with_priority(2, 1, timeout));
+
+  // A full bulk lane doesn't hold up urgent elements
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(!queue.try_push_with_priority(3, 1, timeout));
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time >= timeout);
+  BOOST_REQUIRE(queue.try_push_with_priority(4, 0, timeout));
+
+  int value = 0;
+  queue.pop(value, timeout);
+  BOOST_REQUIRE_EQUAL(value, 4);
+  queue.pop(value, timeout);
+  BOOST_REQUIRE_EQUAL(value, 1);
+  BOOST_REQUIRE(queue.try_push_with_priority(3, 1, timeout));
+}
+
+BOOST_AUTO_TEST_CASE(Close)
+{
+  PriorityQueue<int> queue("PriorityQueue", 2, 2);
+  BOOST_REQUIRE(queue.try_push_with_priority(1, 1, timeout));
+  BOOST_REQUIRE(queue.try_push_with_priority(2, 0, timeout));
+  queue.close();
+
+  // Pushes fail straight away, and pops return what is left and then fail straight away
+  BOOST_REQUIRE_THROW(queue.push(3, timeout), QueueClosed);
+  int value = 0;
+  queue.pop(value, timeout);
+  BOOST_REQUIRE_EQUAL(value, 2);
+  queue.pop(value, timeout);
+  BOOST_REQUIRE_EQUAL(value, 1);
+  BOOST_REQUIRE_THROW(queue.pop(value, timeout), QueueClosed);
+
+  // A pop already waiting returns as soon as the queue is closed
+  queue.reopen();
+  std::thread closer([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.close();
+  });
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(!queue.try_pop(value, std::chrono::milliseconds(5000)));
+  closer.join();
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(1000));
+}
+
+BOOST_AUTO_TEST_CASE(ManyProducers)
+{
+  constexpr int n_producers = 3;
+  constexpr int n_per_producer = 20000;
+  PriorityQueue<int> queue("PriorityQueue", 64, 4);
+
+  std::atomic<int> failed_pushes{ 0 };
+  std::vector<std::thread> producers;
+  for (int p = 0; p < n_producers; ++p) {
+    producers.emplace_back([&, p]() {
+      for (int i = 0; i < n_per_producer; ++i) {
+        int value = p * n_per_producer + i;
+        if (!queue.try_push_with_priority(std::move(value), size_t(i % 4), std::chrono::milliseconds(1000))) {
+          ++failed_pushes;
+        }
+      }
+    });
+  }
+
+  std::vector<int> seen(n_producers * n_per_producer, 0);
+  int value = 0;
+  for (int i = 0; i < n_producers * n_per_producer; ++i) {
+    BOOST_REQUIRE(queue.try_pop(value, std::chrono::milliseconds(1000)));
+    ++seen[value];
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  BOOST_REQUIRE_EQUAL(failed_pushes.load(), 0);
+  BOOST_REQUIRE(!queue.try_pop(value, std::chrono::milliseconds(0)));
+  for (int count : seen) {
+    BOOST_REQUIRE_EQUAL(count, 1);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
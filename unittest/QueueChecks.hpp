@@ -0,0 +1,187 @@
+/**
+ * @file QueueChecks.hpp
+ *
+ * Checks which every Queue implementation has to pass, shared by the unit
+ * tests of the implementations. Include after the Boost.Test header.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef APPFWK_UNITTEST_QUEUECHECKS_HPP_
+#define APPFWK_UNITTEST_QUEUECHECKS_HPP_
+
+#include "appfwk/Queue.hpp"
+#include "appfwk/WaitPolicy.hpp"
+
+#include <chrono>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::appfwk::unittest {
+
+constexpr double fractional_timeout_tolerance =
+  0.5; ///< The fraction of the timeout which the timing is allowed to be off by
+
+/**
+ * @brief Check push_n() and pop_n() on an int Queue with a capacity below 15,
+ * which is emptied first
+ */
+template<class QueueType>
+void
+check_batches(QueueType& queue, const typename QueueType::duration_t& timeout)
+{
+  int popped_value = -999;
+  while (queue.can_pop()) {
+    queue.pop(popped_value, timeout);
+  }
+
+  std::vector<int> to_push(15);
+  std::iota(to_push.begin(), to_push.end(), 0);
+
+  // Only as many elements as the capacity allows should be pushed, without an exception
+  size_t num_pushed = queue.push_n(to_push.data(), to_push.size(), timeout);
+  BOOST_REQUIRE_EQUAL(num_pushed, queue.get_capacity());
+  BOOST_REQUIRE(!queue.can_push());
+  BOOST_CHECK_THROW(queue.push_n(&to_push[num_pushed], to_push.size() - num_pushed, timeout), QueueTimeoutExpired);
+
+  std::vector<int> popped(4, -999);
+  size_t num_popped = queue.pop_n(popped.data(), popped.size(), timeout);
+  BOOST_REQUIRE_EQUAL(num_popped, popped.size());
+  for (size_t i = 0; i < num_popped; ++i) {
+    BOOST_REQUIRE_EQUAL(popped[i], static_cast<int>(i));
+  }
+
+  // pop_n returns what is available rather than waiting for max_count elements
+  popped.resize(20);
+  num_popped = queue.pop_n(popped.data(), popped.size(), timeout);
+  BOOST_REQUIRE_EQUAL(num_popped, queue.get_capacity() - 4);
+  BOOST_REQUIRE_EQUAL(popped[0], 4);
+
+  BOOST_REQUIRE(!queue.can_pop());
+  BOOST_CHECK_THROW(queue.pop_n(popped.data(), popped.size(), timeout), QueueTimeoutExpired);
+}
+
+/**
+ * @brief Check that try_push() and try_pop() on an int Queue report timeouts
+ * through their return value, not an exception. The Queue is emptied first,
+ * and left full.
+ */
+template<class QueueType>
+void
+check_try_operations(QueueType& queue, const typename QueueType::duration_t& timeout)
+{
+  int popped_value = -999;
+  while (queue.can_pop()) {
+    queue.pop(popped_value, timeout);
+  }
+
+  BOOST_REQUIRE(!queue.try_pop(popped_value, std::chrono::milliseconds(0)));
+  BOOST_REQUIRE(!queue.try_pop(popped_value, timeout));
+  BOOST_REQUIRE_EQUAL(popped_value, -999);
+
+  BOOST_REQUIRE(queue.try_push(17, timeout));
+  BOOST_REQUIRE(queue.try_pop(popped_value, std::chrono::milliseconds(0)));
+  BOOST_REQUIRE_EQUAL(popped_value, 17);
+
+  int push_value = 0;
+  while (queue.try_push(std::move(push_value), std::chrono::milliseconds(0))) {
+    push_value++;
+  }
+  BOOST_REQUIRE_EQUAL(push_value, queue.get_capacity());
+  BOOST_REQUIRE(!queue.try_push(42, timeout));
+}
+
+/**
+ * @brief Check that closing an int Queue makes pushes fail, lets pops drain
+ * it, and wakes the pushes and pops already waiting. The Queue has to be
+ * empty, open and have a capacity of 2, and is left closed.
+ */
+template<class QueueType>
+void
+check_close(QueueType& queue, const typename QueueType::duration_t& timeout)
+{
+  queue.push(1, timeout);
+  queue.push(2, timeout);
+  queue.close();
+
+  // Pushes fail straight away, and pops return what is left and then fail straight away
+  BOOST_REQUIRE(queue.is_closed());
+  BOOST_REQUIRE_THROW(queue.push(3, timeout), QueueClosed);
+  int popped_value = -999;
+  queue.pop(popped_value, timeout);
+  BOOST_REQUIRE_EQUAL(popped_value, 1);
+  queue.pop(popped_value, timeout);
+  BOOST_REQUIRE_EQUAL(popped_value, 2);
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE_THROW(queue.pop(popped_value, std::chrono::milliseconds(5000)), QueueClosed);
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(1000));
+
+  // A pop already waiting, and a push already waiting, return as soon as the queue is closed
+  queue.reopen();
+  std::thread closer([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.close();
+  });
+  start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(!queue.try_pop(popped_value, std::chrono::milliseconds(5000)));
+  closer.join();
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(1000));
+
+  queue.reopen();
+  queue.push(1, timeout);
+  queue.push(2, timeout);
+  closer = std::thread([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.close();
+  });
+  start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(!queue.try_push(3, std::chrono::milliseconds(5000)));
+  closer.join();
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(1000));
+}
+
+/**
+ * @brief Check that an int Queue with a capacity of 2 times out, and wakes up
+ * when the other side makes progress, with each WaitPolicy
+ */
+template<class QueueType>
+void
+check_wait_policies(const std::string& name, const typename QueueType::duration_t& timeout)
+{
+  for (auto policy : { WaitPolicy::kBlock, WaitPolicy::kSpin, WaitPolicy::kSpinYield, WaitPolicy::kSpinPark }) {
+    QueueType queue(name, 2, policy);
+
+    // Every policy has to wait for the timeout, and then give up. The spinning
+    // policies may overrun a little more than the others when cores are scarce
+    int popped_value = -999;
+    auto start_time = std::chrono::steady_clock::now();
+    BOOST_REQUIRE(!queue.try_pop(popped_value, timeout));
+    double fraction = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time) / timeout;
+    BOOST_CHECK_GT(fraction, 1 - fractional_timeout_tolerance);
+    BOOST_CHECK_LT(fraction, 10);
+
+    // ...and has to wake up when the other side makes progress
+    constexpr int num_elements = 100;
+    std::thread producer([&]() {
+      for (int i = 0; i < num_elements; ++i) {
+        queue.push(int(i), std::chrono::milliseconds(1000));
+      }
+    });
+    for (int i = 0; i < num_elements; ++i) {
+      queue.pop(popped_value, std::chrono::milliseconds(1000));
+      if (popped_value != i) {
+        BOOST_REQUIRE_EQUAL(popped_value, i);
+      }
+    }
+    producer.join();
+  }
+}
+
+} // namespace dunedaq::appfwk::unittest
+
+#endif // APPFWK_UNITTEST_QUEUECHECKS_HPP_
@@ -12,9 +12,13 @@
 
 #include "boost/test/unit_test.hpp"
 
+#include <chrono>
 #include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 BOOST_AUTO_TEST_SUITE(QueueRegistry_test)
 
@@ -36,8 +40,25 @@ BOOST_AUTO_TEST_CASE(Configure)
   qc.kind = QueueConfig::kFollyMPMCQueue;
   qc.capacity = 10;
   test_map["test_queue_fmpmc"] = qc;
+  qc.kind = QueueConfig::kSPSCRingQueue;
+  qc.capacity = 10;
+  test_map["test_queue_spscring"] = qc;
+  qc.capacity_bytes = 3 * sizeof(int);
+  test_map["test_queue_capacity_bytes"] = qc;
+  qc.kind = QueueConfig::kFollyMPMCQueue;
+  test_map["test_queue_fmpmc_capacity_bytes"] = qc;
+  qc.capacity_bytes = 0;
+  qc.credits = 5;
+  test_map["test_queue_credits"] = qc;
+  qc.kind = QueueConfig::kBroadcastQueue;
+  test_map["test_queue_broadcast_credits"] = qc;
 
-  QueueRegistry::get().configure(test_map);
+  std::map<std::string, PoolConfig> pool_map;
+  PoolConfig pc;
+  pc.count = 10;
+  pool_map["test_pool"] = pc;
+
+  QueueRegistry::get().configure(test_map, pool_map);
 
   BOOST_REQUIRE_EXCEPTION(
     QueueRegistry::get().configure(test_map), QueueRegistryConfigured, [&](QueueRegistryConfigured) { return true; });
@@ -48,7 +69,51 @@ BOOST_AUTO_TEST_CASE(StoQK)
   BOOST_REQUIRE_EQUAL(QueueConfig::stoqk("StdDeQueue"), QueueConfig::kStdDeQueue);
   BOOST_REQUIRE_EQUAL(QueueConfig::stoqk("FollySPSCQueue"), QueueConfig::kFollySPSCQueue);
   BOOST_REQUIRE_EQUAL(QueueConfig::stoqk("FollyMPMCQueue"), QueueConfig::kFollyMPMCQueue);
+  BOOST_REQUIRE_EQUAL(QueueConfig::stoqk("SPSCRingQueue"), QueueConfig::kSPSCRingQueue);
+  BOOST_REQUIRE_EQUAL(QueueConfig::stoqk("BroadcastQueue"), QueueConfig::kBroadcastQueue);
+  BOOST_REQUIRE_EQUAL(QueueConfig::stoqk("PriorityQueue"), QueueConfig::kPriorityQueue);
+  BOOST_REQUIRE_EQUAL(QueueConfig::stoqk("SharedMemoryQueue"), QueueConfig::kSharedMemoryQueue);
+  BOOST_REQUIRE_EQUAL(QueueConfig::stoqk("ElasticQueue"), QueueConfig::kElasticQueue);
   BOOST_REQUIRE_EXCEPTION(QueueConfig::stoqk("blahblahblah"), QueueKindUnknown, [&](QueueKindUnknown) { return true; });
+
+  for (auto kind : { QueueConfig::kStdDeQueue, QueueConfig::kSPSCRingQueue, QueueConfig::kElasticQueue }) {
+    BOOST_REQUIRE_EQUAL(QueueConfig::stoqk(QueueConfig::qktos(kind)), kind);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SelectKind)
+{
+  QueueConfig qc;
+  BOOST_REQUIRE_EQUAL(QueueConfig::select_kind(1, 1, qc), QueueConfig::kSPSCRingQueue);
+  BOOST_REQUIRE_EQUAL(QueueConfig::select_kind(3, 1, qc), QueueConfig::kFollyMPMCQueue);
+  BOOST_REQUIRE_EQUAL(QueueConfig::select_kind(1, 3, qc), QueueConfig::kFollyMPMCQueue);
+  // Endpoints which aren't declared may be any number
+  BOOST_REQUIRE_EQUAL(QueueConfig::select_kind(1, 0, qc), QueueConfig::kFollyMPMCQueue);
+
+  // The Folly queues can't honour these
+  qc.capacity_bytes = 1024;
+  BOOST_REQUIRE_EQUAL(QueueConfig::select_kind(3, 1, qc), QueueConfig::kStdDeQueue);
+  qc.capacity_bytes = 0;
+  qc.numa_node = 0;
+  BOOST_REQUIRE_EQUAL(QueueConfig::select_kind(3, 1, qc), QueueConfig::kStdDeQueue);
+  BOOST_REQUIRE_EQUAL(QueueConfig::select_kind(1, 1, qc), QueueConfig::kSPSCRingQueue);
+}
+
+BOOST_AUTO_TEST_CASE(StoWP)
+{
+  BOOST_REQUIRE(QueueConfig::stowp("Block") == WaitPolicy::kBlock);
+  BOOST_REQUIRE(QueueConfig::stowp("Spin") == WaitPolicy::kSpin);
+  BOOST_REQUIRE(QueueConfig::stowp("SpinYield") == WaitPolicy::kSpinYield);
+  BOOST_REQUIRE(QueueConfig::stowp("SpinPark") == WaitPolicy::kSpinPark);
+  BOOST_REQUIRE_EXCEPTION(QueueConfig::stowp("blahblahblah"), WaitPolicyUnknown, [&](WaitPolicyUnknown) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(DefaultWaitPolicy)
+{
+  // A StdDeQueue made from a configuration which doesn't set a policy sleeps straight away, as it always has
+  BOOST_REQUIRE(!QueueConfig().wait_policy);
+  BOOST_REQUIRE(QueueConfig::default_wait_policy(QueueConfig::kStdDeQueue) == WaitPolicy::kBlock);
+  BOOST_REQUIRE(QueueConfig::default_wait_policy(QueueConfig::kSPSCRingQueue) == WaitPolicy::kSpinPark);
 }
 
 BOOST_AUTO_TEST_CASE(GatherStats)
@@ -72,9 +137,126 @@ BOOST_AUTO_TEST_CASE(CreateQueue)
   BOOST_REQUIRE(queue_ptr_fspsc != nullptr);
   auto queue_ptr_fmpmc = QueueRegistry::get().get_queue<int>("test_queue_fmpmc");
   BOOST_REQUIRE(queue_ptr_fmpmc != nullptr);
+  auto queue_ptr_spscring = QueueRegistry::get().get_queue<int>("test_queue_spscring");
+  BOOST_REQUIRE(queue_ptr_spscring != nullptr);
   BOOST_REQUIRE_EXCEPTION(QueueRegistry::get().get_queue<int>("test_queue_unknown"),
                           QueueKindUnknown,
                           [&](QueueKindUnknown) { return true; });
 }
 
+BOOST_AUTO_TEST_CASE(CapacityBytes)
+{
+  const MemoryUsage before = QueueRegistry::get().get_memory_usage();
+
+  // The capacity in bytes is reached before the capacity in elements
+  auto queue_ptr = QueueRegistry::get().get_queue<int>("test_queue_capacity_bytes");
+  for (int i = 0; i < 3; ++i) {
+    queue_ptr->push(std::move(i), std::chrono::milliseconds(1));
+  }
+  BOOST_REQUIRE(!queue_ptr->try_push(3, std::chrono::milliseconds(1)));
+
+  const MemoryUsage after = QueueRegistry::get().get_memory_usage();
+  BOOST_REQUIRE_EQUAL(after.queue_bytes - before.queue_bytes, 3 * sizeof(int));
+  BOOST_REQUIRE_EQUAL(after.queue_capacity_bytes - before.queue_capacity_bytes, 3 * sizeof(int));
+  BOOST_REQUIRE_EQUAL(after.unlimited_queues, before.unlimited_queues);
+  BOOST_REQUIRE(after.queue_bytes_high_water >= after.queue_bytes);
+
+  BOOST_REQUIRE_EXCEPTION(QueueRegistry::get().get_queue<int>("test_queue_fmpmc_capacity_bytes"),
+                          QueueCapacityBytesUnsupported,
+                          [&](QueueCapacityBytesUnsupported) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(Credits)
+{
+  auto queue_ptr = QueueRegistry::get().get_queue<int>("test_queue_credits");
+  BOOST_REQUIRE(queue_ptr->uses_credits());
+  BOOST_REQUIRE_EQUAL(queue_ptr->get_credits(), 5);
+  BOOST_REQUIRE(!QueueRegistry::get().get_queue<int>("test_queue_stddeque")->uses_credits());
+
+  BOOST_REQUIRE_EXCEPTION(QueueRegistry::get().get_queue<int>("test_queue_broadcast_credits"),
+                          QueueCreditsUnsupported,
+                          [&](QueueCreditsUnsupported) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(GetQueueAsKind)
+{
+  auto queue_ptr_spscring = QueueRegistry::get().get_queue<int, SPSCRingQueue>("test_queue_spscring");
+  BOOST_REQUIRE(queue_ptr_spscring != nullptr);
+  auto queue_ptr_fspsc = QueueRegistry::get().get_queue<int, FollySPSCQueue>("test_queue_fspsc");
+  BOOST_REQUIRE(queue_ptr_fspsc != nullptr);
+  BOOST_REQUIRE_EXCEPTION((QueueRegistry::get().get_queue<int, StdDeQueue>("test_queue_spscring")),
+                          QueueKindMismatch,
+                          [&](QueueKindMismatch) { return true; });
+  BOOST_REQUIRE_EXCEPTION((QueueRegistry::get().get_queue<int, FollyMPMCQueue>("test_queue_fspsc")),
+                          QueueKindMismatch,
+                          [&](QueueKindMismatch) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(GetPool)
+{
+  auto pool_ptr = QueueRegistry::get().get_pool<std::string>("test_pool");
+  BOOST_REQUIRE(pool_ptr != nullptr);
+  BOOST_REQUIRE_EQUAL(pool_ptr->get_capacity(), 10);
+  BOOST_REQUIRE_EQUAL(QueueRegistry::get().get_pool<std::string>("test_pool"), pool_ptr);
+
+  BOOST_REQUIRE_EXCEPTION(
+    QueueRegistry::get().get_pool<int>("test_pool"), PoolTypeMismatch, [&](PoolTypeMismatch) { return true; });
+  BOOST_REQUIRE_EXCEPTION(
+    QueueRegistry::get().get_pool<int>("no_such_pool"), PoolNotFound, [&](PoolNotFound) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentGetQueue)
+{
+  QueueRegistry::reset();
+
+  constexpr int num_queues = 100;
+  constexpr int num_threads = 8;
+
+  std::map<std::string, QueueConfig> test_map;
+  QueueConfig qc;
+  qc.kind = QueueConfig::kStdDeQueue;
+  qc.capacity = 10;
+  for (int i = 0; i < num_queues; ++i) {
+    test_map["concurrent_queue_" + std::to_string(i)] = qc;
+  }
+  QueueRegistry::get().configure(test_map);
+
+  std::vector<std::vector<std::shared_ptr<Queue<int>>>> resolved(num_threads);
+  std::vector<std::thread> threads;
+  for (int i_t = 0; i_t < num_threads; ++i_t) {
+    threads.emplace_back([&, i_t]() {
+      for (int i_q = 0; i_q < num_queues; ++i_q) {
+        resolved[i_t].push_back(QueueRegistry::get().get_queue<int>("concurrent_queue_" + std::to_string(i_q)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int i_t = 1; i_t < num_threads; ++i_t) {
+    BOOST_REQUIRE(resolved[i_t] == resolved[0]);
+  }
+  BOOST_REQUIRE_EXCEPTION(QueueRegistry::get().get_queue<double>("concurrent_queue_0"),
+                          QueueTypeMismatch,
+                          [&](QueueTypeMismatch) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(ResizeQueue)
+{
+  // The queue is resized in place, so handles to it stay valid
+  auto queue_ptr = QueueRegistry::get().get_queue<int>("concurrent_queue_0");
+  queue_ptr->push(42, std::chrono::milliseconds(1));
+  QueueRegistry::get().resize_queue("concurrent_queue_0", 30);
+  BOOST_REQUIRE_EQUAL(queue_ptr->get_capacity(), 30);
+  BOOST_REQUIRE_EQUAL(queue_ptr->get_num_elements(), 1);
+
+  BOOST_REQUIRE_EXCEPTION(QueueRegistry::get().resize_queue("concurrent_queue_0", 0),
+                          QueueResizeFailed,
+                          [&](QueueResizeFailed) { return true; });
+  BOOST_REQUIRE_EXCEPTION(QueueRegistry::get().resize_queue("no_such_queue", 10),
+                          QueueResizeFailed,
+                          [&](QueueResizeFailed) { return true; });
+}
+
 BOOST_AUTO_TEST_SUITE_END()
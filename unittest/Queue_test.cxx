@@ -29,8 +29,8 @@ namespace queuetest {
         : Queue<T>(name)
       {}
 
-      void push(T&& , const std::chrono::milliseconds& ) override {}
-      void pop(T& , const std::chrono::milliseconds& ) override {}
+      bool try_push(T&& , const std::chrono::milliseconds& ) override { return true; }
+      bool try_pop(T& , const std::chrono::milliseconds& ) override { return true; }
       size_t get_capacity() const override { return 1; }
       size_t get_num_elements() const override { return 0; }
     };
@@ -45,6 +45,8 @@ BOOST_AUTO_TEST_CASE(QueueOperations) {
   queue_ptr->push(15, std::chrono::milliseconds(1));
   int pop_value;
   queue_ptr->pop(pop_value, std::chrono::milliseconds(1));
+  BOOST_REQUIRE(queue_ptr->try_push(15, std::chrono::milliseconds(1)));
+  BOOST_REQUIRE(queue_ptr->try_pop(pop_value, std::chrono::milliseconds(1)));
 }
 
 BOOST_AUTO_TEST_SUITE_END()
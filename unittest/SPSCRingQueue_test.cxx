@@ -0,0 +1,350 @@
+/**
+ *
+ * @file SPSCRingQueue_test.cxx SPSCRingQueue class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/SPSCRingQueue.hpp"
+
+#define BOOST_TEST_MODULE SPSCRingQueue_test // NOLINT
+#include "boost/test/included/unit_test.hpp"
+
+#include "QueueChecks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(SPSCRingQueue_test)
+
+// For a first look at the code, you may want to skip past the
+// contents of the unnamed namespace and move ahead to the actual test
+// cases
+
+namespace {
+
+constexpr double fractional_timeout_tolerance =
+  0.5; ///< The fraction of the timeout which the timing is allowed to be off by
+
+/**
+ * @brief Timeout to use for tests
+ *
+ * Don't set the timeout to zero, otherwise the tests will fail since they'd
+ * expect the push/pop functions to execute instananeously
+ */
+constexpr auto timeout = std::chrono::milliseconds(2);
+
+// Deliberately not a power of two, to check that the capacity is honoured exactly
+dunedaq::appfwk::SPSCRingQueue<int> queue("SPSCRingQueue", 10); ///< Queue instance for the test
+
+double
+fraction_of_timeout_used(std::chrono::steady_clock::duration duration)
+{
+  return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()) /
+         std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+}
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(sanity_checks)
+{
+  BOOST_REQUIRE(!queue.can_pop());
+  BOOST_REQUIRE_EQUAL(queue.get_capacity(), 10);
+  BOOST_REQUIRE_EQUAL(queue.get_num_elements(), 0);
+
+  BOOST_REQUIRE(queue.can_push());
+  queue.push(42, timeout);
+  BOOST_REQUIRE(queue.can_pop());
+  BOOST_REQUIRE_EQUAL(queue.get_num_elements(), 1);
+
+  int popped_value = -999;
+  queue.pop(popped_value, timeout);
+  BOOST_REQUIRE_EQUAL(popped_value, 42);
+  BOOST_REQUIRE_EQUAL(queue.get_num_elements(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(empty_checks, *boost::unit_test::depends_on("SPSCRingQueue_test/sanity_checks"))
+{
+  int popped_value = -999;
+  BOOST_REQUIRE(!queue.can_pop());
+  BOOST_REQUIRE(!queue.try_pop(popped_value, std::chrono::milliseconds(0)));
+
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_CHECK_THROW(queue.pop(popped_value, timeout), dunedaq::appfwk::QueueTimeoutExpired);
+  auto fraction = fraction_of_timeout_used(std::chrono::steady_clock::now() - start_time);
+
+  BOOST_TEST_MESSAGE("Attempted pop_duration divided by timeout is " << fraction);
+  BOOST_CHECK_GT(fraction, 1 - fractional_timeout_tolerance);
+  BOOST_CHECK_LT(fraction, 1 + fractional_timeout_tolerance);
+}
+
+BOOST_AUTO_TEST_CASE(full_checks, *boost::unit_test::depends_on("SPSCRingQueue_test/empty_checks"))
+{
+  int push_value = 0;
+  while (queue.can_push()) {
+    queue.push(std::move(push_value), timeout);
+    push_value++;
+  }
+  BOOST_REQUIRE_EQUAL(push_value, queue.get_capacity());
+  BOOST_REQUIRE(!queue.try_push(99, std::chrono::milliseconds(0)));
+
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_CHECK_THROW(queue.push(99, timeout), dunedaq::appfwk::QueueTimeoutExpired);
+  auto fraction = fraction_of_timeout_used(std::chrono::steady_clock::now() - start_time);
+
+  BOOST_TEST_MESSAGE("Attempted push_duration divided by timeout is " << fraction);
+  BOOST_CHECK_GT(fraction, 1 - fractional_timeout_tolerance);
+  BOOST_CHECK_LT(fraction, 1 + fractional_timeout_tolerance);
+
+  int popped_value = -999;
+  for (int i = 0; i < push_value; ++i) {
+    BOOST_REQUIRE(queue.try_pop(popped_value, timeout));
+    BOOST_REQUIRE_EQUAL(popped_value, i);
+  }
+  BOOST_REQUIRE(!queue.can_pop());
+}
+
+BOOST_AUTO_TEST_CASE(batch_checks, *boost::unit_test::depends_on("SPSCRingQueue_test/full_checks"))
+{
+  dunedaq::appfwk::unittest::check_batches(queue, timeout);
+}
+
+BOOST_AUTO_TEST_CASE(non_trivial_elements)
+{
+  dunedaq::appfwk::SPSCRingQueue<std::unique_ptr<std::string>> ptr_queue("PtrQueue", 3);
+
+  ptr_queue.push(std::make_unique<std::string>("hello"), timeout);
+  ptr_queue.push(std::make_unique<std::string>("world"), timeout);
+
+  std::unique_ptr<std::string> popped;
+  ptr_queue.pop(popped, timeout);
+  BOOST_REQUIRE(popped != nullptr);
+  BOOST_REQUIRE_EQUAL(*popped, "hello");
+
+  // The remaining element is released by the queue's destructor
+}
+
+BOOST_AUTO_TEST_CASE(in_place_checks)
+{
+  dunedaq::appfwk::SPSCRingQueue<std::string> string_queue("StringQueue", 2);
+  BOOST_REQUIRE(string_queue.supports_slots());
+
+  void* raw = string_queue.try_reserve_slot(timeout);
+  BOOST_REQUIRE(raw != nullptr);
+  new (raw) std::string("in place");
+  BOOST_REQUIRE_EQUAL(string_queue.get_num_elements(), 0);
+  string_queue.commit_slot();
+  BOOST_REQUIRE_EQUAL(string_queue.get_num_elements(), 1);
+
+  // A cancelled reservation leaves the queue untouched
+  BOOST_REQUIRE(string_queue.try_reserve_slot(timeout) != nullptr);
+  string_queue.cancel_slot();
+  BOOST_REQUIRE_EQUAL(string_queue.get_num_elements(), 1);
+
+  string_queue.push(std::string("pushed"), timeout);
+  BOOST_REQUIRE(string_queue.try_reserve_slot(std::chrono::milliseconds(0)) == nullptr);
+
+  std::string* peeked = string_queue.try_peek(timeout);
+  BOOST_REQUIRE(peeked != nullptr);
+  BOOST_REQUIRE_EQUAL(*peeked, "in place");
+  BOOST_REQUIRE_EQUAL(string_queue.try_peek(timeout), peeked);
+  string_queue.release_peeked();
+
+  std::string popped;
+  string_queue.pop(popped, timeout);
+  BOOST_REQUIRE_EQUAL(popped, "pushed");
+  BOOST_REQUIRE(string_queue.try_peek(std::chrono::milliseconds(0)) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(producer_consumer)
+{
+  constexpr int num_elements = 100000;
+  dunedaq::appfwk::SPSCRingQueue<int> threaded_queue("ThreadedQueue", 64);
+
+  std::thread producer([&]() {
+    for (int i = 0; i < num_elements; ++i) {
+      threaded_queue.push(int(i), std::chrono::milliseconds(1000));
+    }
+  });
+
+  int expected = 0;
+  int popped_value = -1;
+  while (expected < num_elements) {
+    BOOST_REQUIRE(threaded_queue.try_pop(popped_value, std::chrono::milliseconds(1000)));
+    if (popped_value != expected) {
+      BOOST_REQUIRE_EQUAL(popped_value, expected);
+    }
+    ++expected;
+  }
+  producer.join();
+  BOOST_REQUIRE(!threaded_queue.can_pop());
+}
+
+BOOST_AUTO_TEST_CASE(follow_consumer)
+{
+  dunedaq::appfwk::SPSCRingQueue<int> numa_queue("NUMAQueue", 4);
+  numa_queue.follow_consumer();
+  BOOST_REQUIRE_EQUAL(numa_queue.get_numa_node(), -1);
+
+  numa_queue.push(1, timeout);
+  BOOST_REQUIRE_EQUAL(numa_queue.get_numa_node(), -1);
+
+  // The consumer notes its node on its first pop, and the storage moves there at the next monitoring call
+  int numa_node = -1;
+  std::thread consumer([&]() {
+    int popped_value = -999;
+    numa_queue.pop(popped_value, timeout);
+    numa_node = dunedaq::appfwk::PageAllocation::current_numa_node();
+  });
+  consumer.join();
+  BOOST_REQUIRE_EQUAL(numa_queue.get_numa_node(), -1);
+  dunedaq::opmonlib::InfoCollector ci;
+  numa_queue.get_info(ci, 0);
+  BOOST_REQUIRE_EQUAL(numa_queue.get_numa_node(), numa_node);
+}
+
+BOOST_AUTO_TEST_CASE(wait_policies)
+{
+  dunedaq::appfwk::unittest::check_wait_policies<dunedaq::appfwk::SPSCRingQueue<int>>("SPSCRingQueue", timeout);
+}
+
+BOOST_AUTO_TEST_CASE(close_checks)
+{
+  using dunedaq::appfwk::WaitPolicy;
+  for (auto policy : { WaitPolicy::kBlock, WaitPolicy::kSpin, WaitPolicy::kSpinYield, WaitPolicy::kSpinPark }) {
+    dunedaq::appfwk::SPSCRingQueue<int> close_queue("SPSCRingQueue", 2, policy);
+    dunedaq::appfwk::unittest::check_close(close_queue, timeout);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(resize_checks)
+{
+  dunedaq::appfwk::SPSCRingQueue<int> resize_queue("resize_queue", 2);
+  resize_queue.push(1, timeout);
+  resize_queue.push(2, timeout);
+
+  BOOST_REQUIRE(!resize_queue.resize(0));
+  BOOST_REQUIRE(!resize_queue.resize(1)); // Holds more elements than that
+
+  // Growing past the ring moves the producer to a larger one when it finds the queue full; the elements in the
+  // smaller ring are popped first
+  BOOST_REQUIRE(resize_queue.resize(5));
+  BOOST_REQUIRE_EQUAL(resize_queue.get_capacity(), 5);
+  for (int i = 3; i <= 5; ++i) {
+    resize_queue.push(std::move(i), timeout);
+  }
+  BOOST_REQUIRE(!resize_queue.try_push(6, timeout));
+
+  // Another resize while the consumer is still in the smaller ring can only move the limit within the larger one
+  BOOST_REQUIRE(!resize_queue.resize(20));
+  BOOST_REQUIRE(resize_queue.resize(8));
+  resize_queue.push(6, timeout);
+
+  int popped_value = 0;
+  for (int i = 1; i <= 6; ++i) {
+    resize_queue.pop(popped_value, timeout);
+    BOOST_REQUIRE_EQUAL(popped_value, i);
+  }
+
+  // Once the consumer has followed, the smaller ring is freed and the queue can grow again
+  BOOST_REQUIRE(resize_queue.resize(20));
+  std::vector<int> to_push(20);
+  std::iota(to_push.begin(), to_push.end(), 0);
+  BOOST_REQUIRE_EQUAL(resize_queue.push_n(to_push.data(), to_push.size(), timeout), 20);
+  BOOST_REQUIRE(!resize_queue.resize(3));
+
+  // Growing and shrinking while a producer and a consumer run keeps every element, in order
+  constexpr int num_elements = 100000;
+  std::thread producer([&]() {
+    for (int i = 0; i < num_elements; ++i) {
+      resize_queue.push(std::move(i), std::chrono::milliseconds(5000));
+    }
+  });
+  std::thread resizer([&]() {
+    for (size_t capacity = 30; capacity < 3000; capacity *= 2) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      resize_queue.resize(capacity);
+    }
+  });
+
+  for (int i = 0; i < 20; ++i) {
+    resize_queue.pop(popped_value, timeout);
+    BOOST_REQUIRE_EQUAL(popped_value, i);
+  }
+  for (int i = 0; i < num_elements; ++i) {
+    resize_queue.pop(popped_value, std::chrono::milliseconds(5000));
+    BOOST_REQUIRE_EQUAL(popped_value, i);
+  }
+  producer.join();
+  resizer.join();
+}
+
+BOOST_AUTO_TEST_CASE(byte_checks)
+{
+  // Strings hold their characters outside the queue; count them
+  struct Message
+  {
+    std::string text;
+    size_t payload_size() const noexcept { return sizeof(Message) + text.capacity(); }
+  };
+  constexpr size_t capacity_bytes = 64 * 1024;
+  dunedaq::appfwk::SPSCRingQueue<Message> byte_queue("byte_queue", 1000);
+  byte_queue.set_capacity_bytes(capacity_bytes);
+
+  // The producer is held back by the bytes rather than the elements, and the consumer sees all of them
+  constexpr int num_elements = 10000;
+  std::thread producer([&]() {
+    for (int i = 0; i < num_elements; ++i) {
+      byte_queue.push(Message{ std::string(1000 + i % 1000, 'x') }, std::chrono::milliseconds(5000));
+    }
+  });
+
+  size_t max_elements = 0;
+  Message popped;
+  for (int i = 0; i < num_elements; ++i) {
+    max_elements = std::max(max_elements, byte_queue.get_num_elements());
+    byte_queue.pop(popped, std::chrono::milliseconds(5000));
+    BOOST_REQUIRE_EQUAL(popped.text.size(), static_cast<size_t>(1000 + i % 1000));
+  }
+  producer.join();
+
+  // A push may take the queue over the limit by one element
+  const size_t max_message_bytes = sizeof(Message) + 4096;
+  BOOST_REQUIRE(max_elements < byte_queue.get_capacity());
+  BOOST_REQUIRE(byte_queue.get_bytes_high_water() <= capacity_bytes + max_message_bytes);
+  BOOST_REQUIRE_EQUAL(byte_queue.get_bytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(byte_checks_after_peek)
+{
+  struct Message
+  {
+    std::string text;
+    size_t payload_size() const noexcept { return sizeof(Message) + text.size(); }
+  };
+  dunedaq::appfwk::SPSCRingQueue<Message> byte_queue("byte_queue", 4);
+
+  // Elements leave with the bytes they were pushed with, whatever the consumer does to them in place
+  byte_queue.push(Message{ std::string(100, 'x') }, timeout);
+  byte_queue.push(Message{ std::string(100, 'y') }, timeout);
+  Message* element = byte_queue.try_peek(timeout);
+  BOOST_REQUIRE(element != nullptr);
+  element->text.append(1000, 'z');
+  byte_queue.release_peeked();
+  BOOST_REQUIRE_EQUAL(byte_queue.get_bytes(), sizeof(Message) + 100);
+  element = byte_queue.try_peek(timeout);
+  BOOST_REQUIRE(element != nullptr);
+  element->text.clear();
+  byte_queue.release_peeked();
+  BOOST_REQUIRE_EQUAL(byte_queue.get_bytes(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+/**
+ *
+ * @file SharedMemoryQueue_test.cxx SharedMemoryQueue class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "appfwk/SharedMemoryQueue.hpp"
+
+#define BOOST_TEST_MODULE SharedMemoryQueue_test // NOLINT
+#include "boost/test/included/unit_test.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(SharedMemoryQueue_test)
+
+// For a first look at the code, you may want to skip past the
+// contents of the unnamed namespace and move ahead to the actual test
+// cases
+
+namespace {
+
+constexpr auto timeout = std::chrono::milliseconds(2);
+
+/**
+ * @brief A fixed-size payload, as would typically be passed between processes
+ */
+struct Fragment
+{
+  uint64_t sequence; // NOLINT(build/unsigned)
+  char data[56];
+};
+
+/**
+ * @brief Queue names unique to this test process, so that concurrent test runs don't share segments
+ */
+std::string
+unique_name(const std::string& name)
+{
+  return name + "_" + std::to_string(getpid());
+}
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(sanity_checks)
+{
+  dunedaq::appfwk::SharedMemoryQueue<int> queue(unique_name("sanity"), 10);
+
+  BOOST_REQUIRE(!queue.can_pop());
+  BOOST_REQUIRE_EQUAL(queue.get_capacity(), 10);
+  BOOST_REQUIRE_EQUAL(queue.get_num_elements(), 0);
+
+  queue.push(42, timeout);
+  BOOST_REQUIRE(queue.can_pop());
+  BOOST_REQUIRE_EQUAL(queue.get_num_elements(), 1);
+
+  int popped_value = -999;
+  queue.pop(popped_value, timeout);
+  BOOST_REQUIRE_EQUAL(popped_value, 42);
+
+  for (int i = 0; i < 10; ++i) {
+    queue.push(std::move(i), timeout);
+  }
+  BOOST_REQUIRE(!queue.can_push());
+  BOOST_REQUIRE_THROW(queue.push(10, timeout), dunedaq::appfwk::QueueTimeoutExpired);
+}
+
+BOOST_AUTO_TEST_CASE(attach_checks)
+{
+  const std::string name = unique_name("attach");
+  auto producer = std::make_unique<dunedaq::appfwk::SharedMemoryQueue<int>>(name, 4);
+  producer->push(1, timeout);
+  producer->push(2, timeout);
+
+  // A second instance maps the same segment, and sees the elements already pushed
+  auto consumer = std::make_unique<dunedaq::appfwk::SharedMemoryQueue<int>>(name, 4);
+  BOOST_REQUIRE_EQUAL(consumer->get_num_elements(), 2);
+  int popped_value = -999;
+  consumer->pop(popped_value, timeout);
+  BOOST_REQUIRE_EQUAL(popped_value, 1);
+  BOOST_REQUIRE_EQUAL(producer->get_num_elements(), 1);
+
+  BOOST_REQUIRE_THROW(dunedaq::appfwk::SharedMemoryQueue<int>(name, 3), dunedaq::appfwk::SharedMemoryQueueMismatch);
+  // Another capacity is reported as such, even when it makes for a segment of another size
+  BOOST_REQUIRE_THROW(dunedaq::appfwk::SharedMemoryQueue<int>(name, 100), dunedaq::appfwk::SharedMemoryQueueMismatch);
+  BOOST_REQUIRE_THROW(dunedaq::appfwk::SharedMemoryQueue<float>(name, 4), dunedaq::appfwk::SharedMemoryQueueMismatch);
+
+  // Either instance keeps the segment alive; the last one removes it
+  producer.reset();
+  consumer->pop(popped_value, timeout);
+  BOOST_REQUIRE_EQUAL(popped_value, 2);
+  consumer->push(3, timeout);
+  consumer.reset();
+
+  dunedaq::appfwk::SharedMemoryQueue<int> fresh(name, 4);
+  BOOST_REQUIRE_EQUAL(fresh.get_num_elements(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(interprocess_checks)
+{
+  constexpr uint64_t num_fragments = 100000; // NOLINT(build/unsigned)
+  const std::string name = unique_name("interprocess");
+
+  // The consumer is created first and parks, so that the producer process has to wake it through the futex
+  dunedaq::appfwk::SharedMemoryQueue<Fragment> consumer(name, 64, dunedaq::appfwk::WaitPolicy::kBlock);
+
+  const pid_t child = fork();
+  BOOST_REQUIRE(child >= 0);
+  if (child == 0) {
+    int status = 0;
+    try {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      dunedaq::appfwk::SharedMemoryQueue<Fragment> producer(name, 64, dunedaq::appfwk::WaitPolicy::kBlock);
+      for (uint64_t i = 0; i < num_fragments; ++i) { // NOLINT(build/unsigned)
+        Fragment fragment{ i, {} };
+        fragment.data[i % sizeof(fragment.data)] = 1;
+        producer.push(std::move(fragment), std::chrono::seconds(10));
+      }
+    } catch (...) {
+      status = 1;
+    }
+    _exit(status);
+  }
+
+  uint64_t mismatches = 0; // NOLINT(build/unsigned)
+  for (uint64_t i = 0; i < num_fragments; ++i) { // NOLINT(build/unsigned)
+    Fragment fragment;
+    consumer.pop(fragment, std::chrono::seconds(10));
+    if (fragment.sequence != i || fragment.data[i % sizeof(fragment.data)] != 1) {
+      ++mismatches;
+    }
+  }
+  BOOST_REQUIRE_EQUAL(mismatches, 0);
+
+  int status = -1;
+  BOOST_REQUIRE_EQUAL(waitpid(child, &status, 0), child);
+  BOOST_REQUIRE(WIFEXITED(status));
+  BOOST_REQUIRE_EQUAL(WEXITSTATUS(status), 0);
+  BOOST_REQUIRE(!consumer.can_pop());
+}
+
+BOOST_AUTO_TEST_CASE(close_checks)
+{
+  dunedaq::appfwk::SharedMemoryQueue<int> queue(unique_name("close"), 4, dunedaq::appfwk::WaitPolicy::kBlock);
+
+  std::thread closer([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.close();
+  });
+  int popped_value = -999;
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(!queue.try_pop(popped_value, std::chrono::seconds(10)));
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time < std::chrono::seconds(5));
+  closer.join();
+  BOOST_REQUIRE(queue.is_closed());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,7 +12,12 @@
 #define BOOST_TEST_MODULE StdDeQueue_test // NOLINT
 #include "boost/test/included/unit_test.hpp"
 
+#include "QueueChecks.hpp"
+
 #include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
 
 BOOST_AUTO_TEST_SUITE(StdDeQueue_test)
 
@@ -40,6 +45,15 @@ constexpr auto timeout = std::chrono::milliseconds(2);
 constexpr auto timeout_in_us = std::chrono::duration_cast<std::chrono::microseconds>(timeout).count();
 
 dunedaq::appfwk::StdDeQueue<int> queue("StdDeQueue", 10); ///< Queue instance for the test
+
+/**
+ * @brief A payload which tells the queues how much memory it holds
+ */
+struct Payload
+{
+  std::vector<char> data;
+  size_t payload_size() const noexcept { return sizeof(Payload) + data.size(); }
+};
 } // namespace ""
 
 // This test case should run first. Make sure all other test cases depend on
@@ -130,4 +144,179 @@ BOOST_AUTO_TEST_CASE(empty_checks)
   BOOST_CHECK_LT(fraction_of_pop_timeout_used, 1 + fractional_timeout_tolerance);
 }
 
+BOOST_AUTO_TEST_CASE(batch_checks)
+{
+  dunedaq::appfwk::unittest::check_batches(queue, timeout);
+}
+
+BOOST_AUTO_TEST_CASE(try_checks)
+{
+  dunedaq::appfwk::unittest::check_try_operations(queue, timeout);
+}
+
+BOOST_AUTO_TEST_CASE(ring_storage)
+{
+  // Elements are constructed and destroyed in place, wrap around the end of
+  // the storage, and those left over are destroyed with the queue
+  auto element = std::make_shared<int>(7);
+  dunedaq::appfwk::PageAllocation::Options storage_options;
+  storage_options.prefault = true;
+  storage_options.huge_pages = dunedaq::appfwk::PageAllocation::HugePages::kTransparent;
+  {
+    dunedaq::appfwk::StdDeQueue<std::shared_ptr<int>> ptr_queue(
+      "PtrQueue", 3, dunedaq::appfwk::WaitPolicy::kSpinPark, storage_options);
+    BOOST_REQUIRE_GT(ptr_queue.get_page_size(), 0);
+    std::shared_ptr<int> popped;
+    for (int i = 0; i < 5; ++i) {
+      ptr_queue.push(std::shared_ptr<int>(element), timeout);
+      ptr_queue.push(std::shared_ptr<int>(element), timeout);
+      ptr_queue.pop(popped, timeout);
+      BOOST_REQUIRE_EQUAL(popped, element);
+      ptr_queue.pop(popped, timeout);
+      popped.reset();
+      BOOST_REQUIRE_EQUAL(element.use_count(), 1);
+    }
+
+    std::vector<std::shared_ptr<int>> batch(3, element);
+    BOOST_REQUIRE_EQUAL(ptr_queue.push_n(batch.data(), batch.size(), timeout), 3);
+    BOOST_REQUIRE_EQUAL(ptr_queue.get_num_elements(), 3);
+    BOOST_REQUIRE_EQUAL(ptr_queue.pop_n(batch.data(), 1, timeout), 1);
+    BOOST_REQUIRE_EQUAL(element.use_count(), 4);
+  }
+  BOOST_REQUIRE_EQUAL(element.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(wait_policies)
+{
+  dunedaq::appfwk::unittest::check_wait_policies<dunedaq::appfwk::StdDeQueue<int>>("StdDeQueue", timeout);
+}
+
+BOOST_AUTO_TEST_CASE(lock_deadline)
+{
+  // An element which takes a while to move in holds the mutex for as long
+  struct SlowMove
+  {
+    SlowMove() = default;
+    SlowMove(SlowMove&&) { std::this_thread::sleep_for(std::chrono::milliseconds(200)); }
+    SlowMove& operator=(SlowMove&&) = default;
+  };
+
+  using dunedaq::appfwk::WaitPolicy;
+  for (auto policy : { WaitPolicy::kBlock, WaitPolicy::kSpinPark }) {
+    dunedaq::appfwk::StdDeQueue<SlowMove> slow_queue("StdDeQueue", 2, policy);
+    std::thread producer([&]() { slow_queue.push(SlowMove(), std::chrono::milliseconds(1000)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // Waiting for the mutex gives up at the deadline
+    auto start_time = std::chrono::steady_clock::now();
+    BOOST_REQUIRE(!slow_queue.try_push(SlowMove(), std::chrono::milliseconds(10)));
+    BOOST_CHECK(std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(100));
+    producer.join();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(close_checks)
+{
+  using dunedaq::appfwk::WaitPolicy;
+  for (auto policy : { WaitPolicy::kBlock, WaitPolicy::kSpin, WaitPolicy::kSpinYield, WaitPolicy::kSpinPark }) {
+    dunedaq::appfwk::StdDeQueue<int> close_queue("StdDeQueue", 2, policy);
+    dunedaq::appfwk::unittest::check_close(close_queue, timeout);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(resize_checks)
+{
+  dunedaq::appfwk::StdDeQueue<int> resize_queue("resize_queue", 4);
+
+  // Wrap the ring around before resizing, so that the elements have to be moved back into order
+  for (int i = 0; i < 3; ++i) {
+    resize_queue.push(-1, timeout);
+  }
+  int popped_value = 0;
+  resize_queue.pop(popped_value, timeout);
+  resize_queue.pop(popped_value, timeout);
+  for (int i = 0; i < 3; ++i) {
+    resize_queue.push(std::move(i), timeout);
+  }
+  resize_queue.pop(popped_value, timeout);
+  BOOST_REQUIRE_EQUAL(popped_value, -1);
+
+  BOOST_REQUIRE(!resize_queue.resize(0));
+  BOOST_REQUIRE(!resize_queue.resize(2)); // Holds more elements than that
+  BOOST_REQUIRE(resize_queue.resize(8));
+  BOOST_REQUIRE_EQUAL(resize_queue.get_capacity(), 8);
+  BOOST_REQUIRE_EQUAL(resize_queue.get_num_elements(), 3);
+  for (int i = 3; i < 8; ++i) {
+    resize_queue.push(std::move(i), timeout);
+  }
+  BOOST_REQUIRE(!resize_queue.can_push());
+  for (int i = 0; i < 8; ++i) {
+    resize_queue.pop(popped_value, timeout);
+    BOOST_REQUIRE_EQUAL(popped_value, i);
+  }
+
+  // A push waiting for space goes ahead once the queue grows
+  for (int i = 0; i < 8; ++i) {
+    resize_queue.push(std::move(i), timeout);
+  }
+  std::thread resizer([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    resize_queue.resize(9);
+  });
+  BOOST_REQUIRE(resize_queue.try_push(8, std::chrono::milliseconds(5000)));
+  resizer.join();
+}
+
+BOOST_AUTO_TEST_CASE(byte_checks)
+{
+  using payload_ptr = std::unique_ptr<Payload>;
+  auto make_payload = [](size_t size) { return std::make_unique<Payload>(Payload{ std::vector<char>(size) }); };
+  auto bytes_of = [](size_t size) { return sizeof(payload_ptr) + sizeof(Payload) + size; };
+
+  dunedaq::appfwk::StdDeQueue<payload_ptr> byte_queue("byte_queue", 10);
+  BOOST_REQUIRE_EQUAL(dunedaq::appfwk::payload_bytes(payload_ptr()), sizeof(payload_ptr));
+  BOOST_REQUIRE_EQUAL(dunedaq::appfwk::payload_bytes(make_payload(100)), bytes_of(100));
+
+  // The queue counts what its elements hold, and the most they have held
+  byte_queue.push(make_payload(100), timeout);
+  byte_queue.push(make_payload(3000), timeout);
+  BOOST_REQUIRE_EQUAL(byte_queue.get_bytes(), bytes_of(100) + bytes_of(3000));
+  payload_ptr popped;
+  byte_queue.pop(popped, timeout);
+  BOOST_REQUIRE_EQUAL(popped->data.size(), 100);
+  BOOST_REQUIRE_EQUAL(byte_queue.get_bytes(), bytes_of(3000));
+  BOOST_REQUIRE_EQUAL(byte_queue.get_bytes_high_water(), bytes_of(100) + bytes_of(3000));
+
+  // Reporting starts the high-water mark again from what the queue holds
+  dunedaq::opmonlib::InfoCollector ic;
+  byte_queue.get_info(ic, 0);
+  BOOST_REQUIRE_EQUAL(byte_queue.get_bytes_high_water(), bytes_of(3000));
+
+  // With a capacity in bytes, pushes go through while the queue holds less than it, whatever the element count
+  byte_queue.set_capacity_bytes(bytes_of(3000) + bytes_of(1000));
+  BOOST_REQUIRE(byte_queue.can_push());
+  byte_queue.push(make_payload(2000), timeout);
+  BOOST_REQUIRE(!byte_queue.can_push());
+  BOOST_REQUIRE(!byte_queue.try_push(make_payload(1), timeout));
+  BOOST_REQUIRE_EQUAL(byte_queue.get_num_elements(), 2);
+
+  // A consumer making room lets a waiting producer through
+  std::thread consumer([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    payload_ptr consumed;
+    byte_queue.pop(consumed, timeout);
+  });
+  BOOST_REQUIRE(byte_queue.try_push(make_payload(1), std::chrono::milliseconds(5000)));
+  consumer.join();
+
+  // Batches are counted too
+  std::vector<payload_ptr> batch(2);
+  BOOST_REQUIRE_EQUAL(byte_queue.pop_n(batch.data(), batch.size(), timeout), 2);
+  BOOST_REQUIRE_EQUAL(byte_queue.get_bytes(), 0);
+  batch[0] = make_payload(10);
+  batch[1] = make_payload(20);
+  BOOST_REQUIRE_EQUAL(byte_queue.push_n(batch.data(), batch.size(), timeout), 2);
+  BOOST_REQUIRE_EQUAL(byte_queue.get_bytes(), bytes_of(10) + bytes_of(20));
+}
+
 BOOST_AUTO_TEST_SUITE_END()